@@ -0,0 +1,196 @@
+/*
+ *                              a2batch
+ *
+ *   Purpose:
+ *
+ *     Implementation of batched access. A batch is worked through in
+ *     chunks of CHUNK cells: the addresses of chunk c + 1 are found and
+ *     prefetched before the cells of chunk c are copied, so each
+ *     prefetch has a chunk's worth of copying to complete in. Copies of
+ *     the common cell sizes are fixed-size moves.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <string.h>
+#include "assert.h"
+#include "a2spec.h"
+#include "a2disk.h"
+#include "a2compressed.h"
+#include "a2view.h"
+#include "uarray2spec.h"
+#include "a2batch.h"
+
+typedef A2Methods_UArray2 A2;
+
+#define CHUNK 64
+
+/* Struct locator
+* How to find cells of one array. LOCATE_CACHED arrays are found with
+* 'at' too, but their cells may be evicted by the next 'at'.
+*/
+struct locator {
+    enum { LOCATE_METHODS, LOCATE_CACHED, LOCATE_PLAIN,
+           LOCATE_BLOCKED } kind;
+    A2Methods_T methods;
+    A2 array;
+};
+
+static struct locator locatorOf(A2Methods_T methods, A2 array)
+{
+    struct locator loc = { LOCATE_METHODS, methods, array };
+    A2Methods_T base = methods == a2view_methods
+                       ? A2View_baseMethods(array) : methods;
+    if (base == uarray2_methods_disk || base == uarray2_methods_compressed) {
+        loc.kind = LOCATE_CACHED;
+    } else if (A2Spec_size(methods) == methods->size(array)) {
+        loc.kind = A2Spec_isBlocked(methods) ? LOCATE_BLOCKED : LOCATE_PLAIN;
+    }
+    return loc;
+}
+
+/* Function: locate
+ * Purpose: Finds cells and prefetches them
+ * Arguments: The locator, coordinates, how many, where to put the cells
+ * Returns: none
+ */
+static inline void locate(const struct locator *loc,
+                          const A2Batch_coord *coords, int n, char **cells)
+{
+    if (loc->kind == LOCATE_METHODS || loc->kind == LOCATE_CACHED) {
+        for (int k = 0; k < n; k++) {
+            cells[k] = loc->methods->at(loc->array, coords[k].i,
+                                        coords[k].j);
+            __builtin_prefetch(cells[k]);
+        }
+        return;
+    }
+
+    UArray2s_T a = loc->array;
+    long size = a->size;
+    int bs = a->blocksize;
+    for (int k = 0; k < n; k++) {
+        int i = coords[k].i, j = coords[k].j;
+        assert(i >= 0 && i < a->width && j >= 0 && j < a->height);
+        long cell;
+        if (loc->kind == LOCATE_PLAIN) {
+            cell = (long)j * a->pitch + i;
+        } else {
+            long block = (long)(j / bs) * a->blocksWide + i / bs;
+            cell = block * a->blockStride + j % bs * bs + i % bs;
+        }
+        cells[k] = a->elems + cell * size;
+        __builtin_prefetch(cells[k]);
+    }
+}
+
+/* Function: copyCells
+ * Purpose: Copies n cells between scattered cells and a packed buffer
+ * Arguments: The scattered cells, the buffer, how many, the cell size,
+ *            1 to copy into the cells or 0 to copy out of them
+ * Returns: none
+ */
+static inline void copyCells(char **cells, char *packed, int n, int size,
+                             int intoCells)
+{
+#define COPY(SIZE)                                                      \
+    for (int k = 0; k < n; k++, packed += SIZE) {                       \
+        if (intoCells) {                                                \
+            memcpy(cells[k], packed, SIZE);                             \
+        } else {                                                        \
+            memcpy(packed, cells[k], SIZE);                             \
+        }                                                               \
+    }
+    switch (size) {
+    case 1:  COPY(1);    break;
+    case 4:  COPY(4);    break;
+    case 8:  COPY(8);    break;
+    case 12: COPY(12);   break;
+    default: COPY(size); break;
+    }
+#undef COPY
+}
+
+/* Function: pipeline
+ * Purpose: Copies a batch chunk by chunk, locating chunk c + 1 before
+ *          copying chunk c; cells of file-backed and compressed arrays
+ *          are copied one at a time
+ * Arguments: The methods and array, the coordinates and how many, the
+ *            packed buffer, 1 to scatter or 0 to gather
+ * Returns: none
+ */
+static void pipeline(A2Methods_T methods, A2 array,
+                     const A2Batch_coord *coords, int n, char *packed,
+                     int scatter)
+{
+    assert(methods != NULL && array != NULL);
+    assert(n == 0 || (coords != NULL && packed != NULL));
+    struct locator loc = locatorOf(methods, array);
+    int size = methods->size(array);
+    if (loc.kind == LOCATE_CACHED) {
+        /* a cell from 'at' may be evicted by the next 'at' (a2disk.h,
+           a2compressed.h), so each is copied as soon as it is found */
+        for (int k = 0; k < n; k++) {
+            char *cell = methods->at(array, coords[k].i, coords[k].j);
+            copyCells(&cell, packed + (long)k * size, 1, size, scatter);
+        }
+        return;
+    }
+    char *cells[2][CHUNK];
+    int first = n < CHUNK ? n : CHUNK;
+    locate(&loc, coords, first, cells[0]);
+    for (int start = 0, c = 0; start < n; start += CHUNK, c ^= 1) {
+        int count = n - start < CHUNK ? n - start : CHUNK;
+        int next = start + CHUNK;
+        if (next < n) {
+            locate(&loc, coords + next, n - next < CHUNK ? n - next : CHUNK,
+                   cells[c ^ 1]);
+        }
+        copyCells(cells[c], packed + (long)start * size, count, size,
+                  scatter);
+    }
+}
+
+/* Function: A2Batch_at
+ * Purpose: Finds a batch of cells, prefetching each. A file-backed or
+ *          compressed array, or a view of one, is a checked run-time
+ *          error: it could evict a found cell before the batch is done.
+ * Arguments: The methods of the array, the array, the coordinates and
+ *            how many, where to put the n cells
+ * Returns: none
+ */
+void A2Batch_at(A2Methods_T methods, A2 array, const A2Batch_coord *coords,
+                int n, void **cells)
+{
+    assert(methods != NULL && array != NULL);
+    assert(n == 0 || (coords != NULL && cells != NULL));
+    struct locator loc = locatorOf(methods, array);
+    assert(loc.kind != LOCATE_CACHED);
+    locate(&loc, coords, n, (char **)cells);
+}
+
+/* Function: A2Batch_gather
+ * Purpose: Copies a batch of cells out of an array
+ * Arguments: The methods of the array, the array, the coordinates and
+ *            how many, a buffer of n cells
+ * Returns: none
+ */
+void A2Batch_gather(A2Methods_T methods, A2 array,
+                    const A2Batch_coord *coords, int n, void *out)
+{
+    pipeline(methods, array, coords, n, out, 0);
+}
+
+/* Function: A2Batch_scatter
+ * Purpose: Copies a batch of cells into an array; when a coordinate
+ *          repeats, its last cell wins
+ * Arguments: The methods of the array, the array, the coordinates and
+ *            how many, a buffer of n cells
+ * Returns: none
+ */
+void A2Batch_scatter(A2Methods_T methods, A2 array,
+                     const A2Batch_coord *coords, int n, const void *in)
+{
+    pipeline(methods, array, coords, n, (char *)in, 1);
+}
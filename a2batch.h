@@ -0,0 +1,57 @@
+/*
+ *                              a2batch
+ *
+ *   Purpose:
+ *
+ *     Batched random access to the cells of A2 arrays, for loops that
+ *     look up many scattered coordinates (resampling, remaps, lookup
+ *     tables). One call finds every cell of a batch and issues a
+ *     software prefetch for each as soon as its address is known, so
+ *     the cache misses of a batch overlap instead of following one
+ *     another; gather and scatter copy a batch in a pipeline, finding
+ *     and prefetching the cells of the next chunk before copying the
+ *     current one.
+ *
+ *     Addresses are computed inline for the specialized UArray2s
+ *     tables (a2spec.h), whose representation is public, and with
+ *     'at' for any other table. Every coordinate must be in bounds.
+ *
+ *     The file-backed and compressed arrays (a2disk.h, a2compressed.h)
+ *     keep a pointer from 'at' valid only until a few other blocks are
+ *     touched, so gather and scatter copy their cells, and those of
+ *     views (a2view.h) of them, one at a time, as each is found, and
+ *     A2Batch_at must not be given them.
+ *
+ *     A2Methods_T itself cannot grow new entries, so these take the
+ *     methods of the array like the functions of rgbcells.h do.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef A2BATCH_INCLUDED
+#define A2BATCH_INCLUDED
+
+#include "a2methods.h"
+
+/* Struct A2Batch_coord
+* A cell's column and row
+*/
+typedef struct A2Batch_coord {
+    int i, j;
+} A2Batch_coord;
+
+/* cells[k] = at(coords[k]), each prefetched; not for file-backed or
+   compressed arrays, whose cells may be evicted before they are used */
+extern void A2Batch_at     (A2Methods_T methods, A2Methods_UArray2 array,
+                            const A2Batch_coord *coords, int n,
+                            void **cells);
+/* copies cell coords[k] to out + k * size */
+extern void A2Batch_gather (A2Methods_T methods, A2Methods_UArray2 array,
+                            const A2Batch_coord *coords, int n, void *out);
+/* copies in + k * size to cell coords[k], in order of k */
+extern void A2Batch_scatter(A2Methods_T methods, A2Methods_UArray2 array,
+                            const A2Batch_coord *coords, int n,
+                            const void *in);
+
+#endif
@@ -1,6 +1,7 @@
 #include <string.h>
 
 #include <a2blocked.h>
+#include "a2unchecked.h"
 #include "uarray2b.h"
 
 // define a private version of each function in A2Methods_T that we implement
@@ -94,3 +95,47 @@ static struct A2Methods_T uarray2_methods_blocked_struct = {
 // finally the payoff: here is the exported pointer to the struct
 
 A2Methods_T uarray2_methods_blocked = &uarray2_methods_blocked_struct;
+
+// the unchecked variant: same arrays, but 'at' and the maps skip every
+// null and bounds check
+
+static A2Methods_Object *at_unchecked(A2 array2, int i, int j)
+{
+	return UArray2b_at_unchecked(array2, i, j);
+}
+
+static void map_block_major_unchecked(A2 array2, A2Methods_applyfun apply,
+				      void *cl)
+{
+	UArray2b_map_unchecked(array2, (applyfun *) apply, cl);
+}
+
+static void small_map_block_major_unchecked(A2 a2,
+					    A2Methods_smallapplyfun apply,
+					    void *cl)
+{
+	struct small_closure mycl = { apply, cl };
+	UArray2b_map_unchecked(a2, apply_small, &mycl);
+}
+
+static struct A2Methods_T uarray2_methods_blocked_unchecked_struct = {
+	new,
+	new_with_blocksize,
+	a2free,
+	width,
+	height,
+	size,
+	blocksize,
+	at_unchecked,
+	NULL,			// map_row_major
+	NULL,			// map_col_major
+	map_block_major_unchecked,
+	map_block_major_unchecked,	// map_default
+	NULL,			// small_map_row_major
+	NULL,			// small_map_col_major
+	small_map_block_major_unchecked,
+	small_map_block_major_unchecked,	// small_map_default
+};
+
+A2Methods_T uarray2_methods_blocked_unchecked =
+	&uarray2_methods_blocked_unchecked_struct;
@@ -0,0 +1,24 @@
+/*
+ *                              a2colmajor
+ *
+ *   Purpose:
+ *
+ *     A2Methods table for UArray2 arrays stored column by column
+ *     (UArray2_new_col_major), for producers and consumers that work
+ *     in columns. 'at' and both maps are the UArray2 ones; map_default
+ *     and small_map_default walk by columns, which is storage order.
+ *     Walking by columns is then as cheap as walking a plain array by
+ *     rows, and walking by rows is the strided walk.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef A2COLMAJOR_INCLUDED
+#define A2COLMAJOR_INCLUDED
+
+#include "a2methods.h"
+
+extern A2Methods_T uarray2_methods_colmajor;
+
+#endif
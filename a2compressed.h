@@ -0,0 +1,21 @@
+/*
+ *                              a2compressed
+ *
+ *   Purpose:
+ *
+ *     A2Methods table for compressed blocked arrays (uarray2z.h), for
+ *     keeping mostly flat images at a fraction of their size. Like
+ *     uarray2_methods_blocked, it maps block by block only.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef A2COMPRESSED_INCLUDED
+#define A2COMPRESSED_INCLUDED
+
+#include "a2methods.h"
+
+extern A2Methods_T uarray2_methods_compressed;
+
+#endif
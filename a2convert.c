@@ -0,0 +1,129 @@
+/*
+ *                              a2convert
+ *
+ *   Purpose:
+ *
+ *     Implementation of layout conversion. Each side of a copy is one
+ *     of three shapes: rows (UArray2 and the plain a2spec tables, whose
+ *     rows are contiguous), blocks (UArray2b and the blocked a2spec
+ *     tables, whose blocks are stored row by row) or cells (anything
+ *     else, such as views and the file-backed and compressed arrays,
+ *     where only one cell at a time is known to be in memory). A row of
+ *     a tile is cut where either side's contiguous stretch ends, and
+ *     each piece is found with one 'at' per side and moved with memcpy.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <string.h>
+#include "assert.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2unchecked.h"
+#include "a2spec.h"
+#include "a2convert.h"
+
+typedef A2Methods_UArray2 A2;
+
+/* Struct side
+* One array of a copy; each run of 'span' cells of a row, starting at a
+* multiple of 'span', is contiguous
+*/
+struct side {
+    A2Methods_T methods;
+    A2 array;
+    int blocked;
+    int span;
+};
+
+static struct side sideOf(A2Methods_T methods, A2 array)
+{
+    struct side s = { methods, array, 0, 1 };
+    int size = methods->size(array);
+    if (methods == uarray2_methods_plain ||
+        methods == uarray2_methods_plain_unchecked ||
+        (A2Spec_size(methods) == size && !A2Spec_isBlocked(methods))) {
+        s.span = methods->width(array);
+    } else if (methods == uarray2_methods_blocked ||
+               methods == uarray2_methods_blocked_unchecked ||
+               A2Spec_size(methods) == size) {
+        s.blocked = 1;
+        s.span = methods->blocksize(array);
+    }
+    return s;
+}
+
+/* Function: runEnd
+ * Purpose: Finds where the contiguous stretch holding column i ends
+ * Arguments: The side, the column
+ * Returns: The first column past the stretch
+ */
+static inline int runEnd(const struct side *s, int i)
+{
+    return (i / s->span + 1) * s->span;
+}
+
+/* Function: A2Convert_copy
+ * Purpose: Copies an array into another of any representation
+ * Arguments: The methods and the array to copy, the methods and the
+ *            array to fill, with the same width, height and size
+ * Returns: none
+ */
+void A2Convert_copy(A2Methods_T fromMethods, A2 from, A2Methods_T toMethods,
+                    A2 to)
+{
+    assert(fromMethods != NULL && from != NULL);
+    assert(toMethods != NULL && to != NULL && from != to);
+    int width = fromMethods->width(from);
+    int height = fromMethods->height(from);
+    int size = fromMethods->size(from);
+    assert(toMethods->width(to) == width);
+    assert(toMethods->height(to) == height);
+    assert(toMethods->size(to) == size);
+
+    struct side src = sideOf(fromMethods, from);
+    struct side dest = sideOf(toMethods, to);
+    /* tiles are blocks of the blocked side, or whole rows */
+    int tileHigh = 1, tileWide = width;
+    if (src.blocked || dest.blocked) {
+        int bs = src.blocked ? src.span : 1;
+        bs = dest.blocked && dest.span > bs ? dest.span : bs;
+        tileHigh = tileWide = bs;
+    }
+
+    for (int j0 = 0; j0 < height; j0 += tileHigh) {
+        int jEnd = j0 + tileHigh < height ? j0 + tileHigh : height;
+        for (int i0 = 0; i0 < width; i0 += tileWide) {
+            int iEnd = i0 + tileWide < width ? i0 + tileWide : width;
+            for (int j = j0; j < jEnd; j++) {
+                for (int i = i0; i < iEnd; ) {
+                    int end = runEnd(&src, i);
+                    int destEnd = runEnd(&dest, i);
+                    end = destEnd < end ? destEnd : end;
+                    end = iEnd < end ? iEnd : end;
+                    memcpy(toMethods->at(to, i, j),
+                           fromMethods->at(from, i, j),
+                           (size_t)(end - i) * size);
+                    i = end;
+                }
+            }
+        }
+    }
+}
+
+/* Function: A2Convert_new
+ * Purpose: Makes a copy of an array in another representation, with
+ *          that representation's default block size
+ * Arguments: The methods and the array to copy, the methods of the copy
+ * Returns: The copy, to be freed with toMethods->free
+ */
+A2 A2Convert_new(A2Methods_T fromMethods, A2 from, A2Methods_T toMethods)
+{
+    assert(fromMethods != NULL && from != NULL && toMethods != NULL);
+    A2 to = toMethods->new(fromMethods->width(from),
+                           fromMethods->height(from),
+                           fromMethods->size(from));
+    A2Convert_copy(fromMethods, from, toMethods, to);
+    return to;
+}
@@ -0,0 +1,35 @@
+/*
+ *                              a2convert
+ *
+ *   Purpose:
+ *
+ *     Copies an A2 array into another of the same shape and element
+ *     size but any representation: plain to blocked, blocked to plain,
+ *     or between any two A2Methods backends. The copy goes tile by
+ *     tile, each tile one block of the blocked side, and moves every
+ *     stretch of a row that is contiguous in both arrays with one
+ *     memcpy, so a conversion costs about what copying the image costs.
+ *
+ *     This lets a program pick a layout per operation rather than per
+ *     run: read an image row-major, which suits the file, and switch
+ *     to blocks only for the transform that gains from them.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef A2CONVERT_INCLUDED
+#define A2CONVERT_INCLUDED
+
+#include "a2methods.h"
+
+/* copies every cell of 'from' into 'to', a distinct array of the same
+ * width, height and size */
+extern void A2Convert_copy(A2Methods_T fromMethods, A2Methods_UArray2 from,
+                           A2Methods_T toMethods, A2Methods_UArray2 to);
+/* a new array of toMethods with the cells of 'from' */
+extern A2Methods_UArray2 A2Convert_new(A2Methods_T fromMethods,
+                                       A2Methods_UArray2 from,
+                                       A2Methods_T toMethods);
+
+#endif
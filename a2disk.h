@@ -0,0 +1,22 @@
+/*
+ *                              a2disk
+ *
+ *   Purpose:
+ *
+ *     A2Methods table for file-backed blocked arrays (uarray2file.h),
+ *     for images too large to keep in memory. Like
+ *     uarray2_methods_blocked, it maps block by block only. The cache
+ *     size and directory of new arrays are set with UArray2f_configure.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef A2DISK_INCLUDED
+#define A2DISK_INCLUDED
+
+#include "a2methods.h"
+
+extern A2Methods_T uarray2_methods_disk;
+
+#endif
@@ -0,0 +1,380 @@
+/*
+ *                              a2microbench
+ *
+ *   Purpose:
+ *
+ *     Measures what the A2Methods primitives cost, for each backend and
+ *     element size: 'at' in row order (sequential for plain arrays),
+ *     in column order (strided) and at random cells, the last also in
+ *     batches with A2Batch_gather (a2batch.h); every map and
+ *     small_map with an apply that does nothing but count; and new plus
+ *     free. Each measurement is repeated, and reported as the mean in
+ *     nanoseconds per operation (per cell, or per array for new and
+ *     free) with the half-width of its 95% confidence interval.
+ *
+ *         a2microbench [-size <width> <height>] [-repeats <n>]
+ *
+ *     Comparing a backend with its unchecked table shows what the
+ *     checks cost; comparing 'at' with the maps shows the cost of a
+ *     call per cell through a function pointer. The program is built
+ *     like ppmtrans-fast, with asserts compiled away; building it with
+ *     FASTCFLAGS set to "-O3 $(CFLAGS)" keeps them, to price them too.
+ *
+ *     A new backend needs one line in BACKENDS. Backends that cache
+ *     blocks (file-backed and compressed arrays) skip random 'at',
+ *     which would measure their cache misses rather than the call.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "mem.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2unchecked.h"
+#include "a2colmajor.h"
+#include "a2spec.h"
+#include "a2disk.h"
+#include "a2compressed.h"
+#include "a2batch.h"
+#include "cputiming.h"
+
+typedef A2Methods_UArray2 A2;
+
+#define DEFAULT_WIDTH 512
+#define DEFAULT_HEIGHT 512
+#define DEFAULT_REPEATS 10
+#define NEW_FREE_ROUNDS 20          /* arrays made per new+free sample */
+#define BATCH 256                   /* cells per batch of gather random */
+
+/* The tables of each backend, by element size */
+#define FIXED_TABLE(NAME, TABLE)                                        \
+static A2Methods_T NAME(int size)                                       \
+{                                                                       \
+    (void)size;                                                         \
+    return TABLE;                                                       \
+}
+FIXED_TABLE(plain, uarray2_methods_plain)
+FIXED_TABLE(blocked, uarray2_methods_blocked)
+FIXED_TABLE(plainUnchecked, uarray2_methods_plain_unchecked)
+FIXED_TABLE(blockedUnchecked, uarray2_methods_blocked_unchecked)
+FIXED_TABLE(colMajor, uarray2_methods_colmajor)
+FIXED_TABLE(disk, uarray2_methods_disk)
+FIXED_TABLE(compressed, uarray2_methods_compressed)
+#undef FIXED_TABLE
+
+/* Struct backend
+* A family of A2Methods tables; 'methods' gives the table for an element
+* size, or NULL if the family has none
+*/
+struct backend {
+    const char *name;
+    A2Methods_T (*methods)(int size);
+    int cached;         /* 'at' may load or evict blocks */
+};
+
+static const struct backend BACKENDS[] = {
+    { "plain",             plain,            0 },
+    { "blocked",           blocked,          0 },
+    { "plain-unchecked",   plainUnchecked,   0 },
+    { "blocked-unchecked", blockedUnchecked, 0 },
+    { "colmajor",          colMajor,         0 },
+    { "spec-plain",        A2Spec_plain,     0 },
+    { "spec-blocked",      A2Spec_blocked,   0 },
+    { "disk",              disk,             1 },
+    { "compressed",        compressed,       1 },
+};
+#define NBACKENDS ((int)(sizeof(BACKENDS) / sizeof(BACKENDS[0])))
+
+static const int SIZES[] = { 1, 4, 12 };
+#define NSIZES ((int)(sizeof(SIZES) / sizeof(SIZES[0])))
+
+/* Struct bench
+* What one measurement works on
+*/
+struct bench {
+    A2Methods_T methods;
+    A2 array;
+    int width, height, size;
+    int *randomCells;   /* width * height cell indices, in random order */
+};
+
+static volatile unsigned long sink;     /* keeps results alive */
+
+static void count(int i, int j, A2 array, void *elem, void *cl)
+{
+    (void)i;
+    (void)j;
+    (void)array;
+    (void)elem;
+    (*(unsigned long *)cl)++;
+}
+
+static void countSmall(void *elem, void *cl)
+{
+    (void)elem;
+    (*(unsigned long *)cl)++;
+}
+
+/* The operations measured; each returns how many operations it did, or
+ * -1 if the backend lacks what it needs
+ */
+
+static long atRows(struct bench *b)
+{
+    unsigned long sum = 0;
+    for (int j = 0; j < b->height; j++) {
+        for (int i = 0; i < b->width; i++) {
+            sum += *(unsigned char *)b->methods->at(b->array, i, j);
+        }
+    }
+    sink = sum;
+    return (long)b->width * b->height;
+}
+
+static long atColumns(struct bench *b)
+{
+    unsigned long sum = 0;
+    for (int i = 0; i < b->width; i++) {
+        for (int j = 0; j < b->height; j++) {
+            sum += *(unsigned char *)b->methods->at(b->array, i, j);
+        }
+    }
+    sink = sum;
+    return (long)b->width * b->height;
+}
+
+static long atRandom(struct bench *b)
+{
+    unsigned long sum = 0;
+    long cells = (long)b->width * b->height;
+    for (long k = 0; k < cells; k++) {
+        int cell = b->randomCells[k];
+        sum += *(unsigned char *)b->methods->at(b->array, cell % b->width,
+                                                cell / b->width);
+    }
+    sink = sum;
+    return cells;
+}
+
+static long gatherRandom(struct bench *b)
+{
+    A2Batch_coord coords[BATCH];
+    unsigned char out[BATCH * 12];
+    unsigned long sum = 0;
+    long cells = (long)b->width * b->height;
+    assert(b->size <= 12);
+    for (long k = 0; k < cells; k += BATCH) {
+        int n = cells - k < BATCH ? cells - k : BATCH;
+        for (int c = 0; c < n; c++) {
+            int cell = b->randomCells[k + c];
+            coords[c].i = cell % b->width;
+            coords[c].j = cell / b->width;
+        }
+        A2Batch_gather(b->methods, b->array, coords, n, out);
+        for (int c = 0; c < n; c++) {
+            sum += out[c * b->size];
+        }
+    }
+    sink = sum;
+    return cells;
+}
+
+#define MAP_OPERATION(NAME, FIELD, APPLY)                               \
+static long NAME(struct bench *b)                                       \
+{                                                                       \
+    unsigned long calls = 0;                                            \
+    if (b->methods->FIELD == NULL) {                                    \
+        return -1;                                                      \
+    }                                                                   \
+    b->methods->FIELD(b->array, APPLY, &calls);                         \
+    sink = calls;                                                       \
+    return calls;                                                       \
+}
+MAP_OPERATION(mapRow, map_row_major, count)
+MAP_OPERATION(mapCol, map_col_major, count)
+MAP_OPERATION(mapBlock, map_block_major, count)
+MAP_OPERATION(smallMapRow, small_map_row_major, countSmall)
+MAP_OPERATION(smallMapCol, small_map_col_major, countSmall)
+MAP_OPERATION(smallMapBlock, small_map_block_major, countSmall)
+#undef MAP_OPERATION
+
+static long newFree(struct bench *b)
+{
+    for (int k = 0; k < NEW_FREE_ROUNDS; k++) {
+        A2 array = b->methods->new(b->width, b->height, b->size);
+        b->methods->free(&array);
+    }
+    return NEW_FREE_ROUNDS;
+}
+
+/* Struct operation
+* One row of the report
+*/
+struct operation {
+    const char *name;
+    long (*run)(struct bench *b);
+    int random;         /* visits cells in random order */
+};
+
+static const struct operation OPERATIONS[] = {
+    { "at rows",         atRows,        0 },
+    { "at columns",      atColumns,     0 },
+    { "at random",       atRandom,      1 },
+    { "gather random",   gatherRandom,  1 },
+    { "map_row_major",   mapRow,        0 },
+    { "map_col_major",   mapCol,        0 },
+    { "map_block_major", mapBlock,      0 },
+    { "small_map_row",   smallMapRow,   0 },
+    { "small_map_col",   smallMapCol,   0 },
+    { "small_map_block", smallMapBlock, 0 },
+    { "new+free",        newFree,       0 },
+};
+#define NOPERATIONS ((int)(sizeof(OPERATIONS) / sizeof(OPERATIONS[0])))
+
+/* Function: tValue
+ * Purpose: Finds the two-sided 95% Student's t value
+ * Arguments: The degrees of freedom, at least 1
+ * Returns: The t value
+ */
+static double tValue(int df)
+{
+    static const double T95[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+        2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+        2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052,
+        2.048, 2.045, 2.042
+    };
+    assert(df >= 1);
+    return df <= 30 ? T95[df - 1] : 1.960;
+}
+
+/* Function: measure
+ * Purpose: Runs an operation once to warm up and then 'repeats' times
+ * Arguments: The operation, what it works on, the repeats (at least 2),
+ *            where to put the mean and the confidence half-width
+ * Returns: 1, or 0 if the backend cannot run the operation
+ */
+static int measure(const struct operation *op, struct bench *b,
+                   int repeats, double *mean, double *halfWidth)
+{
+    if (op->run(b) < 0) {
+        return 0;
+    }
+    CPUTime_T timer = CPUTime_New();
+    double sum = 0, sumSquares = 0;
+    for (int r = 0; r < repeats; r++) {
+        CPUTime_Start(timer);
+        long ops = op->run(b);
+        double ns = CPUTime_Stop(timer) / ops;
+        sum += ns;
+        sumSquares += ns * ns;
+    }
+    CPUTime_Free(&timer);
+    *mean = sum / repeats;
+    double variance = (sumSquares - sum * *mean) / (repeats - 1);
+    *halfWidth = tValue(repeats - 1) * sqrt(variance > 0 ? variance : 0) /
+                 sqrt(repeats);
+    return 1;
+}
+
+static void fillByte(int i, int j, A2 array, void *elem, void *cl)
+{
+    (void)array;
+    (void)cl;
+    *(unsigned char *)elem = i ^ j;
+}
+
+static void benchBackend(const struct backend *backend, int size,
+                         int width, int height, int repeats,
+                         int *randomCells)
+{
+    A2Methods_T methods = backend->methods(size);
+    if (methods == NULL) {
+        return;
+    }
+    struct bench b = { methods, methods->new(width, height, size), width,
+                       height, size, randomCells };
+    methods->map_default(b.array, fillByte, NULL);
+    for (int k = 0; k < NOPERATIONS; k++) {
+        const struct operation *op = &OPERATIONS[k];
+        double mean, halfWidth;
+        if ((op->random && backend->cached) ||
+            !measure(op, &b, repeats, &mean, &halfWidth)) {
+            continue;
+        }
+        printf("%-18s %4d  %-16s %10.2f %9.2f\n", backend->name, size,
+               op->name, mean, halfWidth);
+    }
+    methods->free(&b.array);
+}
+
+static void usage(const char *progname)
+{
+    fprintf(stderr, "Usage: %s [-size <width> <height>] [-repeats <n>]\n",
+            progname);
+    exit(1);
+}
+
+static int positive(const char *arg, const char *progname)
+{
+    char *end;
+    long value = strtol(arg, &end, 10);
+    if (*end != '\0' || value <= 0 || value > 1 << 15) {
+        usage(progname);
+    }
+    return value;
+}
+
+int main(int argc, char *argv[])
+{
+    int width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT;
+    int repeats = DEFAULT_REPEATS;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-size") == 0 && i + 2 < argc) {
+            width = positive(argv[++i], argv[0]);
+            height = positive(argv[++i], argv[0]);
+        } else if (strcmp(argv[i], "-repeats") == 0 && i + 1 < argc) {
+            repeats = positive(argv[++i], argv[0]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (repeats < 2) {
+        usage(argv[0]);
+    }
+
+    /* the same random order for every backend */
+    long cells = (long)width * height;
+    int *randomCells = ALLOC(cells * sizeof(int));
+    for (long k = 0; k < cells; k++) {
+        randomCells[k] = k;
+    }
+    srand(40);
+    for (long k = cells - 1; k > 0; k--) {
+        long other = rand() % (k + 1);
+        int cell = randomCells[k];
+        randomCells[k] = randomCells[other];
+        randomCells[other] = cell;
+    }
+
+    printf("%dx%d cells, %d repeats; ns per cell (per array for "
+           "new+free), mean and 95%% half-width\n", width, height,
+           repeats);
+    printf("%-18s %4s  %-16s %10s %9s\n", "backend", "size", "operation",
+           "ns/op", "+/-");
+    for (int k = 0; k < NBACKENDS; k++) {
+        for (int s = 0; s < NSIZES; s++) {
+            benchBackend(&BACKENDS[k], SIZES[s], width, height, repeats,
+                         randomCells);
+        }
+    }
+    FREE(randomCells);
+    return EXIT_SUCCESS;
+}
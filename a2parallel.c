@@ -0,0 +1,136 @@
+/*
+ *                              a2parallel
+ *
+ *   Purpose:
+ *
+ *     Implementation of the parallel map. Unblocked arrays are cut
+ *     into about TASKS_PER_WORKER bands of whole rows per worker, so
+ *     that work stealing can even out uneven workers; blocked arrays
+ *     are cut into their blocks, which keeps each task inside the
+ *     cache lines of one block.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "mem.h"
+#include "a2parallel.h"
+
+#define TASKS_PER_WORKER 8
+
+typedef A2Methods_UArray2 A2;
+
+/* struct parallel_map
+ * One parallel map, shared read-only by every task
+ */
+struct parallel_map {
+    A2Methods_T methods;
+    A2 array2;
+    A2Methods_applyfun *apply;
+    void **closures;        /* closure passed by each worker */
+    int width, height;
+    int blocksize;          /* 1 for unblocked arrays */
+    int blocksWide;         /* blocks in a row of blocks */
+    int rowsPerTask;        /* rows in a band, for unblocked arrays */
+};
+
+/* Function: visit
+ * Purpose: Applies the function to a rectangle of cells, row by row
+ * Arguments: The map, the worker's closure, the rectangle's corners
+ *            (the second one exclusive)
+ * Returns: none
+ */
+static void visit(struct parallel_map *map, void *cl,
+                  int i0, int j0, int i1, int j1)
+{
+    A2Methods_T methods = map->methods;
+    for (int j = j0; j < j1; j++) {
+        for (int i = i0; i < i1; i++) {
+            map->apply(i, j, map->array2, methods->at(map->array2, i, j),
+                       cl);
+        }
+    }
+}
+
+static void bandTask(int task, int worker, void *vmap)
+{
+    struct parallel_map *map = vmap;
+    int j0 = task * map->rowsPerTask;
+    int j1 = j0 + map->rowsPerTask;
+    visit(map, map->closures[worker], 0, j0, map->width,
+          j1 < map->height ? j1 : map->height);
+}
+
+static void blockTask(int task, int worker, void *vmap)
+{
+    struct parallel_map *map = vmap;
+    int bs = map->blocksize;
+    int i0 = task % map->blocksWide * bs;
+    int j0 = task / map->blocksWide * bs;
+    int i1 = i0 + bs < map->width ? i0 + bs : map->width;
+    int j1 = j0 + bs < map->height ? j0 + bs : map->height;
+    visit(map, map->closures[worker], i0, j0, i1, j1);
+}
+
+/* Function: A2Parallel_map
+ * Purpose: Applies a function to every cell of an array, in parallel
+ * Arguments: The pool to run on, the methods of the array, the array,
+ *            the apply function and its closure, the size of the
+ *            closure to copy per worker (0 to share it), and the
+ *            function folding the copies back, or NULL
+ * Returns: none
+ */
+void A2Parallel_map(WorkPool_T pool, A2Methods_T methods, A2 array2,
+                    A2Methods_applyfun apply, void *cl, int clsize,
+                    A2Parallel_reducefun *reduce)
+{
+    assert(pool != NULL && methods != NULL && array2 != NULL);
+    assert(apply != NULL && clsize >= 0);
+    assert(reduce == NULL || clsize > 0);
+    int workers = WorkPool_workers(pool);
+    struct parallel_map map;
+    map.methods = methods;
+    map.array2 = array2;
+    map.apply = apply;
+    map.width = methods->width(array2);
+    map.height = methods->height(array2);
+    map.blocksize = methods->blocksize(array2);
+    if (map.width == 0 || map.height == 0) {
+        return;
+    }
+
+    map.closures = CALLOC(workers, sizeof(void *));
+    for (int k = 0; k < workers; k++) {
+        if (clsize > 0) {
+            map.closures[k] = ALLOC(clsize);
+            memcpy(map.closures[k], cl, clsize);
+        } else {
+            map.closures[k] = cl;
+        }
+    }
+
+    if (map.blocksize > 1) {
+        int bs = map.blocksize;
+        map.blocksWide = (map.width + bs - 1) / bs;
+        int blocksHigh = (map.height + bs - 1) / bs;
+        WorkPool_run(pool, map.blocksWide * blocksHigh, blockTask, &map);
+    } else {
+        int tasks = workers * TASKS_PER_WORKER;
+        map.rowsPerTask = (map.height + tasks - 1) / tasks;
+        tasks = (map.height + map.rowsPerTask - 1) / map.rowsPerTask;
+        WorkPool_run(pool, tasks, bandTask, &map);
+    }
+
+    for (int k = 0; k < workers; k++) {
+        if (clsize > 0) {
+            if (reduce != NULL) {
+                reduce(cl, map.closures[k]);
+            }
+            FREE(map.closures[k]);
+        }
+    }
+    FREE(map.closures);
+}
@@ -0,0 +1,41 @@
+/*
+ *                              a2parallel
+ *
+ *   Purpose:
+ *
+ *     Interface to parallel mapping over any A2 array. A2Parallel_map
+ *     splits the array into tasks, bands of rows for unblocked arrays
+ *     and single blocks for blocked ones, and runs them on a WorkPool.
+ *     Every cell is visited exactly once, by one worker, in an order
+ *     that is unspecified beyond that: within a task, cells are
+ *     visited row by row.
+ *
+ *     With a closure size of 0, every call receives the caller's
+ *     closure itself. Otherwise each worker gets a private copy of the
+ *     closure, so apply functions may update it without locks; after
+ *     the run the copies are folded into the caller's closure by the
+ *     reduce function, in worker order, if one is given. Each copy
+ *     starts out equal to the caller's closure, so a closure that is
+ *     reduced should start out as the identity of the reduction. An apply
+ *     function that writes only cells of its own, or cells of another
+ *     array at positions derived from its own, needs no locks.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef A2PARALLEL_INCLUDED
+#define A2PARALLEL_INCLUDED
+
+#include "a2methods.h"
+#include "workpool.h"
+
+/* Folds one worker's copy of the closure into the caller's */
+typedef void A2Parallel_reducefun(void *total, void *part);
+
+extern void A2Parallel_map(WorkPool_T pool, A2Methods_T methods,
+                           A2Methods_UArray2 array2,
+                           A2Methods_applyfun apply, void *cl, int clsize,
+                           A2Parallel_reducefun *reduce);
+
+#endif
@@ -13,6 +13,8 @@
 
 #include <string.h>
 #include <a2plain.h>
+#include "a2unchecked.h"
+#include "a2colmajor.h"
 #include "uarray2.h"
 
 
@@ -212,3 +214,106 @@ static struct A2Methods_T uarray2_methods_plain_struct = {
 /* the exported pointer to the struct */
 
 A2Methods_T uarray2_methods_plain = &uarray2_methods_plain_struct;
+
+/* 
+ * The unchecked variants: same representation and same new/free, but
+ * 'at' and the maps skip every null and bounds check
+ */
+
+static A2Methods_Object *at_unchecked(A2Methods_UArray2 uarray2, int i, int j)
+{
+  return UArray2_at_unchecked(uarray2, i, j);
+}
+
+static void map_row_major_unchecked(A2Methods_UArray2 uarray2,
+                                    A2Methods_applyfun apply,
+                                    void *cl)
+{
+  UArray2_map_row_major_unchecked(uarray2, (UArray2_applyfun*)apply, cl);
+}
+
+static void map_col_major_unchecked(A2Methods_UArray2 uarray2,
+                                    A2Methods_applyfun apply,
+                                    void *cl)
+{
+  UArray2_map_col_major_unchecked(uarray2, (UArray2_applyfun*)apply, cl);
+}
+
+static void small_map_row_major_unchecked(A2Methods_UArray2        a2,
+                                          A2Methods_smallapplyfun  apply,
+                                          void *cl)
+{
+  struct small_closure mycl = { apply, cl };
+  UArray2_map_row_major_unchecked(a2, apply_small, &mycl);
+}
+
+static void small_map_col_major_unchecked(A2Methods_UArray2        a2,
+                                          A2Methods_smallapplyfun  apply,
+                                          void *cl)
+{
+  struct small_closure mycl = { apply, cl };
+  UArray2_map_col_major_unchecked(a2, apply_small, &mycl);
+}
+
+static struct A2Methods_T uarray2_methods_plain_unchecked_struct = {
+    new,
+    new_with_blocksize,
+    a2free,
+    width,
+    height,
+    size,
+    blocksize,
+    at_unchecked,
+    map_row_major_unchecked,
+    map_col_major_unchecked,
+    NULL,
+    map_row_major_unchecked,            /* map_default */
+    small_map_row_major_unchecked,
+    small_map_col_major_unchecked,
+    NULL,
+    small_map_row_major_unchecked,      /* small_map_default */
+};
+
+A2Methods_T uarray2_methods_plain_unchecked =
+        &uarray2_methods_plain_unchecked_struct;
+
+/* 
+ * The column-major variant: arrays store columns rather than rows, so
+ * the default maps walk by columns. 'at' and the maps are shared, since
+ * UArray2 finds cells in either storage order
+ */
+
+static A2Methods_UArray2 new_col_major(int width, int height, int size)
+{
+  return UArray2_new_col_major(width, height, size);
+}
+
+static A2Methods_UArray2 new_col_major_with_blocksize(int width,
+                                                      int height,
+                                                      int size,
+                                                      int blocksize)
+{
+  (void) blocksize;
+  return UArray2_new_col_major(width, height, size);
+}
+
+static struct A2Methods_T uarray2_methods_colmajor_struct = {
+    new_col_major,
+    new_col_major_with_blocksize,
+    a2free,
+    width,
+    height,
+    size,
+    blocksize,
+    at,
+    map_row_major,
+    map_col_major,
+    NULL,
+    map_col_major,      /* map_default */
+    small_map_row_major,
+    small_map_col_major,
+    NULL,
+    small_map_col_major,        /* small_map_default */
+};
+
+A2Methods_T uarray2_methods_colmajor = &uarray2_methods_colmajor_struct;
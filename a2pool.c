@@ -0,0 +1,130 @@
+/*
+ *                              a2pool
+ *
+ *   Purpose:
+ *
+ *     Implementation of the A2 array pool. Idle arrays are kept in a
+ *     small fixed-capacity table; a request is served by the first
+ *     idle array whose width, height and element size match, or by a
+ *     freshly allocated array otherwise. When the table is full the
+ *     oldest idle array is released to make room.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "assert.h"
+#include "mem.h"
+#include "a2pool.h"
+
+#define T A2Pool_T
+
+typedef A2Methods_UArray2 A2;
+
+struct T {
+    A2Methods_T methods;  /* representation of every pooled array */
+    int capacity;         /* maximum number of idle arrays kept */
+    int count;            /* number of idle arrays currently kept */
+    A2 *idle;             /* idle arrays, oldest first */
+    pthread_mutex_t lock; /* guards count and idle */
+};
+
+/* Function: A2Pool_new
+ * Purpose: Creates an empty pool of arrays of one representation
+ * Arguments: The methods used to create and free pooled arrays,
+ *            the maximum number of idle arrays to keep
+ * Returns: A new A2Pool
+ */
+T A2Pool_new(A2Methods_T methods, int capacity)
+{
+    assert(methods != NULL);
+    assert(capacity > 0);
+    T pool;
+    NEW(pool);
+    pool->methods = methods;
+    pool->capacity = capacity;
+    pool->count = 0;
+    pool->idle = CALLOC(capacity, sizeof(A2));
+    pthread_mutex_init(&pool->lock, NULL);
+    return pool;
+}
+
+/* Function: A2Pool_free
+ * Purpose: Frees the pool and every idle array it holds. Arrays that
+ *          are still checked out belong to their callers.
+ * Arguments: A pointer to the pool to free
+ * Returns: none
+ */
+void A2Pool_free(T *pool)
+{
+    assert(pool != NULL && *pool != NULL);
+    for (int i = 0; i < (*pool)->count; i++) {
+        (*pool)->methods->free(&(*pool)->idle[i]);
+    }
+    pthread_mutex_destroy(&(*pool)->lock);
+    FREE((*pool)->idle);
+    FREE(*pool);
+}
+
+/* Function: A2Pool_get
+ * Purpose: Checks out an array of the given shape, reusing an idle one
+ *          when possible. The contents of a reused array are whatever
+ *          its previous user left behind.
+ * Arguments: The pool, the width, height and element size wanted
+ * Returns: An A2 array owned by the caller until it is put back
+ */
+A2 A2Pool_get(T pool, int width, int height, int size)
+{
+    assert(pool != NULL);
+    A2Methods_T methods = pool->methods;
+    A2 found = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    for (int i = pool->count - 1; i >= 0; i--) {
+        A2 candidate = pool->idle[i];
+        if (methods->width(candidate) == width &&
+            methods->height(candidate) == height &&
+            methods->size(candidate) == size) {
+            found = candidate;
+            for (int k = i + 1; k < pool->count; k++) {
+                pool->idle[k - 1] = pool->idle[k];
+            }
+            pool->count--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (found == NULL) {
+        found = methods->new(width, height, size);
+    }
+    return found;
+}
+
+/* Function: A2Pool_put
+ * Purpose: Returns an array to the pool for later reuse
+ * Arguments: The pool, an array created with the pool's methods
+ * Returns: none
+ */
+void A2Pool_put(T pool, A2 array2)
+{
+    assert(pool != NULL && array2 != NULL);
+    A2 evicted = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == pool->capacity) {
+        evicted = pool->idle[0];
+        for (int i = 1; i < pool->count; i++) {
+            pool->idle[i - 1] = pool->idle[i];
+        }
+        pool->count--;
+    }
+    pool->idle[pool->count++] = array2;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (evicted != NULL) {
+        pool->methods->free(&evicted);
+    }
+}
@@ -0,0 +1,29 @@
+/*
+ *                              a2pool
+ *
+ *   Purpose:
+ *
+ *     Interface to a pool of A2 arrays that are kept alive between
+ *     uses, so that a long-running job transforming many images of
+ *     the same shape pays for allocation and first-touch page faults
+ *     only once. A pool may be shared between threads.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef A2POOL_INCLUDED
+#define A2POOL_INCLUDED
+
+#include "a2methods.h"
+
+#define T A2Pool_T
+typedef struct T *T;
+
+extern T    A2Pool_new (A2Methods_T methods, int capacity);
+extern void A2Pool_free(T *pool);
+extern A2Methods_UArray2 A2Pool_get(T pool, int width, int height, int size);
+extern void A2Pool_put (T pool, A2Methods_UArray2 array2);
+
+#undef T
+#endif
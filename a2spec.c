@@ -0,0 +1,313 @@
+/*
+ *                              a2spec
+ *
+ *   Purpose:
+ *
+ *     Defines, for each specialized element size, a struct of function
+ *     pointers for plain and for blocked UArray2s arrays. The tables
+ *     are generated by the A2SPEC_METHODS macro so that every entry
+ *     calls the inline accessor and map of its own size.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include "assert.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "uarray2spec.h"
+#include "a2spec.h"
+
+typedef A2Methods_UArray2 A2;
+
+/* struct small_closure
+* A struct to hold a small apply function along with its closure
+*/
+struct small_closure {
+    A2Methods_smallapplyfun *apply;
+    void *cl;
+};
+
+static void apply_small(int i, int j, UArray2s_T array2, void *elem,
+                        void *vcl)
+{
+    struct small_closure *cl = vcl;
+    (void)i;
+    (void)j;
+    (void)array2;
+    cl->apply(elem, cl->cl);
+}
+
+/* Functions shared by every size */
+
+static void a2free(A2 *array2p)
+{
+    UArray2s_free((UArray2s_T *)array2p);
+}
+
+static int width(A2 array2)
+{
+    assert(array2 != NULL);
+    return ((UArray2s_T)array2)->width;
+}
+
+static int height(A2 array2)
+{
+    assert(array2 != NULL);
+    return ((UArray2s_T)array2)->height;
+}
+
+static int size(A2 array2)
+{
+    assert(array2 != NULL);
+    return ((UArray2s_T)array2)->size;
+}
+
+static int blocksize(A2 array2)
+{
+    assert(array2 != NULL);
+    return ((UArray2s_T)array2)->blocksize;
+}
+
+/* Function: blocksize64K
+ * Purpose: Picks the largest square block of at most 64KB, no larger
+ *          than the array itself
+ * Arguments: The width, height and element size
+ * Returns: The blocksize
+ */
+static int blocksize64K(int width, int height, int size)
+{
+    int blocksize = sqrt(65536 / size);
+    int longest = width > height ? width : height;
+    if (blocksize > longest) {
+        blocksize = longest;
+    }
+    return blocksize < 1 ? 1 : blocksize;
+}
+
+/*
+ * A2SPEC_METHODS(N) defines the plain and blocked tables for cells of
+ * N bytes: a2spec_plain_N and a2spec_blocked_N
+ */
+#define A2SPEC_METHODS(N)                                                   \
+static A2 plain_new_##N(int width, int height, int size)                    \
+{                                                                           \
+    assert(size == N);                                                      \
+    (void)size;                                                             \
+    return UArray2s_new(width, height, N);                                  \
+}                                                                           \
+static A2 plain_new_with_blocksize_##N(int width, int height, int size,     \
+                                       int blocksize)                       \
+{                                                                           \
+    (void)blocksize;                                                        \
+    return plain_new_##N(width, height, size);                              \
+}                                                                           \
+static A2 blocked_new_##N(int width, int height, int size)                  \
+{                                                                           \
+    assert(size == N);                                                      \
+    (void)size;                                                             \
+    return UArray2s_new_blocked(width, height, N,                           \
+                                blocksize64K(width, height, N));            \
+}                                                                           \
+static A2 blocked_new_with_blocksize_##N(int width, int height, int size,   \
+                                         int blocksize)                     \
+{                                                                           \
+    assert(size == N);                                                      \
+    (void)size;                                                             \
+    return UArray2s_new_blocked(width, height, N, blocksize);               \
+}                                                                           \
+static A2Methods_Object *plain_at_##N(A2 array2, int i, int j)              \
+{                                                                           \
+    return UArray2s_at_##N(array2, i, j);                                   \
+}                                                                           \
+static A2Methods_Object *blocked_at_##N(A2 array2, int i, int j)            \
+{                                                                           \
+    return UArray2s_blocked_at_##N(array2, i, j);                           \
+}                                                                           \
+static void map_row_major_##N(A2 array2, A2Methods_applyfun apply,          \
+                              void *cl)                                     \
+{                                                                           \
+    UArray2s_map_row_major_##N(array2, (UArray2s_applyfun *)apply, cl);     \
+}                                                                           \
+static void map_col_major_##N(A2 array2, A2Methods_applyfun apply,          \
+                              void *cl)                                     \
+{                                                                           \
+    UArray2s_map_col_major_##N(array2, (UArray2s_applyfun *)apply, cl);     \
+}                                                                           \
+static void map_block_major_##N(A2 array2, A2Methods_applyfun apply,        \
+                                void *cl)                                   \
+{                                                                           \
+    UArray2s_map_block_major_##N(array2, (UArray2s_applyfun *)apply, cl);   \
+}                                                                           \
+static void small_map_row_major_##N(A2 array2,                              \
+                                    A2Methods_smallapplyfun apply,          \
+                                    void *cl)                               \
+{                                                                           \
+    struct small_closure mycl = { apply, cl };                              \
+    UArray2s_map_row_major_##N(array2, apply_small, &mycl);                 \
+}                                                                           \
+static void small_map_col_major_##N(A2 array2,                              \
+                                    A2Methods_smallapplyfun apply,          \
+                                    void *cl)                               \
+{                                                                           \
+    struct small_closure mycl = { apply, cl };                              \
+    UArray2s_map_col_major_##N(array2, apply_small, &mycl);                 \
+}                                                                           \
+static void small_map_block_major_##N(A2 array2,                            \
+                                      A2Methods_smallapplyfun apply,        \
+                                      void *cl)                             \
+{                                                                           \
+    struct small_closure mycl = { apply, cl };                              \
+    UArray2s_map_block_major_##N(array2, apply_small, &mycl);               \
+}                                                                           \
+static struct A2Methods_T a2spec_plain_##N = {                              \
+    plain_new_##N,                                                          \
+    plain_new_with_blocksize_##N,                                           \
+    a2free,                                                                 \
+    width,                                                                  \
+    height,                                                                 \
+    size,                                                                   \
+    blocksize,                                                              \
+    plain_at_##N,                                                           \
+    map_row_major_##N,                                                      \
+    map_col_major_##N,                                                      \
+    NULL,                                                                   \
+    map_row_major_##N,          /* map_default */                           \
+    small_map_row_major_##N,                                                \
+    small_map_col_major_##N,                                                \
+    NULL,                                                                   \
+    small_map_row_major_##N,    /* small_map_default */                     \
+};                                                                          \
+static struct A2Methods_T a2spec_blocked_##N = {                            \
+    blocked_new_##N,                                                        \
+    blocked_new_with_blocksize_##N,                                         \
+    a2free,                                                                 \
+    width,                                                                  \
+    height,                                                                 \
+    size,                                                                   \
+    blocksize,                                                              \
+    blocked_at_##N,                                                         \
+    NULL,                       /* map_row_major */                         \
+    NULL,                       /* map_col_major */                         \
+    map_block_major_##N,                                                    \
+    map_block_major_##N,        /* map_default */                           \
+    NULL,                       /* small_map_row_major */                   \
+    NULL,                       /* small_map_col_major */                   \
+    small_map_block_major_##N,                                              \
+    small_map_block_major_##N,  /* small_map_default */                     \
+};
+
+A2SPEC_METHODS(1)
+A2SPEC_METHODS(2)
+A2SPEC_METHODS(4)
+A2SPEC_METHODS(8)
+A2SPEC_METHODS(12)
+
+/* Struct specTables
+* The plain and blocked tables of one element size
+*/
+static struct specTables {
+    int size;
+    A2Methods_T plain;
+    A2Methods_T blocked;
+} tables[] = {
+    { 1,  &a2spec_plain_1,  &a2spec_blocked_1  },
+    { 2,  &a2spec_plain_2,  &a2spec_blocked_2  },
+    { 4,  &a2spec_plain_4,  &a2spec_blocked_4  },
+    { 8,  &a2spec_plain_8,  &a2spec_blocked_8  },
+    { 12, &a2spec_plain_12, &a2spec_blocked_12 },
+};
+
+#define NUM_TABLES ((int)(sizeof(tables) / sizeof(tables[0])))
+
+/* Function: A2Spec_plain
+ * Purpose: Finds the plain table for an element size
+ * Arguments: The element size in bytes
+ * Returns: The table, or NULL if that size is not specialized
+ */
+A2Methods_T A2Spec_plain(int size)
+{
+    for (int i = 0; i < NUM_TABLES; i++) {
+        if (tables[i].size == size) {
+            return tables[i].plain;
+        }
+    }
+    return NULL;
+}
+
+/* Function: A2Spec_blocked
+ * Purpose: Finds the blocked table for an element size
+ * Arguments: The element size in bytes
+ * Returns: The table, or NULL if that size is not specialized
+ */
+A2Methods_T A2Spec_blocked(int size)
+{
+    for (int i = 0; i < NUM_TABLES; i++) {
+        if (tables[i].size == size) {
+            return tables[i].blocked;
+        }
+    }
+    return NULL;
+}
+
+/* Function: A2Spec_size
+ * Purpose: Tells whether a methods table is one of the specialized
+ *          tables, and for which element size
+ * Arguments: Any methods table
+ * Returns: The element size, or 0 for a table defined elsewhere
+ */
+int A2Spec_size(A2Methods_T methods)
+{
+    for (int i = 0; i < NUM_TABLES; i++) {
+        if (tables[i].plain == methods || tables[i].blocked == methods) {
+            return tables[i].size;
+        }
+    }
+    return 0;
+}
+
+/* Function: A2Spec_isBlocked
+ * Purpose: Tells whether a specialized table stores blocks
+ * Arguments: A table for which A2Spec_size is nonzero
+ * Returns: 1 for a blocked table, 0 for a plain one
+ */
+int A2Spec_isBlocked(A2Methods_T methods)
+{
+    return A2Spec_size(methods) != 0 && methods->map_block_major != NULL;
+}
+
+/* Function: A2Spec_specialize
+ * Purpose: Swaps the UArray2 or UArray2b methods for the specialized
+ *          table of the same layout, together with the matching map
+ * Arguments: The methods, a pointer to the chosen mapping function of
+ *            those methods, the element size the arrays will hold
+ * Returns: The specialized table, with *map updated; the original
+ *          methods if there is no specialization for them
+ */
+A2Methods_T A2Spec_specialize(A2Methods_T methods, A2Methods_mapfun **map,
+                              int size)
+{
+    assert(methods != NULL && map != NULL);
+    A2Methods_T spec = NULL;
+    if (methods == uarray2_methods_plain) {
+        spec = A2Spec_plain(size);
+    } else if (methods == uarray2_methods_blocked) {
+        spec = A2Spec_blocked(size);
+    }
+    if (spec == NULL) {
+        return methods;
+    }
+
+    if (*map == methods->map_row_major) {
+        *map = spec->map_row_major;
+    } else if (*map == methods->map_col_major) {
+        *map = spec->map_col_major;
+    } else if (*map == methods->map_block_major) {
+        *map = spec->map_block_major;
+    } else {
+        *map = spec->map_default;
+    }
+    return spec;
+}
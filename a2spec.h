@@ -0,0 +1,29 @@
+/*
+ *                              a2spec
+ *
+ *   Purpose:
+ *
+ *     A2Methods tables for UArray2s arrays specialized by element
+ *     size. A plain table stores rows contiguously and supports
+ *     row- and column-major maps; a blocked table stores blocks
+ *     contiguously and supports block-major maps. Tables exist for
+ *     element sizes 1, 2, 4, 8 and 12; a table only accepts arrays
+ *     of its own element size.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef A2SPEC_INCLUDED
+#define A2SPEC_INCLUDED
+
+#include "a2methods.h"
+
+extern A2Methods_T A2Spec_plain  (int size);
+extern A2Methods_T A2Spec_blocked(int size);
+extern int         A2Spec_size   (A2Methods_T methods);
+extern int         A2Spec_isBlocked(A2Methods_T methods);
+extern A2Methods_T A2Spec_specialize(A2Methods_T methods,
+                                     A2Methods_mapfun **map, int size);
+
+#endif
@@ -4,6 +4,22 @@
 #include "a2methods.h"
 #include "a2plain.h"
 #include "a2blocked.h"
+#include "a2spec.h"
+#include "a2unchecked.h"
+#include "a2colmajor.h"
+#include "uarray2.h"
+#include "uarray2b.h"
+#include "a2view.h"
+#include "a2parallel.h"
+#include "a2disk.h"
+#include "uarray2file.h"
+#include "a2compressed.h"
+#include "uarray2z.h"
+#include "a2batch.h"
+#include "a2convert.h"
+#include "ppmio.h"
+#include "graymap.h"
+#include "mem.h"
 
 
 #define W 13
@@ -161,12 +177,442 @@ static void test_methods(A2Methods_T methods_under_test)
         methods->free(&array);
 }
 
+/* Cell (i, j) of a cropped then rotated view is read back both
+ * through the view and from its materialized copy
+ */
+static void test_views(A2Methods_T base_methods)
+{
+        methods = base_methods;
+        A2 array = methods->new(W, H, sizeof(unsigned));
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        copy_unsigned(methods, array, i, j, 1000 * i + j);
+                }
+        }
+        /* 5x4 window at (2, 3), then a 90 degree rotation: view cell
+         * (i, j) is window cell (j, 3 - i), array cell (2 + j, 6 - i)
+         */
+        A2 window = A2View_crop(methods, array, 2, 3, 5, 4);
+        A2 rotated = A2View_rotate(a2view_methods, window, 90);
+        a2view_methods->free(&window);
+        A2 copy = A2View_materialize(rotated, methods, NULL);
+        assert(a2view_methods->width(rotated) == 4);
+        assert(a2view_methods->height(rotated) == 5);
+        for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 5; j++) {
+                        unsigned n = 1000 * (2 + j) + (6 - i);
+                        unsigned *p = a2view_methods->at(rotated, i, j);
+                        assert(*p == n);
+                        check(copy, i, j, n);
+                }
+        }
+        /* flips and transposes undo themselves */
+        A2 flipped = A2View_flip(a2view_methods, rotated, 1);
+        A2 back = A2View_flip(a2view_methods, flipped, 1);
+        A2 twice = A2View_transpose(a2view_methods, back);
+        A2 thrice = A2View_transpose(a2view_methods, twice);
+        for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 5; j++) {
+                        assert(a2view_methods->at(thrice, i, j) ==
+                               a2view_methods->at(rotated, i, j));
+                }
+        }
+        a2view_methods->free(&thrice);
+        a2view_methods->free(&twice);
+        a2view_methods->free(&back);
+        a2view_methods->free(&flipped);
+        a2view_methods->free(&rotated);
+        methods->free(&copy);
+        methods->free(&array);
+}
+
+static void bump_and_sum(int i, int j, A2 a, void *elem, void *cl)
+{
+        (void)a;
+        unsigned *p = elem;
+        unsigned long *sum = cl;
+        assert(*p == 1000 * (unsigned)i + j);
+        *p += 1;                /* every cell is visited exactly once */
+        *sum += *p;
+}
+
+static void add_sums(void *total, void *part)
+{
+        *(unsigned long *)total += *(unsigned long *)part;
+}
+
+/* Parallel maps visit every cell once and reduce per-thread sums */
+static void test_parallel(A2Methods_T methods_under_test, WorkPool_T pool)
+{
+        methods = methods_under_test;
+        A2 array = methods->new_with_blocksize(W, H, sizeof(unsigned), BS);
+        unsigned long expected = 0;
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        copy_unsigned(methods, array, i, j, 1000 * i + j);
+                        expected += 1000 * i + j + 1;
+                }
+        }
+        unsigned long sum = 0;
+        A2Parallel_map(pool, methods, array, bump_and_sum, &sum,
+                       sizeof(sum), add_sums);
+        assert(sum == expected);
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        check(array, i, j, 1000 * i + j + 1);
+                }
+        }
+        methods->free(&array);
+}
+
+static void check_disk_cell(int i, int j, A2 a, void *elem, void *cl)
+{
+        (void)a;
+        (void)cl;
+        assert(*(unsigned *)elem == 1000 * (unsigned)i + j);
+}
+
+/* A file-backed array with the smallest cache keeps its cells through
+ * evictions, whatever the order they are written and read in
+ */
+static void test_disk(void)
+{
+        methods = uarray2_methods_disk;
+        UArray2f_configure(1, NULL);    /* as few frames as allowed */
+        A2 array = methods->new_with_blocksize(10 * W, 10 * H,
+                                               sizeof(unsigned), BS);
+        for (int i = 0; i < 10 * W; i++) {      /* column by column */
+                for (int j = 0; j < 10 * H; j++) {
+                        copy_unsigned(methods, array, i, j, 1000 * i + j);
+                }
+        }
+        for (int j = 0; j < 10 * H; j++) {
+                for (int i = 0; i < 10 * W; i++) {
+                        check(array, i, j, 1000 * i + j);
+                }
+        }
+        methods->map_default(array, check_disk_cell, NULL);
+        long reads, writes;
+        UArray2f_traffic(array, &reads, &writes);
+        assert(reads > 0 && writes > 0);
+        methods->free(&array);
+        UArray2f_configure(64L << 20, NULL);
+}
+
+/* A compressed array keeps varied cells through packing and unpacking,
+ * and holds a flat array as one cell per block
+ */
+static void test_compressed(void)
+{
+        methods = uarray2_methods_compressed;
+        A2 array = methods->new_with_blocksize(10 * W, 10 * H,
+                                               sizeof(unsigned), BS);
+        for (int i = 0; i < 10 * W; i++) {      /* column by column */
+                for (int j = 0; j < 10 * H; j++) {
+                        copy_unsigned(methods, array, i, j, 1000 * i + j);
+                }
+        }
+        for (int j = 0; j < 10 * H; j++) {
+                for (int i = 0; i < 10 * W; i++) {
+                        check(array, i, j, 1000 * i + j);
+                }
+        }
+        methods->map_default(array, check_disk_cell, NULL);
+
+        long blocks = ((10 * W + BS - 1) / BS) * ((10 * H + BS - 1) / BS);
+        for (int i = 0; i < 10 * W; i++) {
+                for (int j = 0; j < 10 * H; j++) {
+                        copy_unsigned(methods, array, i, j, 7);
+                }
+        }
+        assert(UArray2z_packedBytes(array) ==
+               blocks * (long)sizeof(unsigned));
+        copy_unsigned(methods, array, 3, 2, 8);
+        long packed = UArray2z_packedBytes(array);
+        assert(packed > blocks * (long)sizeof(unsigned));
+        assert(packed < (blocks + 1) * (long)sizeof(unsigned) * BS * BS);
+        check(array, 3, 2, 8);
+        check(array, 2, 3, 7);
+        methods->free(&array);
+}
+
+/* A batch finds the cells 'at' does, and gather and scatter move cells
+ * in and out in the batch's order, across several chunks. A cached
+ * array (file-backed or compressed) is only gathered and scattered:
+ * consecutive cells of the batch lie in different blocks, far more of
+ * them than the cache holds.
+ */
+static void test_batch(A2Methods_T methods_under_test)
+{
+        bool cached = methods_under_test == uarray2_methods_disk ||
+                      methods_under_test == uarray2_methods_compressed;
+        methods = methods_under_test;
+        int width = 10 * W, height = 10 * H, n = width * height;
+        A2 array = methods->new_with_blocksize(width, height,
+                                               sizeof(unsigned), BS);
+        A2Batch_coord *coords = ALLOC(n * sizeof(*coords));
+        unsigned *values = ALLOC(n * sizeof(unsigned));
+        void **cells = ALLOC(n * sizeof(void *));
+        for (int k = 0; k < n; k++) {   /* every cell, scrambled */
+                int cell = (int)((7919L * k) % n);
+                coords[k].i = cell % width;
+                coords[k].j = cell / width;
+                values[k] = 1000 * coords[k].i + coords[k].j;
+        }
+        A2Batch_scatter(methods, array, coords, n, values);
+        for (int i = 0; i < width; i++) {
+                for (int j = 0; j < height; j++) {
+                        check(array, i, j, 1000 * i + j);
+                }
+        }
+        if (!cached) {
+                A2Batch_at(methods, array, coords, n, cells);
+        }
+        for (int k = 0; k < n; k++) {
+                assert(cached || cells[k] == methods->at(array, coords[k].i,
+                                                         coords[k].j));
+                values[k] = 0;
+        }
+        A2Batch_gather(methods, array, coords, n, values);
+        for (int k = 0; k < n; k++) {
+                assert(values[k] ==
+                       1000 * (unsigned)coords[k].i + coords[k].j);
+        }
+        FREE(cells);
+        FREE(values);
+        FREE(coords);
+        methods->free(&array);
+}
+
+/* A view of a cached array is gathered one cell at a time too: a
+ * rotated view turns each row of the batch into a column of blocks
+ */
+static void test_batch_view(A2Methods_T base_methods)
+{
+        int width = 10 * W, height = 10 * H, n = width * height;
+        A2 base = base_methods->new_with_blocksize(width, height,
+                                                   sizeof(unsigned), BS);
+        for (int i = 0; i < width; i++) {
+                for (int j = 0; j < height; j++) {
+                        copy_unsigned(base_methods, base, i, j,
+                                      1000 * i + j);
+                }
+        }
+        A2 view = A2View_rotate(base_methods, base, 90);
+        A2Batch_coord *coords = ALLOC(n * sizeof(*coords));
+        unsigned *values = ALLOC(n * sizeof(unsigned));
+        for (int k = 0; k < n; k++) {   /* view coordinates, by rows */
+                coords[k].i = k % height;
+                coords[k].j = k / height;
+        }
+        A2Batch_gather(a2view_methods, view, coords, n, values);
+        for (int k = 0; k < n; k++) {   /* view (i, j) is base (j, h-1-i) */
+                assert(values[k] == 1000 * (unsigned)coords[k].j +
+                                    (height - 1 - coords[k].i));
+        }
+        FREE(values);
+        FREE(coords);
+        a2view_methods->free(&view);
+        base_methods->free(&base);
+}
+
+/* A conversion keeps every cell, between layouts whose blocks and rows
+ * are cut in different places
+ */
+static void test_convert(A2Methods_T from, A2Methods_T to)
+{
+        methods = from;
+        A2 source = methods->new_with_blocksize(10 * W, 10 * H,
+                                                sizeof(unsigned), BS);
+        for (int i = 0; i < 10 * W; i++) {
+                for (int j = 0; j < 10 * H; j++) {
+                        copy_unsigned(methods, source, i, j, 1000 * i + j);
+                }
+        }
+        A2 copy = to->new_with_blocksize(10 * W, 10 * H, sizeof(unsigned),
+                                         BS + 3);
+        A2Convert_copy(from, source, to, copy);
+        methods->free(&source);
+        methods = to;
+        methods->map_default(copy, check_disk_cell, NULL);
+        methods->free(&copy);
+}
+
+/* A column-major UArray2 keeps each column contiguous, and its
+ * unchecked access agrees with the checked one
+ */
+static void test_col_storage(void)
+{
+        UArray2_T array = UArray2_new_col_major(W, H, sizeof(unsigned));
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        char *cell = UArray2_at(array, i, j);
+                        assert(UArray2_at_unchecked(array, i, j) == cell);
+                        assert(j == 0 || cell == (char *)UArray2_at(array,
+                                        i, j - 1) + sizeof(unsigned));
+                }
+        }
+        UArray2_free(&array);
+}
+
+/* Rows and blocks of four cache lines are padded apart: every cell is
+ * still reached, by 'at' and by the maps, and the stride is an odd
+ * number of lines
+ */
+static void test_padding(A2Methods_T methods_under_test)
+{
+        methods = methods_under_test;
+        int side = 64;  /* 64 unsigneds, and 8 x 8 blocks, are 256 bytes */
+        A2 array = methods->new_with_blocksize(side, side, sizeof(unsigned),
+                                               8);
+        for (int i = 0; i < side; i++) {
+                for (int j = 0; j < side; j++) {
+                        copy_unsigned(methods, array, i, j, 1000 * i + j);
+                }
+        }
+        methods->map_default(array, check_disk_cell, NULL);
+        methods->free(&array);
+}
+
+/* The strides chosen by the UArray2 and UArray2b constructors, and one
+ * given to UArray2_new_with_pitch
+ */
+static void test_pitch(void)
+{
+        UArray2_T rows = UArray2_new(64, 3, sizeof(unsigned));
+        long pitch = (char *)UArray2_row(rows, 1) -
+                     (char *)UArray2_row(rows, 0);
+        assert(pitch > 64 * (long)sizeof(unsigned) && pitch % 128 == 64);
+        for (int j = 0; j < 3; j++) {
+                for (int i = 0; i < 64; i++) {
+                        char *cell = UArray2_at(rows, i, j);
+                        assert(UArray2_at_unchecked(rows, i, j) == cell);
+                        assert(cell == (char *)UArray2_row(rows, j) +
+                                       i * sizeof(unsigned));
+                }
+        }
+        UArray2_free(&rows);
+
+        rows = UArray2_new_with_pitch(W, H, sizeof(unsigned), W + 3);
+        assert((char *)UArray2_at(rows, 0, 2) ==
+               (char *)UArray2_at(rows, 0, 0) + 2 * (W + 3) *
+                                                sizeof(unsigned));
+        UArray2_free(&rows);
+
+        UArray2b_T blocks = UArray2b_new(W, H, sizeof(unsigned), 8);
+        long stride = (char *)UArray2b_block(blocks, 1, 0) -
+                      (char *)UArray2b_block(blocks, 0, 0);
+        assert(stride > 8 * 8 * (long)sizeof(unsigned) && stride % 128 == 64);
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        char *cell = UArray2b_at(blocks, i, j);
+                        assert(UArray2b_at_unchecked(blocks, i, j) == cell);
+                        assert(cell == (char *)UArray2b_block(blocks, i / 8,
+                                                              j / 8) +
+                                       (j % 8 * 8 + i % 8) *
+                                       sizeof(unsigned));
+                }
+        }
+        UArray2b_free(&blocks);
+}
+
+/* Reads a one-row P6 image of the given samples and denominator
+ * through PpmIO, returning the pixels (NULL if rejected)
+ */
+static Pnm_ppm read_raw(const char *samples, int count, unsigned denominator)
+{
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        fprintf(fp, "P6\n%d 1\n%u\n", count / 3, denominator);
+        fwrite(samples, 1, count, fp);
+        rewind(fp);
+        struct PpmIO_header header;
+        assert(PpmIO_readHeader(fp, &header));
+        Pnm_ppm image = PpmIO_readPixels(fp, &header, uarray2_methods_plain,
+                                         0, NULL);
+        fclose(fp);
+        return image;
+}
+
+/* 8-bit P6 samples above the denominator are rejected, as 16-bit ones
+ * are; samples up to it are read
+ */
+static void test_ppmio_range(void)
+{
+        Pnm_ppm image = read_raw("\x00\x64\xc8\xc8\x01\x02", 6, 200);
+        assert(image != NULL && image->width == 2);
+        struct Pnm_rgb *pixel = image->methods->at(image->pixels, 0, 0);
+        assert(pixel->red == 0 && pixel->green == 100 && pixel->blue == 200);
+        Pnm_ppmfree(&image);
+        assert(read_raw("\x00\x64\xc8\xc9\x01\x02", 6, 200) == NULL);
+}
+
+/* The same for raw 8-bit PGM samples */
+static void test_graymap_range(void)
+{
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        fputs("P5\n2 1\n100\n\x64\x05P5\n2 1\n100\n\xff\x05", fp);
+        rewind(fp);
+        struct PpmIO_header header;
+        assert(PpmIO_readHeader(fp, &header));
+        Graymap_T image = Graymap_read(fp, &header);
+        assert(image != NULL && Graymap_width(image) == 2);
+        Graymap_free(&image);
+        assert(PpmIO_readHeader(fp, &header));
+        assert(Graymap_read(fp, &header) == NULL);
+        fclose(fp);
+}
+
 int main(int argc, char *argv[])
 {
         assert(argc == 1);
         (void)argv;
         test_methods(uarray2_methods_plain);
         test_methods(uarray2_methods_blocked);
+        test_methods(A2Spec_plain(sizeof(unsigned)));
+        test_methods(A2Spec_blocked(sizeof(unsigned)));
+        test_methods(uarray2_methods_plain_unchecked);
+        test_methods(uarray2_methods_colmajor);
+        test_col_storage();
+        test_pitch();
+        test_padding(uarray2_methods_plain);
+        test_padding(uarray2_methods_plain_unchecked);
+        test_padding(uarray2_methods_colmajor);
+        test_padding(uarray2_methods_blocked);
+        test_padding(uarray2_methods_blocked_unchecked);
+        test_padding(A2Spec_plain(sizeof(unsigned)));
+        test_padding(A2Spec_blocked(sizeof(unsigned)));
+        test_methods(uarray2_methods_blocked_unchecked);
+        test_methods(a2view_methods);
+        test_methods(uarray2_methods_disk);
+        test_disk();
+        test_methods(uarray2_methods_compressed);
+        test_compressed();
+        test_batch(uarray2_methods_plain);
+        test_batch(A2Spec_plain(sizeof(unsigned)));
+        test_batch(A2Spec_blocked(sizeof(unsigned)));
+        UArray2f_configure(1, NULL);    /* as few frames as allowed */
+        test_batch(uarray2_methods_disk);
+        test_batch_view(uarray2_methods_disk);
+        UArray2f_configure(64L << 20, NULL);
+        test_batch(uarray2_methods_compressed);
+        test_ppmio_range();
+        test_graymap_range();
+        test_convert(uarray2_methods_plain, uarray2_methods_blocked);
+        test_convert(uarray2_methods_blocked, A2Spec_plain(sizeof(unsigned)));
+        test_convert(A2Spec_blocked(sizeof(unsigned)),
+                     A2Spec_blocked(sizeof(unsigned)));
+        test_convert(A2Spec_plain(sizeof(unsigned)), uarray2_methods_disk);
+        test_convert(uarray2_methods_colmajor, uarray2_methods_plain);
+        test_views(uarray2_methods_plain);
+        test_views(uarray2_methods_blocked);
+        test_views(uarray2_methods_colmajor);
+        WorkPool_T pool = WorkPool_new(4);
+        test_parallel(uarray2_methods_plain, pool);
+        test_parallel(uarray2_methods_blocked, pool);
+        test_parallel(A2Spec_blocked(sizeof(unsigned)), pool);
+        WorkPool_free(&pool);
         printf("Passed.\n");  /* only if we reach this point without
                                * assertion failure
                                */
@@ -0,0 +1,25 @@
+/*
+ *                              a2unchecked
+ *
+ *   Purpose:
+ *
+ *     Unchecked counterparts of uarray2_methods_plain and
+ *     uarray2_methods_blocked. Arrays are the same UArray2 and
+ *     UArray2b objects, so a table may be swapped for its unchecked
+ *     twin at any time, but 'at' and the maps perform no null or
+ *     bounds checks. Use them in hot loops once the checked tables
+ *     have been exercised by the tests.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef A2UNCHECKED_INCLUDED
+#define A2UNCHECKED_INCLUDED
+
+#include "a2methods.h"
+
+extern A2Methods_T uarray2_methods_plain_unchecked;
+extern A2Methods_T uarray2_methods_blocked_unchecked;
+
+#endif
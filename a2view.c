@@ -0,0 +1,370 @@
+/*
+ *                              a2view
+ *
+ *   Purpose:
+ *
+ *     Implementation of zero-copy A2 views. Every view, whatever
+ *     stack of crops and orientations produced it, is an affine map
+ *     from view coordinates (i, j) to coordinates of one underlying
+ *     array:
+ *
+ *         x = x0 + xi * i + xj * j
+ *         y = y0 + yi * i + yj * j
+ *
+ *     where each step is -1, 0 or 1. Cropping or orienting a view
+ *     composes a new map onto the old one instead of nesting views.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "mem.h"
+#include "a2plain.h"
+#include "a2view.h"
+
+typedef A2Methods_UArray2 A2;
+
+typedef struct View {
+    A2Methods_T methods;  /* representation of the underlying array */
+    A2 base;              /* the underlying array, never a view */
+    int owned;            /* base was made by the view and dies with it */
+    int width, height;    /* shape of the view */
+    int x0, y0;           /* base position of view cell (0, 0) */
+    int xi, xj;           /* base column step per view column and row */
+    int yi, yj;           /* base row step per view column and row */
+} *View;
+
+/* Function: baseAt
+ * Purpose: Finds the base cell under view cell (i, j)
+ * Arguments: A view, in-bounds view coordinates
+ * Returns: A pointer to the element in the underlying array
+ */
+static inline void *baseAt(View view, int i, int j)
+{
+    return view->methods->at(view->base,
+                             view->x0 + view->xi * i + view->xj * j,
+                             view->y0 + view->yi * i + view->yj * j);
+}
+
+/* Function: compose
+ * Purpose: Builds a view of 'array2' whose cell (i, j) is the cell
+ *          (ax + aii * i + aij * j, ay + aji * i + ajj * j) of
+ *          'array2', flattening it if 'array2' is itself a view
+ * Arguments: The methods of 'array2', the array, the shape of the
+ *            new view, the map into 'array2' coordinates
+ * Returns: A new view
+ */
+static A2 compose(A2Methods_T methods, A2 array2, int width, int height,
+                  int ax, int ay, int aii, int aij, int aji, int ajj)
+{
+    assert(methods != NULL && array2 != NULL);
+    View view;
+    NEW(view);
+    view->owned = 0;
+    view->width = width;
+    view->height = height;
+
+    if (methods == a2view_methods) {
+        View inner = array2;
+        view->methods = inner->methods;
+        view->base = inner->base;
+        view->x0 = inner->x0 + inner->xi * ax + inner->xj * ay;
+        view->y0 = inner->y0 + inner->yi * ax + inner->yj * ay;
+        view->xi = inner->xi * aii + inner->xj * aji;
+        view->xj = inner->xi * aij + inner->xj * ajj;
+        view->yi = inner->yi * aii + inner->yj * aji;
+        view->yj = inner->yi * aij + inner->yj * ajj;
+    } else {
+        view->methods = methods;
+        view->base = array2;
+        view->x0 = ax;
+        view->y0 = ay;
+        view->xi = aii;
+        view->xj = aij;
+        view->yi = aji;
+        view->yj = ajj;
+    }
+    return view;
+}
+
+/* Function: A2View_crop
+ * Purpose: Makes a view of a rectangular window of an array
+ * Arguments: The methods of the array, the array, the column and row
+ *            of the window's top-left cell, the window's width and
+ *            height, which must lie inside the array
+ * Returns: A view whose cell (i, j) is the array's (x + i, y + j)
+ */
+A2 A2View_crop(A2Methods_T methods, A2 array2,
+               int x, int y, int width, int height)
+{
+    assert(methods != NULL && array2 != NULL);
+    assert(x >= 0 && y >= 0 && width >= 0 && height >= 0);
+    assert(x + width <= methods->width(array2));
+    assert(y + height <= methods->height(array2));
+    return compose(methods, array2, width, height, x, y, 1, 0, 0, 1);
+}
+
+/* Function: A2View_rotate
+ * Purpose: Makes a view of an array rotated clockwise, matching the
+ *          rotations of ppmtrans
+ * Arguments: The methods of the array, the array, and the rotation:
+ *            0, 90, 180 or 270
+ * Returns: A view of the rotated array
+ */
+A2 A2View_rotate(A2Methods_T methods, A2 array2, int rotation)
+{
+    assert(methods != NULL && array2 != NULL);
+    int w = methods->width(array2);
+    int h = methods->height(array2);
+
+    switch (rotation) {
+    case 0:
+        return compose(methods, array2, w, h, 0, 0, 1, 0, 0, 1);
+    case 90:
+        return compose(methods, array2, h, w, 0, h - 1, 0, 1, -1, 0);
+    case 180:
+        return compose(methods, array2, w, h, w - 1, h - 1, -1, 0, 0, -1);
+    case 270:
+        return compose(methods, array2, h, w, w - 1, 0, 0, -1, 1, 0);
+    default:
+        assert(0);
+        return NULL;
+    }
+}
+
+/* Function: A2View_flip
+ * Purpose: Makes a mirror-image view of an array
+ * Arguments: The methods of the array, the array, and nonzero to flip
+ *            top to bottom, zero to flip left to right
+ * Returns: A view of the flipped array
+ */
+A2 A2View_flip(A2Methods_T methods, A2 array2, int vertical)
+{
+    assert(methods != NULL && array2 != NULL);
+    int w = methods->width(array2);
+    int h = methods->height(array2);
+
+    if (vertical) {
+        return compose(methods, array2, w, h, 0, h - 1, 1, 0, 0, -1);
+    }
+    return compose(methods, array2, w, h, w - 1, 0, -1, 0, 0, 1);
+}
+
+/* Function: A2View_transpose
+ * Purpose: Makes a view of an array reflected across its main diagonal
+ * Arguments: The methods of the array, the array
+ * Returns: A view whose cell (i, j) is the array's (j, i)
+ */
+A2 A2View_transpose(A2Methods_T methods, A2 array2)
+{
+    assert(methods != NULL && array2 != NULL);
+    return compose(methods, array2,
+                   methods->height(array2), methods->width(array2),
+                   0, 0, 0, 1, 1, 0);
+}
+
+/* struct materialize_closure
+ * The view being copied out, and the size of its elements
+ */
+struct materialize_closure {
+    View view;
+    int size;
+};
+
+static void copyFromView(int i, int j, A2 array2, void *elem, void *vcl)
+{
+    struct materialize_closure *cl = vcl;
+    (void)array2;
+    memcpy(elem, baseAt(cl->view, i, j), cl->size);
+}
+
+/* Function: A2View_materialize
+ * Purpose: Copies a view into a new, contiguous array. The destination
+ *          is walked with the given map and each cell is read through
+ *          the view, so the writes follow the destination's layout.
+ * Arguments: The view, the methods of the new array, and one of their
+ *            mapping functions, or NULL for their default map
+ * Returns: A new array of 'methods' holding the view's cells
+ */
+A2 A2View_materialize(A2 view, A2Methods_T methods, A2Methods_mapfun *map)
+{
+    assert(view != NULL && methods != NULL);
+    View v = view;
+    int size = v->methods->size(v->base);
+    A2 dest = methods->new(v->width, v->height, size);
+    struct materialize_closure cl = { v, size };
+
+    if (map == NULL) {
+        map = methods->map_default;
+    }
+    map(dest, copyFromView, &cl);
+    return dest;
+}
+
+/* Function: A2View_baseMethods
+ * Purpose: Tells what a view is a view of
+ * Arguments: The view
+ * Returns: The methods of the underlying array, which is never a view
+ */
+A2Methods_T A2View_baseMethods(A2 view)
+{
+    assert(view != NULL);
+    View v = view;
+    return v->methods;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ *                      The a2view_methods table
+ * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static A2 new(int width, int height, int size)
+{
+    A2Methods_T plain = uarray2_methods_plain;
+    A2 base = plain->new(width, height, size);
+    View view = compose(plain, base, width, height, 0, 0, 1, 0, 0, 1);
+    view->owned = 1;
+    return view;
+}
+
+static A2 new_with_blocksize(int width, int height, int size, int blocksize)
+{
+    (void)blocksize;
+    return new(width, height, size);
+}
+
+static void a2free(A2 *array2p)
+{
+    assert(array2p != NULL && *array2p != NULL);
+    View view = *array2p;
+    if (view->owned) {
+        view->methods->free(&view->base);
+    }
+    FREE(view);
+    *array2p = NULL;
+}
+
+static int width(A2 array2)
+{
+    return ((View)array2)->width;
+}
+
+static int height(A2 array2)
+{
+    return ((View)array2)->height;
+}
+
+static int size(A2 array2)
+{
+    View view = array2;
+    return view->methods->size(view->base);
+}
+
+static int blocksize(A2 array2)
+{
+    (void)array2;
+    return 1;
+}
+
+static A2Methods_Object *at(A2 array2, int i, int j)
+{
+    View view = array2;
+    assert(view != NULL);
+    assert(i >= 0 && i < view->width && j >= 0 && j < view->height);
+    return baseAt(view, i, j);
+}
+
+/* Function: map_row_major
+ * Purpose: Applies a function to every cell of a view, row by row.
+ *          The base coordinates are stepped rather than recomputed.
+ * Arguments: The view, the apply function and its closure
+ * Returns: none
+ */
+static void map_row_major(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+    View view = array2;
+    assert(view != NULL && apply != NULL);
+    for (int j = 0; j < view->height; j++) {
+        int x = view->x0 + view->xj * j;
+        int y = view->y0 + view->yj * j;
+        for (int i = 0; i < view->width; i++) {
+            apply(i, j, array2, view->methods->at(view->base, x, y), cl);
+            x += view->xi;
+            y += view->yi;
+        }
+    }
+}
+
+/* Function: map_col_major
+ * Purpose: Applies a function to every cell of a view, column by column
+ * Arguments: The view, the apply function and its closure
+ * Returns: none
+ */
+static void map_col_major(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+    View view = array2;
+    assert(view != NULL && apply != NULL);
+    for (int i = 0; i < view->width; i++) {
+        int x = view->x0 + view->xi * i;
+        int y = view->y0 + view->yi * i;
+        for (int j = 0; j < view->height; j++) {
+            apply(i, j, array2, view->methods->at(view->base, x, y), cl);
+            x += view->xj;
+            y += view->yj;
+        }
+    }
+}
+
+/* struct small_closure
+ * A small apply function along with its closure
+ */
+struct small_closure {
+    A2Methods_smallapplyfun *apply;
+    void                    *cl;
+};
+
+static void apply_small(int i, int j, A2 array2, void *elem, void *vcl)
+{
+    struct small_closure *cl = vcl;
+    (void)i;
+    (void)j;
+    (void)array2;
+    cl->apply(elem, cl->cl);
+}
+
+static void small_map_row_major(A2 array2, A2Methods_smallapplyfun apply,
+                                void *cl)
+{
+    struct small_closure mycl = { apply, cl };
+    map_row_major(array2, apply_small, &mycl);
+}
+
+static void small_map_col_major(A2 array2, A2Methods_smallapplyfun apply,
+                                void *cl)
+{
+    struct small_closure mycl = { apply, cl };
+    map_col_major(array2, apply_small, &mycl);
+}
+
+static struct A2Methods_T a2view_methods_struct = {
+    new,
+    new_with_blocksize,
+    a2free,
+    width,
+    height,
+    size,
+    blocksize,
+    at,
+    map_row_major,
+    map_col_major,
+    NULL,
+    map_row_major,          /* map_default */
+    small_map_row_major,
+    small_map_col_major,
+    NULL,
+    small_map_row_major,    /* small_map_default */
+};
+
+A2Methods_T a2view_methods = &a2view_methods_struct;
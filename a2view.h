@@ -0,0 +1,50 @@
+/*
+ *                              a2view
+ *
+ *   Purpose:
+ *
+ *     Interface to zero-copy views of A2 arrays. A view presents a
+ *     rectangular window of another array (a crop), or the whole array
+ *     rotated, flipped or transposed, by remapping indices on every
+ *     access; no pixel is copied until the view is materialized.
+ *
+ *     Views are ordinary A2 arrays of the a2view_methods table, so
+ *     'at' and the row- and column-major maps work on them, and a view
+ *     may itself be cropped or oriented. A view of a view is flattened
+ *     onto the underlying array, so every access costs one remap no
+ *     matter how many views are stacked, and the intermediate view may
+ *     be freed at once. A view never owns the array it looks at: that
+ *     array must outlive it.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef A2VIEW_INCLUDED
+#define A2VIEW_INCLUDED
+
+#include "a2methods.h"
+
+/* The methods of every view. Its 'new' makes a view of a fresh
+ * UArray2 that the view owns; its maps visit the view's cells in
+ * view coordinates and pass the view itself to the apply function.
+ */
+extern A2Methods_T a2view_methods;
+
+extern A2Methods_UArray2 A2View_crop(A2Methods_T methods,
+                                     A2Methods_UArray2 array2,
+                                     int x, int y, int width, int height);
+extern A2Methods_UArray2 A2View_rotate(A2Methods_T methods,
+                                       A2Methods_UArray2 array2,
+                                       int rotation);
+extern A2Methods_UArray2 A2View_flip(A2Methods_T methods,
+                                     A2Methods_UArray2 array2,
+                                     int vertical);
+extern A2Methods_UArray2 A2View_transpose(A2Methods_T methods,
+                                          A2Methods_UArray2 array2);
+extern A2Methods_UArray2 A2View_materialize(A2Methods_UArray2 view,
+                                            A2Methods_T methods,
+                                            A2Methods_mapfun *map);
+extern A2Methods_T       A2View_baseMethods(A2Methods_UArray2 view);
+
+#endif
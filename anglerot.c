@@ -0,0 +1,234 @@
+/*
+ *                              anglerot
+ *
+ *   Purpose:
+ *
+ *     Implementation of arbitrary-angle rotation. Pixel (i, j) has its
+ *     center at (i + 0.5, j + 0.5); the source and destination centers
+ *     are matched, and destination pixel (i, j) is resampled at source
+ *     position
+ *
+ *         sx =  cos * dx + sin * dy + w / 2 - 0.5
+ *         sy = -sin * dx + cos * dy + h / 2 - 0.5
+ *
+ *     where (dx, dy) is the pixel's offset from the destination center,
+ *     and integral (sx, sy) is a source pixel center. Along a
+ *     destination row sx and sy change by constant steps, so each tile
+ *     row first fills arrays of source positions in a loop the
+ *     compiler can vectorize, then fetches and blends the texels.
+ *
+ *     Tiles are square: the block size of a blocked destination, so
+ *     each tile fills one block, or TILE otherwise. Texels are fetched
+ *     through rgbcells.h, and by a2batch.h a tile row at a time for the
+ *     nearest filter.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "assert.h"
+#include "rgbcells.h"
+#include "a2batch.h"
+#include "anglerot.h"
+
+#define TILE 32         /* tile side for unblocked destinations */
+#define TILE_MAX 128    /* largest block used as a tile */
+
+typedef A2Methods_UArray2 A2;
+
+/* Function: texel
+ * Purpose: Fetches a source pixel, or the background outside the source
+ * Arguments: The source cells, a position, the background
+ * Returns: A pointer to the pixel
+ */
+static inline const struct Pnm_rgb *texel(const RgbCells *src, int x, int y,
+                                          const struct Pnm_rgb *background)
+{
+    if (x < 0 || y < 0 || x >= src->width || y >= src->height) {
+        return background;
+    }
+    return RgbCells_at(src, x, y);
+}
+
+/* Function: nearestRow
+ * Purpose: Resamples a tile row by nearest pixels; the row's source
+ *          pixels are gathered in one batch (a2batch.h), so that their
+ *          cache misses overlap rather than follow one another
+ * Arguments: The methods of the arrays, the source and its cells, the
+ *            row's positions and length, the destination cells, the
+ *            row's first pixel, the background
+ * Returns: none
+ */
+static void nearestRow(A2Methods_T methods, A2 src, const RgbCells *in,
+                       const double *xs, const double *ys, int n,
+                       const RgbCells *out, int i0, int j,
+                       const struct Pnm_rgb *background)
+{
+    A2Batch_coord coords[TILE_MAX];
+    struct Pnm_rgb pixels[TILE_MAX];
+    char inside[TILE_MAX];
+    int m = 0;
+    for (int k = 0; k < n; k++) {
+        double x = xs[k] + 0.5;
+        double y = ys[k] + 0.5;
+        inside[k] = x >= 0 && y >= 0 && x < in->width && y < in->height;
+        if (inside[k]) {
+            coords[m].i = (int)x;
+            coords[m].j = (int)y;
+            m++;
+        }
+    }
+    A2Batch_gather(methods, src, coords, m, pixels);
+    m = 0;
+    for (int k = 0; k < n; k++) {
+        *RgbCells_at(out, i0 + k, j) = inside[k] ? pixels[m++] : *background;
+    }
+}
+
+static inline unsigned lerp(unsigned a, unsigned b, double f)
+{
+    return (unsigned)(a + (double)((int)b - (int)a) * f + 0.5);
+}
+
+static inline unsigned blend(unsigned tl, unsigned tr, unsigned bl,
+                             unsigned br, double fx, double fy)
+{
+    double top    = tl + ((double)tr - tl) * fx;
+    double bottom = bl + ((double)br - bl) * fx;
+    return (unsigned)(top + (bottom - top) * fy + 0.5);
+}
+
+/* Function: bilinear
+ * Purpose: Resamples the source at (sx, sy) by interpolating the four
+ *          pixels around it; those outside the source count as the
+ *          background, so edges fade into it
+ * Arguments: The source cells, the position, the background
+ * Returns: The resampled pixel
+ */
+static inline struct Pnm_rgb bilinear(const RgbCells *src, double sx,
+                                      double sy,
+                                      const struct Pnm_rgb *background)
+{
+    double fx0 = floor(sx);
+    double fy0 = floor(sy);
+    if (fx0 < -1 || fy0 < -1 || fx0 >= src->width || fy0 >= src->height) {
+        return *background;
+    }
+    int x0 = (int)fx0;
+    int y0 = (int)fy0;
+    double fx = sx - fx0;
+    double fy = sy - fy0;
+
+    const struct Pnm_rgb *tl, *tr, *bl, *br;
+    if (x0 >= 0 && y0 >= 0 &&
+        x0 + 1 < src->width && y0 + 1 < src->height) {
+        tl = RgbCells_at(src, x0, y0);
+        tr = RgbCells_at(src, x0 + 1, y0);
+        bl = RgbCells_at(src, x0, y0 + 1);
+        br = RgbCells_at(src, x0 + 1, y0 + 1);
+    } else {
+        tl = texel(src, x0, y0, background);
+        tr = texel(src, x0 + 1, y0, background);
+        bl = texel(src, x0, y0 + 1, background);
+        br = texel(src, x0 + 1, y0 + 1, background);
+    }
+
+    struct Pnm_rgb out;
+    if (fy == 0) {
+        out.red   = lerp(tl->red, tr->red, fx);
+        out.green = lerp(tl->green, tr->green, fx);
+        out.blue  = lerp(tl->blue, tr->blue, fx);
+    } else {
+        out.red   = blend(tl->red, tr->red, bl->red, br->red, fx, fy);
+        out.green = blend(tl->green, tr->green, bl->green, br->green,
+                          fx, fy);
+        out.blue  = blend(tl->blue, tr->blue, bl->blue, br->blue, fx, fy);
+    }
+    return out;
+}
+
+/* Function: AngleRot_dims
+ * Purpose: Computes the shape of the bounding box of a rotated image
+ * Arguments: The angle in degrees, the width and height of the image,
+ *            pointers that receive the rotated width and height
+ * Returns: none
+ */
+void AngleRot_dims(double degrees, int width, int height,
+                   int *outWidth, int *outHeight)
+{
+    assert(outWidth != NULL && outHeight != NULL);
+    assert(width >= 0 && height >= 0);
+    double radians = degrees * M_PI / 180;
+    double c = fabs(cos(radians));
+    double s = fabs(sin(radians));
+
+    /* the slack keeps right angles from growing by rounding error */
+    *outWidth  = (int)ceil(width * c + height * s - 1e-6);
+    *outHeight = (int)ceil(width * s + height * c - 1e-6);
+    if (width > 0 && height > 0) {
+        *outWidth  = *outWidth  < 1 ? 1 : *outWidth;
+        *outHeight = *outHeight < 1 ? 1 : *outHeight;
+    }
+}
+
+/* Function: AngleRot_rotate
+ * Purpose: Rotates a Pnm_rgb image by an arbitrary angle
+ * Arguments: The methods of both arrays, the source, a destination
+ *            shaped by AngleRot_dims, the angle in degrees clockwise,
+ *            the resampling filter, and the background color
+ * Returns: none
+ */
+void AngleRot_rotate(A2Methods_T methods, A2 src, A2 dest, double degrees,
+                     AngleRot_filter filter, struct Pnm_rgb background)
+{
+    assert(methods != NULL && src != NULL && dest != NULL);
+    assert(methods->size(src) == sizeof(struct Pnm_rgb));
+    assert(methods->size(dest) == sizeof(struct Pnm_rgb));
+    RgbCells in = RgbCells_of(methods, src);
+    RgbCells out = RgbCells_of(methods, dest);
+
+    double radians = degrees * M_PI / 180;
+    double c = cos(radians);
+    double s = sin(radians);
+    double dcx = out.width / 2.0;
+    double dcy = out.height / 2.0;
+    double scx = in.width / 2.0 - 0.5;
+    double scy = in.height / 2.0 - 0.5;
+
+    int tile = methods->blocksize(dest);
+    if (tile <= 1 || tile > TILE_MAX) {
+        tile = TILE;
+    }
+
+    double xs[TILE_MAX], ys[TILE_MAX];
+    for (int j0 = 0; j0 < out.height; j0 += tile) {
+        int jEnd = j0 + tile < out.height ? j0 + tile : out.height;
+        for (int i0 = 0; i0 < out.width; i0 += tile) {
+            int n = i0 + tile < out.width ? tile : out.width - i0;
+            for (int j = j0; j < jEnd; j++) {
+                double dy = j + 0.5 - dcy;
+                double sxRow = s * dy + scx;
+                double syRow = c * dy + scy;
+                /* from the absolute column, so that the positions do
+                 * not depend on where the tiles, and so the layout,
+                 * start */
+                for (int k = 0; k < n; k++) {
+                    double dx = i0 + k + 0.5 - dcx;
+                    xs[k] =  c * dx + sxRow;
+                    ys[k] = -s * dx + syRow;
+                }
+                if (filter == ANGLEROT_NEAREST) {
+                    nearestRow(methods, src, &in, xs, ys, n, &out, i0, j,
+                               &background);
+                } else {
+                    for (int k = 0; k < n; k++) {
+                        *RgbCells_at(&out, i0 + k, j) =
+                            bilinear(&in, xs[k], ys[k], &background);
+                    }
+                }
+            }
+        }
+    }
+}
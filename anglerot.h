@@ -0,0 +1,41 @@
+/*
+ *                              anglerot
+ *
+ *   Purpose:
+ *
+ *     Interface to rotation of Pnm_rgb images by arbitrary angles.
+ *     Angles are in degrees, clockwise, like the right-angle rotations
+ *     of ppmtrans. The destination is the bounding box of the rotated
+ *     source (AngleRot_dims); destination pixels whose preimage falls
+ *     outside the source take the background color.
+ *
+ *     Each destination pixel is resampled from the source through the
+ *     inverse rotation, either from the nearest source pixel or by
+ *     bilinear interpolation of the four around it. The destination is
+ *     walked tile by tile, so the source pixels touched by one tile lie
+ *     along a short, slanted strip, and they are fetched through the
+ *     array's own layout.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef ANGLEROT_INCLUDED
+#define ANGLEROT_INCLUDED
+
+#include "a2methods.h"
+#include "pnm.h"
+
+typedef enum AngleRot_filter {
+    ANGLEROT_NEAREST = 0,
+    ANGLEROT_BILINEAR
+} AngleRot_filter;
+
+extern void AngleRot_dims(double degrees, int width, int height,
+                          int *outWidth, int *outHeight);
+extern void AngleRot_rotate(A2Methods_T methods, A2Methods_UArray2 src,
+                            A2Methods_UArray2 dest, double degrees,
+                            AngleRot_filter filter,
+                            struct Pnm_rgb background);
+
+#endif
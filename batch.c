@@ -0,0 +1,323 @@
+/*
+ *                              batch
+ *
+ *   Purpose:
+ *
+ *     Implementation of ppmtrans batch mode. The list of input/output
+ *     pairs is collected up front, then worker threads claim jobs one
+ *     at a time from a shared counter. Each worker reads its image,
+ *     rotates it into a destination array checked out of a shared
+ *     A2Pool, writes the result, and returns the array to the pool so
+ *     the next image of the same shape skips allocation entirely.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "assert.h"
+#include "mem.h"
+#include "pnm.h"
+#include "ppmio.h"
+#include "a2pool.h"
+#include "transform.h"
+#include "batch.h"
+
+typedef A2Methods_UArray2 A2;
+
+/* Struct job
+* One input/output pair of the batch
+*/
+struct job {
+    char *input;  /* path of the image to read */
+    char *output; /* path the transformed image is written to */
+};
+
+/* Struct batch
+* State shared by every worker thread
+*/
+struct batch {
+    struct Batch_options *options;
+    struct job *jobs;     /* every job of the batch */
+    int numJobs;          /* number of entries in jobs */
+    int next;             /* index of the next unclaimed job */
+    int failures;         /* number of jobs that could not be done */
+    A2Pool_T pool;        /* recycled destination arrays */
+    pthread_mutex_t lock; /* guards next and failures */
+};
+
+static int runJobs(struct job *jobs, int numJobs,
+                   struct Batch_options *options);
+static void *worker(void *cl);
+static int runJob(struct batch *batch, struct job *job);
+static void addJob(struct job **jobs, int *numJobs, int *capacity,
+                   const char *input, const char *output);
+static void freeJobs(struct job *jobs, int numJobs);
+static int compareJobs(const void *a, const void *b);
+
+/* Function: Batch_runList
+ * Purpose: Transforms every image named in a list file. Each line of
+ *          the list holds an input path and an output path separated
+ *          by whitespace; blank lines and lines starting with '#' are
+ *          skipped.
+ * Arguments: The open list file, the batch settings
+ * Returns: The number of images that could not be transformed
+ */
+int Batch_runList(FILE *list, struct Batch_options *options)
+{
+    assert(list != NULL && options != NULL);
+    struct job *jobs = NULL;
+    int numJobs = 0, capacity = 0, lineNum = 0, failures = 0;
+    char line[4096];
+
+    while (fgets(line, sizeof(line), list) != NULL) {
+        lineNum++;
+        char *input = strtok(line, " \t\r\n");
+        if (input == NULL || *input == '#') {
+            continue;
+        }
+        char *output = strtok(NULL, " \t\r\n");
+        if (output == NULL || strtok(NULL, " \t\r\n") != NULL) {
+            fprintf(stderr, "batch list line %d: expected "
+                            "'<input> <output>'\n", lineNum);
+            failures++;
+            continue;
+        }
+        addJob(&jobs, &numJobs, &capacity, input, output);
+    }
+
+    failures += runJobs(jobs, numJobs, options);
+    freeJobs(jobs, numJobs);
+    return failures;
+}
+
+/* Function: Batch_runDir
+ * Purpose: Transforms every .ppm file in a directory. The output path
+ *          of each image is outPattern with its single "%s" replaced by
+ *          the input file name minus the .ppm extension.
+ * Arguments: The directory to scan, the output pattern, the batch
+ *            settings
+ * Returns: The number of images that could not be transformed
+ */
+int Batch_runDir(const char *dirName, const char *outPattern,
+                 struct Batch_options *options)
+{
+    assert(dirName != NULL && outPattern != NULL && options != NULL);
+    const char *hole = strstr(outPattern, "%s");
+    if (hole == NULL || strstr(hole + 2, "%") != NULL ||
+        memchr(outPattern, '%', hole - outPattern) != NULL) {
+        fprintf(stderr, "batch output pattern '%s' must contain "
+                        "exactly one %%s\n", outPattern);
+        return 1;
+    }
+
+    DIR *dir = opendir(dirName);
+    if (dir == NULL) {
+        fprintf(stderr, "%s %s\n", "Could not open directory", dirName);
+        return 1;
+    }
+
+    struct job *jobs = NULL;
+    int numJobs = 0, capacity = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len <= 4 || strcmp(entry->d_name + len - 4, ".ppm") != 0) {
+            continue;
+        }
+        char stem[len - 3];
+        memcpy(stem, entry->d_name, len - 4);
+        stem[len - 4] = '\0';
+
+        char input[strlen(dirName) + len + 2];
+        sprintf(input, "%s/%s", dirName, entry->d_name);
+        char output[strlen(outPattern) + len];
+        sprintf(output, outPattern, stem);
+
+        addJob(&jobs, &numJobs, &capacity, input, output);
+    }
+    closedir(dir);
+
+    /* readdir order is arbitrary; keep runs reproducible */
+    qsort(jobs, numJobs, sizeof(struct job), compareJobs);
+
+    int failures = runJobs(jobs, numJobs, options);
+    freeJobs(jobs, numJobs);
+    return failures;
+}
+
+/* Function: runJobs
+ * Purpose: Runs every job on options->jobs worker threads
+ * Arguments: The jobs, their number, the batch settings
+ * Returns: The number of jobs that failed
+ */
+static int runJobs(struct job *jobs, int numJobs,
+                   struct Batch_options *options)
+{
+    assert(options->methods != NULL && options->map != NULL);
+    assert(options->jobs > 0);
+
+    struct batch batch;
+    batch.options = options;
+    batch.jobs = jobs;
+    batch.numJobs = numJobs;
+    batch.next = 0;
+    batch.failures = 0;
+    /* two idle arrays per worker covers alternating shapes */
+    batch.pool = A2Pool_new(options->methods, 2 * options->jobs);
+    pthread_mutex_init(&batch.lock, NULL);
+
+    int numThreads = options->jobs < numJobs ? options->jobs : numJobs;
+    pthread_t threads[numThreads > 0 ? numThreads : 1];
+    for (int i = 0; i < numThreads; i++) {
+        if (pthread_create(&threads[i], NULL, worker, &batch) != 0) {
+            fprintf(stderr, "Could not start batch worker %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < numThreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&batch.lock);
+    A2Pool_free(&batch.pool);
+    return batch.failures;
+}
+
+/* Function: worker
+ * Purpose: Thread body; claims and runs jobs until none are left
+ * Arguments: The shared struct batch
+ * Returns: NULL
+ */
+static void *worker(void *cl)
+{
+    struct batch *batch = cl;
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        int index = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        if (index >= batch->numJobs) {
+            break;
+        }
+        if (!runJob(batch, &batch->jobs[index])) {
+            pthread_mutex_lock(&batch->lock);
+            batch->failures++;
+            pthread_mutex_unlock(&batch->lock);
+        }
+    }
+    return NULL;
+}
+
+/* Function: runJob
+ * Purpose: Reads, transforms and writes a single image
+ * Arguments: The shared batch state, the job to run
+ * Returns: 1 on success, 0 if the input is not a well-formed PPM or
+ *          the input or output could not be opened
+ */
+static int runJob(struct batch *batch, struct job *job)
+{
+    struct Batch_options *options = batch->options;
+    A2Methods_T methods = options->methods;
+
+    FILE *in = fopen(job->input, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "%s %s %s\n", "Could not open file", job->input,
+                "for reading");
+        return 0;
+    }
+    /* no exceptions in the workers: a bad image fails only its job */
+    struct PpmIO_header header;
+    struct stat info;
+    Pnm_ppm pixMap = NULL;
+    if (PpmIO_readHeader(in, &header) && PpmIO_isColor(&header) &&
+        fstat(fileno(in), &info) == 0 &&
+        (double)header.width * header.height *
+        (header.raw ? PpmIO_pixelBytes(&header) : 6) <=
+        info.st_size + 1.0) {           /* a plain sample takes 2 bytes */
+        pixMap = PpmIO_readPixels(in, &header, methods, 0, NULL);
+    }
+    fclose(in);
+    if (pixMap == NULL) {
+        fprintf(stderr, "%s %s\n", "Not a complete PPM image:",
+                job->input);
+        return 0;
+    }
+
+    int width, height;
+    Transform_dims(options->rotation, pixMap->width, pixMap->height,
+                   &width, &height);
+    A2 finalArr = A2Pool_get(batch->pool, width, height,
+                             sizeof(struct Pnm_rgb));
+    Transform_rotate(methods, options->map, pixMap->pixels, finalArr,
+                     options->rotation, options->order);
+
+    FILE *out = fopen(job->output, "wb");
+    int ok = out != NULL;
+    if (ok) {
+        /* borrow the Pnm_ppm to describe the rotated image */
+        A2 source = pixMap->pixels;
+        unsigned srcWidth = pixMap->width;
+        unsigned srcHeight = pixMap->height;
+        pixMap->pixels = finalArr;
+        pixMap->width = width;
+        pixMap->height = height;
+        Pnm_ppmwrite(out, pixMap);
+        pixMap->pixels = source;
+        pixMap->width = srcWidth;
+        pixMap->height = srcHeight;
+        ok = fclose(out) == 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "%s %s\n", "Could not write file", job->output);
+    }
+
+    A2Pool_put(batch->pool, finalArr);
+    Pnm_ppmfree(&pixMap);
+    return ok;
+}
+
+/* Function: addJob
+ * Purpose: Appends a copy of an input/output pair to a growing array
+ * Arguments: The job array, its length and capacity, the two paths
+ * Returns: none
+ */
+static void addJob(struct job **jobs, int *numJobs, int *capacity,
+                   const char *input, const char *output)
+{
+    if (*numJobs == *capacity) {
+        *capacity = *capacity == 0 ? 64 : 2 * *capacity;
+        *jobs = realloc(*jobs, *capacity * sizeof(struct job));
+        assert(*jobs != NULL);
+    }
+    struct job *job = &(*jobs)[(*numJobs)++];
+    job->input = strdup(input);
+    job->output = strdup(output);
+    assert(job->input != NULL && job->output != NULL);
+}
+
+/* Function: freeJobs
+ * Purpose: Frees a job array and the paths it owns
+ * Arguments: The job array and its length
+ * Returns: none
+ */
+static void freeJobs(struct job *jobs, int numJobs)
+{
+    for (int i = 0; i < numJobs; i++) {
+        free(jobs[i].input);
+        free(jobs[i].output);
+    }
+    free(jobs);
+}
+
+/* Function: compareJobs
+ * Purpose: qsort comparison ordering jobs by input path
+ */
+static int compareJobs(const void *a, const void *b)
+{
+    return strcmp(((const struct job *)a)->input,
+                  ((const struct job *)b)->input);
+}
@@ -0,0 +1,37 @@
+/*
+ *                              batch
+ *
+ *   Purpose:
+ *
+ *     Interface to ppmtrans batch mode, which transforms many images
+ *     in a single process. Jobs are spread over a configurable number
+ *     of worker threads, and destination arrays are recycled between
+ *     images of the same shape.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef BATCH_INCLUDED
+#define BATCH_INCLUDED
+
+#include <stdio.h>
+#include "a2methods.h"
+#include "transform.h"
+
+/* Struct Batch_options
+* Settings shared by every image in a batch
+*/
+struct Batch_options {
+    A2Methods_T methods;   /* representation used for every image */
+    A2Methods_mapfun *map; /* traversal used for every transform */
+    int rotation;          /* rotation applied to every image */
+    Transform_order order; /* scatter, gather or auto */
+    int jobs;              /* number of worker threads, at least 1 */
+};
+
+extern int Batch_runList(FILE *list, struct Batch_options *options);
+extern int Batch_runDir(const char *dirName, const char *outPattern,
+                        struct Batch_options *options);
+
+#endif
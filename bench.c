@@ -0,0 +1,312 @@
+/*
+ *                              bench
+ *
+ *   Purpose:
+ *
+ *     Performance regression check for the rotation engine. A fixed
+ *     set of cases (array layout, mapping function, traversal order,
+ *     rotation) runs on a generated image, and each case's best time
+ *     over a few runs is reported in nanoseconds per pixel.
+ *
+ *         bench -record <baseline>
+ *             writes the times to the baseline file, each the median
+ *             of RECORD_TRIES tries
+ *         bench -check <baseline> [-tolerance <percent>]
+ *             compares the times with the baseline, and exits with a
+ *             failure status if any case is slower than its baseline
+ *             by more than the tolerance (50% by default: enough to
+ *             ride out a busy machine, not a doubling)
+ *
+ *     A case found slower is run again, up to RETRIES more times,
+ *     keeping its best time, so that one noisy run does not fail the
+ *     check. Cases missing from the baseline are reported and pass.
+ *     The times only mean something on the machine that recorded the
+ *     baseline: "make bench-baseline" rewrites it.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "mem.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2spec.h"
+#include "pnm.h"
+#include "cputiming.h"
+#include "transform.h"
+#include "ppmio.h"
+
+typedef A2Methods_UArray2 A2;
+
+#define WIDTH 1600
+#define HEIGHT 1200
+#define RUNS 5                  /* timed runs of each case */
+#define RETRIES 3               /* further tries of a case found slower */
+#define RECORD_TRIES 5          /* tries whose median is recorded */
+#define MAX_NAME 64
+#define DEFAULT_TOLERANCE 50
+
+/* Array layouts: the specialized tables ppmtrans uses by default, and
+ * the generic UArray2 and UArray2b ones of -generic
+ */
+enum layout { LAYOUT_PLAIN, LAYOUT_BLOCKED, LAYOUT_UARRAY2, LAYOUT_UARRAY2B };
+enum mapping { MAP_ROW, MAP_COL, MAP_BLOCK };
+
+/* Struct bench_case
+* One configuration to time; 'fused' cases write the rotated image to
+* /dev/null with PpmIO_writeOriented rather than build it
+*/
+struct bench_case {
+    const char *name;
+    enum layout layout;
+    enum mapping mapping;
+    int fused;
+    Transform_order order;
+    int rotation;
+};
+
+static const struct bench_case CASES[] = {
+    { "plain-row-scatter-90",    LAYOUT_PLAIN, MAP_ROW, 0,
+      TRANSFORM_SCATTER, 90 },
+    { "plain-row-gather-90",     LAYOUT_PLAIN, MAP_ROW, 0,
+      TRANSFORM_GATHER, 90 },
+    { "plain-row-scatter-180",   LAYOUT_PLAIN, MAP_ROW, 0,
+      TRANSFORM_SCATTER, 180 },
+    { "plain-col-gather-270",    LAYOUT_PLAIN, MAP_COL, 0,
+      TRANSFORM_GATHER, 270 },
+    { "plain-stream-90",         LAYOUT_PLAIN, MAP_ROW, 0,
+      TRANSFORM_STREAM, 90 },
+    { "blocked-scatter-90",      LAYOUT_BLOCKED, MAP_BLOCK, 0,
+      TRANSFORM_SCATTER, 90 },
+    { "blocked-gather-90",       LAYOUT_BLOCKED, MAP_BLOCK, 0,
+      TRANSFORM_GATHER, 90 },
+    { "blocked-scatter-180",     LAYOUT_BLOCKED, MAP_BLOCK, 0,
+      TRANSFORM_SCATTER, 180 },
+    { "uarray2-row-scatter-90",  LAYOUT_UARRAY2, MAP_ROW, 0,
+      TRANSFORM_SCATTER, 90 },
+    { "uarray2b-scatter-90",     LAYOUT_UARRAY2B, MAP_BLOCK, 0,
+      TRANSFORM_SCATTER, 90 },
+    { "plain-fused-90",          LAYOUT_PLAIN, MAP_ROW, 1,
+      TRANSFORM_AUTO, 90 },
+    { "blocked-fused-90",        LAYOUT_BLOCKED, MAP_BLOCK, 1,
+      TRANSFORM_AUTO, 90 },
+};
+#define NCASES ((int)(sizeof(CASES) / sizeof(CASES[0])))
+
+static A2Methods_T layoutMethods(enum layout layout)
+{
+    switch (layout) {
+    case LAYOUT_PLAIN:
+        return A2Spec_plain(sizeof(struct Pnm_rgb));
+    case LAYOUT_BLOCKED:
+        return A2Spec_blocked(sizeof(struct Pnm_rgb));
+    case LAYOUT_UARRAY2:
+        return uarray2_methods_plain;
+    default:
+        return uarray2_methods_blocked;
+    }
+}
+
+static A2Methods_mapfun *mappingOf(A2Methods_T methods, enum mapping mapping)
+{
+    switch (mapping) {
+    case MAP_ROW:
+        return methods->map_row_major;
+    case MAP_COL:
+        return methods->map_col_major;
+    default:
+        return methods->map_block_major;
+    }
+}
+
+static void fillPixel(int i, int j, A2 array, void *elem, void *cl)
+{
+    (void)array;
+    (void)cl;
+    struct Pnm_rgb *pixel = elem;
+    pixel->red = i & 255;
+    pixel->green = j & 255;
+    pixel->blue = (i ^ j) & 255;
+}
+
+/* Function: timeCase
+ * Purpose: Times one case, after a run that warms the caches and
+ *          touches the destination's pages
+ * Arguments: The case, the number of timed runs
+ * Returns: The best run's time, in nanoseconds per pixel
+ */
+static double timeCase(const struct bench_case *c, int runs)
+{
+    A2Methods_T methods = layoutMethods(c->layout);
+    A2Methods_mapfun *map = mappingOf(methods, c->mapping);
+    assert(methods != NULL && map != NULL);
+    A2 src = methods->new(WIDTH, HEIGHT, sizeof(struct Pnm_rgb));
+    map(src, fillPixel, NULL);
+
+    A2 dest = NULL;
+    FILE *sink = NULL;
+    struct Pnm_ppm image = { .width = WIDTH, .height = HEIGHT,
+                             .denominator = 255, .pixels = src,
+                             .methods = methods };
+    if (c->fused) {
+        sink = fopen("/dev/null", "w");
+        assert(sink != NULL);
+    } else {
+        dest = Transform_newDest(methods, src, c->rotation);
+    }
+
+    CPUTime_T timer = CPUTime_New();
+    double best = 0;
+    for (int run = 0; run <= runs; run++) {
+        CPUTime_Start(timer);
+        if (c->fused) {
+            PpmIO_writeOriented(sink, &image, c->rotation);
+        } else {
+            Transform_rotate(methods, map, src, dest, c->rotation,
+                             c->order);
+        }
+        double ns = CPUTime_Stop(timer);
+        if (run == 1 || (run > 1 && ns < best)) {
+            best = ns;      /* run 0 only warms up */
+        }
+    }
+    CPUTime_Free(&timer);
+
+    if (sink != NULL) {
+        fclose(sink);
+    } else {
+        methods->free(&dest);
+    }
+    methods->free(&src);
+    return best / ((double)WIDTH * HEIGHT);
+}
+
+/* Function: baselineOf
+ * Purpose: Looks a case up in a baseline file
+ * Arguments: The open file, the case's name
+ * Returns: The case's recorded nanoseconds per pixel, or -1 if the file
+ *          has none
+ */
+static double baselineOf(FILE *fp, const char *name)
+{
+    char line[256];
+    char key[MAX_NAME];
+    double value;
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] != '#' &&
+            sscanf(line, "%63s %lf", key, &value) == 2 &&
+            strcmp(key, name) == 0) {
+            return value;
+        }
+    }
+    return -1;
+}
+
+static void usage(const char *progname)
+{
+    fprintf(stderr, "Usage: %s -record <baseline>\n"
+                    "       %s -check <baseline> "
+                    "[-tolerance <percent>]\n", progname, progname);
+    exit(1);
+}
+
+static int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int record(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open file %s for writing\n", path);
+        return EXIT_FAILURE;
+    }
+    fprintf(fp, "# bench baseline: nanoseconds per pixel on a %dx%d "
+                "image, median of %d tries of best of %d runs\n", WIDTH,
+                HEIGHT, RECORD_TRIES, RUNS);
+    for (int k = 0; k < NCASES; k++) {
+        double tries[RECORD_TRIES];
+        for (int t = 0; t < RECORD_TRIES; t++) {
+            tries[t] = timeCase(&CASES[k], RUNS);
+        }
+        qsort(tries, RECORD_TRIES, sizeof(double), compareDoubles);
+        double ns = tries[RECORD_TRIES / 2];
+        fprintf(fp, "%s %.3f\n", CASES[k].name, ns);
+        printf("%-24s %8.3f ns/pixel\n", CASES[k].name, ns);
+    }
+    fclose(fp);
+    return EXIT_SUCCESS;
+}
+
+static int check(const char *path, double tolerance)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open file %s for reading\n", path);
+        return EXIT_FAILURE;
+    }
+    int regressions = 0;
+    printf("%-24s %10s %10s %8s\n", "case", "baseline", "now", "change");
+    for (int k = 0; k < NCASES; k++) {
+        double base = baselineOf(fp, CASES[k].name);
+        double ns = timeCase(&CASES[k], RUNS);
+        double limit = base * (1 + tolerance / 100);
+        for (int retry = 0; base > 0 && ns > limit && retry < RETRIES;
+             retry++) {
+            double again = timeCase(&CASES[k], RUNS);
+            ns = again < ns ? again : ns;
+        }
+        if (base <= 0) {
+            printf("%-24s %10s %10.3f %8s\n", CASES[k].name, "-", ns,
+                   "new");
+            continue;
+        }
+        int slower = ns > limit;
+        regressions += slower;
+        printf("%-24s %10.3f %10.3f %+7.1f%%%s\n", CASES[k].name, base, ns,
+               100 * (ns - base) / base, slower ? "  REGRESSED" : "");
+    }
+    fclose(fp);
+    if (regressions > 0) {
+        printf("%d of %d cases more than %g%% slower than %s\n",
+               regressions, NCASES, tolerance, path);
+        return EXIT_FAILURE;
+    }
+    printf("all %d cases within %g%% of %s\n", NCASES, tolerance, path);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *recordPath = NULL;
+    const char *checkPath = NULL;
+    double tolerance = DEFAULT_TOLERANCE;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "-check") == 0 && i + 1 < argc) {
+            checkPath = argv[++i];
+        } else if (strcmp(argv[i], "-tolerance") == 0 && i + 1 < argc) {
+            char *end;
+            tolerance = strtod(argv[++i], &end);
+            if (*end != '\0' || !(tolerance >= 0)) {
+                usage(argv[0]);
+            }
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if ((recordPath == NULL) == (checkPath == NULL)) {
+        usage(argv[0]);
+    }
+    return recordPath != NULL ? record(recordPath)
+                              : check(checkPath, tolerance);
+}
@@ -0,0 +1,186 @@
+/*
+ *                              blockcache
+ *
+ *   Purpose:
+ *
+ *     Implementation of the block cache. The frames are kept on a
+ *     doubly-linked list from the most to the least recently used, and
+ *     a table gives the frame of each block (or -1). Looking up a block
+ *     is one table read; a hit moves the frame to the front of the
+ *     list, and a miss reuses the frame at the back. Touching the block
+ *     touched last skips even that, so runs of accesses within a block,
+ *     which is what blocked traversals produce, cost almost nothing.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdlib.h>
+#include "assert.h"
+#include "mem.h"
+#include "blockcache.h"
+
+#define T BlockCache_T
+
+/* Struct frame
+* One block's worth of the cache
+*/
+struct frame {
+    int block;          /* the block held, or -1 */
+    int dirty;          /* touched since it was loaded */
+    int prev, next;     /* neighbours in recency order, or -1 */
+};
+
+struct T {
+    int blocks;
+    long blockBytes;
+    int frameCount;
+    char *memory;           /* frameCount * blockBytes */
+    struct frame *frames;
+    int *frameOf;           /* for each block, its frame or -1 */
+    int newest, oldest;     /* ends of the recency list */
+    int last;               /* frame of the block touched last, or -1 */
+    BlockCache_movefun *load, *store;
+    void *cl;
+    long loads, stores;
+};
+
+static void unlinkFrame(T cache, int f)
+{
+    struct frame *frame = &cache->frames[f];
+    if (frame->prev >= 0) {
+        cache->frames[frame->prev].next = frame->next;
+    } else {
+        cache->newest = frame->next;
+    }
+    if (frame->next >= 0) {
+        cache->frames[frame->next].prev = frame->prev;
+    } else {
+        cache->oldest = frame->prev;
+    }
+}
+
+static void pushNewest(T cache, int f)
+{
+    struct frame *frame = &cache->frames[f];
+    frame->prev = -1;
+    frame->next = cache->newest;
+    if (cache->newest >= 0) {
+        cache->frames[cache->newest].prev = f;
+    } else {
+        cache->oldest = f;
+    }
+    cache->newest = f;
+}
+
+/* Function: BlockCache_new
+ * Purpose: Creates a cache with every frame empty
+ * Arguments: The number of blocks, the bytes in each, the number of
+ *            frames (at most 'blocks' are used), the functions moving
+ *            blocks in and out of frames, and their closure
+ * Returns: A new BlockCache
+ */
+T BlockCache_new(int blocks, long blockBytes, int frameCount,
+                 BlockCache_movefun *load, BlockCache_movefun *store,
+                 void *cl)
+{
+    assert(blocks > 0 && blockBytes > 0 && frameCount > 0);
+    assert(load != NULL && store != NULL);
+    T cache;
+    NEW(cache);
+    cache->blocks = blocks;
+    cache->blockBytes = blockBytes;
+    cache->frameCount = frameCount < blocks ? frameCount : blocks;
+    cache->memory = ALLOC(cache->frameCount * blockBytes);
+    cache->frames = CALLOC(cache->frameCount, sizeof(struct frame));
+    cache->frameOf = ALLOC(blocks * sizeof(int));
+    for (int k = 0; k < blocks; k++) {
+        cache->frameOf[k] = -1;
+    }
+    cache->newest = cache->oldest = -1;
+    for (int f = 0; f < cache->frameCount; f++) {
+        cache->frames[f].block = -1;
+        pushNewest(cache, f);
+    }
+    cache->last = -1;
+    cache->load = load;
+    cache->store = store;
+    cache->cl = cl;
+    cache->loads = cache->stores = 0;
+    return cache;
+}
+
+/* Function: BlockCache_free
+ * Purpose: Frees a cache, dropping its frames without storing them
+ * Arguments: A pointer to the cache
+ * Returns: none
+ */
+void BlockCache_free(T *cache)
+{
+    assert(cache != NULL && *cache != NULL);
+    FREE((*cache)->frameOf);
+    FREE((*cache)->frames);
+    FREE((*cache)->memory);
+    FREE(*cache);
+}
+
+/* Function: BlockCache_touch
+ * Purpose: Brings a block into a frame, evicting the least recently
+ *          used block if need be, and marks it dirty
+ * Arguments: The cache, the block's index
+ * Returns: The frame holding the block
+ */
+char *BlockCache_touch(T cache, int block)
+{
+    assert(cache != NULL && block >= 0 && block < cache->blocks);
+    int f = cache->frameOf[block];
+    if (f < 0 || f != cache->last) {
+        if (f < 0) {
+            f = cache->oldest;
+            struct frame *victim = &cache->frames[f];
+            char *bytes = cache->memory + f * cache->blockBytes;
+            if (victim->block >= 0) {
+                if (victim->dirty) {
+                    cache->store(cache->cl, victim->block, bytes);
+                    cache->stores++;
+                }
+                cache->frameOf[victim->block] = -1;
+            }
+            victim->block = block;
+            cache->load(cache->cl, block, bytes);
+            cache->loads++;
+            cache->frameOf[block] = f;
+        }
+        unlinkFrame(cache, f);
+        pushNewest(cache, f);
+        cache->last = f;
+    }
+    cache->frames[f].dirty = 1;
+    return cache->memory + f * cache->blockBytes;
+}
+
+/* Function: BlockCache_flush
+ * Purpose: Stores every dirty frame; the frames keep their blocks
+ * Arguments: The cache
+ * Returns: none
+ */
+void BlockCache_flush(T cache)
+{
+    assert(cache != NULL);
+    for (int f = 0; f < cache->frameCount; f++) {
+        struct frame *frame = &cache->frames[f];
+        if (frame->block >= 0 && frame->dirty) {
+            cache->store(cache->cl, frame->block,
+                         cache->memory + f * cache->blockBytes);
+            cache->stores++;
+            frame->dirty = 0;
+        }
+    }
+}
+
+void BlockCache_traffic(T cache, long *loads, long *stores)
+{
+    assert(cache != NULL && loads != NULL && stores != NULL);
+    *loads = cache->loads;
+    *stores = cache->stores;
+}
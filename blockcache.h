@@ -0,0 +1,41 @@
+/*
+ *                              blockcache
+ *
+ *   Purpose:
+ *
+ *     Interface to a cache of equal-sized blocks kept in a fixed number
+ *     of frames, for arrays whose blocks normally live somewhere that
+ *     cannot be addressed directly (a file, a compressed encoding).
+ *     The owner supplies two functions: 'load' fills a frame with a
+ *     block, and 'store' saves a frame back. BlockCache_touch returns
+ *     a block's frame, loading it first if need be into the frame of
+ *     the least recently used block, which is stored first if it was
+ *     touched since it was loaded.
+ *
+ *     Frames stay put while they hold a block: the frame returned for
+ *     a block stays valid until frameCount - 1 other blocks have been
+ *     touched. A cache must not be used by two threads at once.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef BLOCKCACHE_INCLUDED
+#define BLOCKCACHE_INCLUDED
+
+#define T BlockCache_T
+typedef struct T *T;
+
+/* Moves block 'block' into or out of 'bytes'; cl is the owner's */
+typedef void BlockCache_movefun(void *cl, int block, char *bytes);
+
+extern T     BlockCache_new    (int blocks, long blockBytes, int frameCount,
+                                BlockCache_movefun *load,
+                                BlockCache_movefun *store, void *cl);
+extern void  BlockCache_free   (T *cache);
+extern char *BlockCache_touch  (T cache, int block);
+extern void  BlockCache_flush  (T cache);
+extern void  BlockCache_traffic(T cache, long *loads, long *stores);
+
+#undef T
+#endif
@@ -0,0 +1,125 @@
+/*
+ *                              bqueue
+ *
+ *   Purpose:
+ *
+ *     Implementation of the bounded queue: a ring of item pointers
+ *     behind one lock, with one condition for "not empty" and one for
+ *     "not full".
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "assert.h"
+#include "mem.h"
+#include "bqueue.h"
+
+#define T BQueue_T
+
+struct T {
+    int capacity;
+    int head;                   /* index of the oldest item */
+    int count;                  /* number of items queued */
+    int closed;                 /* no more puts will come */
+    void **items;
+    pthread_mutex_t lock;       /* guards everything above */
+    pthread_cond_t nonEmpty;
+    pthread_cond_t nonFull;
+};
+
+/* Function: BQueue_new
+ * Purpose: Creates an empty, open queue
+ * Arguments: The most items the queue holds at once
+ * Returns: A new BQueue
+ */
+T BQueue_new(int capacity)
+{
+    assert(capacity > 0);
+    T queue;
+    NEW(queue);
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->closed = 0;
+    queue->items = CALLOC(capacity, sizeof(void *));
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->nonEmpty, NULL);
+    pthread_cond_init(&queue->nonFull, NULL);
+    return queue;
+}
+
+/* Function: BQueue_free
+ * Purpose: Frees a queue that no thread is using. Items still queued
+ *          belong to the caller.
+ * Arguments: A pointer to the queue
+ * Returns: none
+ */
+void BQueue_free(T *queue)
+{
+    assert(queue != NULL && *queue != NULL);
+    pthread_cond_destroy(&(*queue)->nonFull);
+    pthread_cond_destroy(&(*queue)->nonEmpty);
+    pthread_mutex_destroy(&(*queue)->lock);
+    FREE((*queue)->items);
+    FREE(*queue);
+}
+
+/* Function: BQueue_put
+ * Purpose: Adds an item, waiting while the queue is full
+ * Arguments: An open queue, a non-null item
+ * Returns: none
+ */
+void BQueue_put(T queue, void *item)
+{
+    assert(queue != NULL && item != NULL);
+    pthread_mutex_lock(&queue->lock);
+    assert(!queue->closed);
+    while (queue->count == queue->capacity) {
+        pthread_cond_wait(&queue->nonFull, &queue->lock);
+    }
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count++;
+    pthread_cond_signal(&queue->nonEmpty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/* Function: BQueue_get
+ * Purpose: Removes the oldest item, waiting while the queue is empty
+ * Arguments: The queue
+ * Returns: The item, or NULL once the queue is closed and empty
+ */
+void *BQueue_get(T queue)
+{
+    assert(queue != NULL);
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->closed) {
+        pthread_cond_wait(&queue->nonEmpty, &queue->lock);
+    }
+    void *item = NULL;
+    if (queue->count > 0) {
+        item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        pthread_cond_signal(&queue->nonFull);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}
+
+/* Function: BQueue_close
+ * Purpose: Marks the end of the items; waiting and later gets return
+ *          NULL once the queue is empty
+ * Arguments: The queue
+ * Returns: none
+ */
+void BQueue_close(T queue)
+{
+    assert(queue != NULL);
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->nonEmpty);
+    pthread_mutex_unlock(&queue->lock);
+}
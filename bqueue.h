@@ -0,0 +1,29 @@
+/*
+ *                              bqueue
+ *
+ *   Purpose:
+ *
+ *     Interface to a bounded, blocking, first-in first-out queue of
+ *     pointers, for handing work between threads. A put waits while
+ *     the queue is full, so a fast producer is held back by a slow
+ *     consumer; a get waits while it is empty. Once the queue is
+ *     closed, gets drain what is left and then return NULL.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef BQUEUE_INCLUDED
+#define BQUEUE_INCLUDED
+
+#define T BQueue_T
+typedef struct T *T;
+
+extern T     BQueue_new  (int capacity);
+extern void  BQueue_free (T *queue);
+extern void  BQueue_put  (T queue, void *item);
+extern void *BQueue_get  (T queue);
+extern void  BQueue_close(T queue);
+
+#undef T
+#endif
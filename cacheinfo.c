@@ -0,0 +1,90 @@
+/*
+ *                              cacheinfo
+ *
+ *   Purpose:
+ *
+ *     Implementation of the cache size queries. Sizes come from
+ *     sysconf where the C library reports them; otherwise they fall
+ *     back to the figures of the lab machines listed in the README.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <unistd.h>
+#include "cacheinfo.h"
+
+#define DEFAULT_L1   (32L * 1024)
+#define DEFAULT_L2   (1024L * 1024)
+#define DEFAULT_LLC  (16896L * 1024)
+#define DEFAULT_LINE 64L
+
+/* Function: query
+ * Purpose: Reads one sysconf value, substituting a fallback when the
+ *          value is unknown or unsupported
+ * Arguments: The sysconf name, the fallback value
+ * Returns: The value in bytes
+ */
+static long query(int name, long fallback)
+{
+    long value = sysconf(name);
+    return value > 0 ? value : fallback;
+}
+
+/* Function: CacheInfo_l1Bytes
+ * Purpose: Gets the size of the level 1 data cache
+ * Returns: The size in bytes
+ */
+long CacheInfo_l1Bytes(void)
+{
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    return query(_SC_LEVEL1_DCACHE_SIZE, DEFAULT_L1);
+#else
+    return DEFAULT_L1;
+#endif
+}
+
+/* Function: CacheInfo_l2Bytes
+ * Purpose: Gets the size of the level 2 cache
+ * Returns: The size in bytes
+ */
+long CacheInfo_l2Bytes(void)
+{
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    return query(_SC_LEVEL2_CACHE_SIZE, DEFAULT_L2);
+#else
+    return DEFAULT_L2;
+#endif
+}
+
+/* Function: CacheInfo_llcBytes
+ * Purpose: Gets the size of the last-level cache: level 3 if present,
+ *          otherwise level 2
+ * Returns: The size in bytes
+ */
+long CacheInfo_llcBytes(void)
+{
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l3 > 0) {
+        return l3;
+    }
+    if (sysconf(_SC_LEVEL2_CACHE_SIZE) > 0) {
+        return CacheInfo_l2Bytes();
+    }
+#endif
+    return DEFAULT_LLC;
+}
+
+/* Function: CacheInfo_lineBytes
+ * Purpose: Gets the size of a level 1 data cache line
+ * Returns: The size in bytes
+ */
+long CacheInfo_lineBytes(void)
+{
+#ifdef _SC_LEVEL1_DCACHE_LINESIZE
+    return query(_SC_LEVEL1_DCACHE_LINESIZE, DEFAULT_LINE);
+#else
+    return DEFAULT_LINE;
+#endif
+}
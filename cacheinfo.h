@@ -0,0 +1,22 @@
+/*
+ *                              cacheinfo
+ *
+ *   Purpose:
+ *
+ *     Interface for querying the data cache sizes of the machine, so
+ *     that transforms can size their working sets and decide when an
+ *     image is too large to stay cache-resident.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef CACHEINFO_INCLUDED
+#define CACHEINFO_INCLUDED
+
+extern long CacheInfo_l1Bytes  (void);
+extern long CacheInfo_l2Bytes  (void);
+extern long CacheInfo_llcBytes (void);
+extern long CacheInfo_lineBytes(void);
+
+#endif
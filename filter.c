@@ -0,0 +1,224 @@
+/*
+ *                              filter
+ *
+ *   Purpose:
+ *
+ *     Implementation of the separable filters. A tile of tw x th
+ *     destination pixels is computed from a (tw + 2r) x (th + 2r)
+ *     window of the source, r being the radius:
+ *
+ *       1. the window is loaded into a buffer of floats, three per
+ *          pixel, clamping coordinates at the image edge;
+ *       2. a horizontal pass reduces each window row to tw pixels;
+ *       3. a vertical pass reduces each group of 2r + 1 rows to one
+ *          destination row, which is rounded, clamped to the
+ *          denominator and stored.
+ *
+ *     Each pass is a loop over kernel taps around a loop over the
+ *     contiguous floats of a row, so the three channels of
+ *     neighbouring pixels are processed together and the compiler can
+ *     vectorize the inner loop.
+ *
+ *     Tiles are the blocks of a blocked array (whose halos come from
+ *     the neighbouring blocks), or bands of whole rows of an unblocked
+ *     one, sized so that the window stays within half of the L2 cache.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "assert.h"
+#include "mem.h"
+#include "cacheinfo.h"
+#include "rgbcells.h"
+#include "filter.h"
+
+#define MIN_BAND 8      /* fewest rows in a band of an unblocked array */
+#define MAX_BLOCK 256   /* larger blocks are split into tiles this big */
+
+typedef A2Methods_UArray2 A2;
+
+/* Buffers for one tile, allocated once for the largest tile */
+typedef struct Tile {
+    float *window;      /* (th + 2r) rows of (tw + 2r) * 3 floats */
+    float *across;      /* (th + 2r) rows of tw * 3 floats */
+    float *row;         /* one row of tw * 3 floats */
+} Tile;
+
+/* Function: makeWeights
+ * Purpose: Computes the normalized 2r + 1 taps of a filter's kernel
+ * Arguments: The filter, the radius, an array of 2 * radius + 1 floats
+ * Returns: none
+ */
+static void makeWeights(Filter_kind kind, int radius, float *weights)
+{
+    double sigma = radius / 2.0;
+    double total = 0;
+    for (int k = -radius; k <= radius; k++) {
+        double w = kind == FILTER_BOX ? 1.0
+                                      : exp(-k * k / (2 * sigma * sigma));
+        weights[k + radius] = w;
+        total += w;
+    }
+    for (int k = 0; k <= 2 * radius; k++) {
+        weights[k] /= total;
+    }
+}
+
+static inline int clamp(int value, int low, int high)
+{
+    return value < low ? low : value > high ? high : value;
+}
+
+/* Function: loadWindow
+ * Purpose: Copies a tile's window of the source into floats
+ * Arguments: The source cells, the top-left pixel and shape of the
+ *            tile, the radius, the window buffer
+ * Returns: none
+ */
+static void loadWindow(const RgbCells *src, int x0, int y0, int tw, int th,
+                       int radius, float *window)
+{
+    int ww = tw + 2 * radius;
+    for (int y = 0; y < th + 2 * radius; y++) {
+        int sy = clamp(y0 + y - radius, 0, src->height - 1);
+        float *out = window + (long)y * ww * 3;
+        for (int x = 0; x < ww; x++) {
+            int sx = clamp(x0 + x - radius, 0, src->width - 1);
+            const struct Pnm_rgb *pixel = RgbCells_at(src, sx, sy);
+            out[3 * x]     = pixel->red;
+            out[3 * x + 1] = pixel->green;
+            out[3 * x + 2] = pixel->blue;
+        }
+    }
+}
+
+static inline unsigned toSample(float value, unsigned denominator)
+{
+    if (value <= 0) {
+        return 0;
+    }
+    value += 0.5f;
+    return value >= denominator ? denominator : (unsigned)value;
+}
+
+/* Function: filterTile
+ * Purpose: Computes one tile of the destination
+ * Arguments: The source and destination cells, the filter and its
+ *            taps, the radius, the tile's top-left pixel and shape,
+ *            the tile buffers, the image's denominator
+ * Returns: none
+ */
+static void filterTile(const RgbCells *src, const RgbCells *dest,
+                       Filter_kind kind, const float *weights, int radius,
+                       int x0, int y0, int tw, int th, Tile *buffers,
+                       unsigned denominator)
+{
+    int taps = 2 * radius + 1;
+    int n = tw * 3;                     /* floats per destination row */
+    int wn = (tw + 2 * radius) * 3;     /* floats per window row */
+
+    loadWindow(src, x0, y0, tw, th, radius, buffers->window);
+
+    for (int y = 0; y < th + 2 * radius; y++) {
+        const float *in = buffers->window + (long)y * wn;
+        float *out = buffers->across + (long)y * n;
+        for (int idx = 0; idx < n; idx++) {
+            out[idx] = 0;
+        }
+        for (int k = 0; k < taps; k++) {
+            float w = weights[k];
+            const float *shifted = in + 3 * k;
+            for (int idx = 0; idx < n; idx++) {
+                out[idx] += w * shifted[idx];
+            }
+        }
+    }
+
+    float *row = buffers->row;
+    for (int y = 0; y < th; y++) {
+        for (int idx = 0; idx < n; idx++) {
+            row[idx] = 0;
+        }
+        for (int k = 0; k < taps; k++) {
+            float w = weights[k];
+            const float *across = buffers->across + (long)(y + k) * n;
+            for (int idx = 0; idx < n; idx++) {
+                row[idx] += w * across[idx];
+            }
+        }
+        if (kind == FILTER_SHARPEN) {
+            const float *center = buffers->window +
+                                  (long)(y + radius) * wn + 3 * radius;
+            for (int idx = 0; idx < n; idx++) {
+                row[idx] = 2 * center[idx] - row[idx];
+            }
+        }
+        for (int x = 0; x < tw; x++) {
+            struct Pnm_rgb *pixel = RgbCells_at(dest, x0 + x, y0 + y);
+            pixel->red   = toSample(row[3 * x], denominator);
+            pixel->green = toSample(row[3 * x + 1], denominator);
+            pixel->blue  = toSample(row[3 * x + 2], denominator);
+        }
+    }
+}
+
+/* Function: Filter_apply
+ * Purpose: Filters a Pnm_rgb image into another array of the same
+ *          shape and representation
+ * Arguments: The methods of both arrays, the source, the destination
+ *            (which must not be the source), the filter, its radius
+ *            (at least 1), and the image's denominator
+ * Returns: none
+ */
+void Filter_apply(A2Methods_T methods, A2 src, A2 dest, Filter_kind kind,
+                  int radius, unsigned denominator)
+{
+    assert(methods != NULL && src != NULL && dest != NULL);
+    assert(src != dest);
+    assert(radius >= 1);
+    RgbCells in = RgbCells_of(methods, src);
+    RgbCells out = RgbCells_of(methods, dest);
+    assert(in.width == out.width && in.height == out.height);
+    if (out.width == 0 || out.height == 0) {
+        return;
+    }
+
+    /* tiles are blocks, or bands of whole rows */
+    int tw, th;
+    int blocksize = methods->blocksize(dest);
+    if (blocksize > 1) {
+        tw = th = blocksize < MAX_BLOCK ? blocksize : MAX_BLOCK;
+    } else {
+        long rowBytes = (long)(out.width + 2 * radius) * 3 * sizeof(float);
+        tw = out.width;
+        th = CacheInfo_l2Bytes() / 2 / rowBytes - 2 * radius;
+        th = th < MIN_BAND ? MIN_BAND : th;
+    }
+    tw = tw < out.width ? tw : out.width;
+    th = th < out.height ? th : out.height;
+
+    float *weights = ALLOC((2 * radius + 1) * sizeof(float));
+    makeWeights(kind, radius, weights);
+    Tile buffers;
+    buffers.window = ALLOC((long)(th + 2 * radius) * (tw + 2 * radius) * 3
+                           * sizeof(float));
+    buffers.across = ALLOC((long)(th + 2 * radius) * tw * 3 * sizeof(float));
+    buffers.row = ALLOC((long)tw * 3 * sizeof(float));
+
+    for (int y0 = 0; y0 < out.height; y0 += th) {
+        int h = out.height - y0 < th ? out.height - y0 : th;
+        for (int x0 = 0; x0 < out.width; x0 += tw) {
+            int w = out.width - x0 < tw ? out.width - x0 : tw;
+            filterTile(&in, &out, kind, weights, radius, x0, y0, w, h,
+                       &buffers, denominator);
+        }
+    }
+
+    FREE(buffers.row);
+    FREE(buffers.across);
+    FREE(buffers.window);
+    FREE(weights);
+}
@@ -0,0 +1,35 @@
+/*
+ *                              filter
+ *
+ *   Purpose:
+ *
+ *     Interface to separable image filters on Pnm_rgb arrays: a box
+ *     blur, a Gaussian blur (sigma = radius / 2), and a sharpen that
+ *     adds back the difference between each pixel and its Gaussian
+ *     blur. Pixels beyond the image edge repeat the edge pixel.
+ *
+ *     The filters run tile by tile in the storage order of the array:
+ *     one block at a time for blocked arrays and one band of rows at a
+ *     time otherwise, each tile read together with a halo of 'radius'
+ *     pixels taken from its neighbours.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef FILTER_INCLUDED
+#define FILTER_INCLUDED
+
+#include "a2methods.h"
+
+typedef enum Filter_kind {
+    FILTER_BOX = 0,
+    FILTER_GAUSSIAN,
+    FILTER_SHARPEN
+} Filter_kind;
+
+extern void Filter_apply(A2Methods_T methods, A2Methods_UArray2 src,
+                         A2Methods_UArray2 dest, Filter_kind kind,
+                         int radius, unsigned denominator);
+
+#endif
@@ -0,0 +1,493 @@
+/*
+ *                              graymap
+ *
+ *   Purpose:
+ *
+ *     Implementation of PGM and PBM images and their rotations. Pixels
+ *     live in a row-major UArray2s: cells of one or two bytes for a
+ *     PGM (two-byte cells hold native 16-bit samples), or, for a PBM,
+ *     cells of one byte that each hold eight pixels, the leftmost in
+ *     the most significant bit, with each row padded to a whole byte.
+ *
+ *     Rotations by 90 and 270 degrees are transposes, with the order of
+ *     the rows or of the columns reversed. Bytes are moved in 8 x 8
+ *     blocks: eight source rows are loaded as eight 64-bit words and
+ *     transposed with three rounds of masked swaps, and each resulting
+ *     word is one eight-byte run of a destination row. Blocks are
+ *     visited in tiles of TILE x TILE pixels so that the source and
+ *     destination rows a tile touches stay in cache. Bitmaps are
+ *     transposed the same way, one byte of eight source rows becoming
+ *     one byte of eight destination rows. Two-byte samples, and the
+ *     strips on the edges of a byte image that do not fill a block, are
+ *     moved one at a time, tile by tile.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "mem.h"
+#include "uarray2spec.h"
+#include "graymap.h"
+
+#define T Graymap_T
+#define TILE 64
+
+struct T {
+    int width, height;
+    unsigned denominator;   /* 1 for a bitmap */
+    int bitmap;             /* 1 for a PBM */
+    int pitch;              /* bytes in a bitmap row */
+    UArray2s_T cells;       /* width cells wide, or pitch for a bitmap */
+};
+
+static T newMap(int width, int height, unsigned denominator, int bitmap)
+{
+    T map;
+    NEW(map);
+    map->width = width;
+    map->height = height;
+    map->denominator = denominator;
+    map->bitmap = bitmap;
+    map->pitch = (width + 7) / 8;
+    int size = !bitmap && denominator >= 256 ? 2 : 1;
+    map->cells = UArray2s_new(bitmap ? map->pitch : width, height, size);
+    return map;
+}
+
+static inline uint8_t *bytesRow(T map, int y)
+{
+    return UArray2s_at_1(map->cells, 0, y);
+}
+
+static inline uint16_t *shortsRow(T map, int y)
+{
+    return UArray2s_at_2(map->cells, 0, y);
+}
+
+static inline int minInt(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ *                          Reading and writing
+ * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/* Function: readBits
+ * Purpose: Reads the pixels of a PBM, clearing the padding bits
+ * Arguments: The file, the new map, whether the image is raw (P4)
+ * Returns: 1 on success, 0 if the image is truncated or malformed
+ */
+static int readBits(FILE *fp, T map, int raw)
+{
+    int pad = 8 * map->pitch - map->width;
+    for (int y = 0; y < map->height; y++) {
+        uint8_t *row = bytesRow(map, y);
+        if (raw) {
+            if (fread(row, map->pitch, 1, fp) != 1) {
+                return 0;
+            }
+            row[map->pitch - 1] &= 0xff << pad;
+            continue;
+        }
+        for (int x = 0; x < map->width; x++) {
+            int c = getc(fp);
+            while (c == '#' || isspace(c)) {
+                if (c == '#') {
+                    while (c != '\n' && c != EOF) {
+                        c = getc(fp);
+                    }
+                }
+                c = getc(fp);
+            }
+            if (c != '0' && c != '1') {
+                return 0;
+            }
+            row[x / 8] |= (c - '0') << (7 - x % 8);
+        }
+    }
+    return 1;
+}
+
+/* Function: readGray
+ * Purpose: Reads the samples of a PGM
+ * Arguments: The file, the new map, whether the image is raw (P5)
+ * Returns: 1 on success, 0 if the image is truncated or malformed, or
+ *          a sample exceeds the denominator
+ */
+static int readGray(FILE *fp, T map, int raw)
+{
+    int wide = map->cells->size == 2;
+    int w = map->width;
+    uint8_t *buffer = raw && wide ? ALLOC(2L * w) : NULL;
+    int ok = 1;
+    for (int y = 0; ok && y < map->height; y++) {
+        if (raw && !wide) {
+            uint8_t *row = bytesRow(map, y);
+            ok = fread(row, w, 1, fp) == 1;
+            /* a denominator of 255 admits every byte */
+            for (int x = 0; ok && map->denominator < 255 && x < w; x++) {
+                ok = row[x] <= map->denominator;
+            }
+        } else if (raw) {
+            uint16_t *row = shortsRow(map, y);
+            ok = fread(buffer, 2L * w, 1, fp) == 1;
+            for (int x = 0; ok && x < w; x++) {
+                row[x] = buffer[2 * x] << 8 | buffer[2 * x + 1];
+                ok = row[x] <= map->denominator;
+            }
+        } else {
+            for (int x = 0; ok && x < w; x++) {
+                unsigned value;
+                ok = PpmIO_readNumber(fp, &value) &&
+                     value <= map->denominator;
+                if (ok && wide) {
+                    shortsRow(map, y)[x] = value;
+                } else if (ok) {
+                    bytesRow(map, y)[x] = value;
+                }
+            }
+        }
+    }
+    FREE(buffer);
+    return ok;
+}
+
+/* Function: Graymap_read
+ * Purpose: Reads the pixels of a PGM or PBM
+ * Arguments: The file, positioned by PpmIO_readHeader; the header,
+ *            which must be a PGM's or a PBM's
+ * Returns: The image, or NULL if it is truncated or malformed
+ */
+T Graymap_read(FILE *fp, const struct PpmIO_header *header)
+{
+    assert(fp != NULL && header != NULL && !PpmIO_isColor(header));
+    int bitmap = header->format == 1 || header->format == 4;
+    T map = newMap(header->width, header->height, header->denominator,
+                   bitmap);
+    int ok = bitmap ? readBits(fp, map, header->raw)
+                    : readGray(fp, map, header->raw);
+    if (!ok) {
+        Graymap_free(&map);
+        return NULL;
+    }
+    return map;
+}
+
+/* Function: Graymap_write
+ * Purpose: Writes an image as a raw PGM or PBM, with two-byte samples
+ *          big-endian
+ * Arguments: The file, the image
+ * Returns: none
+ */
+void Graymap_write(FILE *fp, T map)
+{
+    assert(fp != NULL && map != NULL);
+    int w = map->width, h = map->height;
+    if (map->bitmap) {
+        fprintf(fp, "P4\n%d %d\n", w, h);
+        for (int y = 0; y < h; y++) {   /* rows may be padded apart */
+            fwrite(bytesRow(map, y), map->pitch, 1, fp);
+        }
+    } else if (map->cells->size == 1) {
+        fprintf(fp, "P5\n%d %d\n%u\n", w, h, map->denominator);
+        for (int y = 0; y < h; y++) {
+            fwrite(bytesRow(map, y), w, 1, fp);
+        }
+    } else {
+        fprintf(fp, "P5\n%d %d\n%u\n", w, h, map->denominator);
+        uint8_t *buffer = ALLOC(2L * w);
+        for (int y = 0; y < h; y++) {
+            const uint16_t *row = shortsRow(map, y);
+            for (int x = 0; x < w; x++) {
+                buffer[2 * x] = row[x] >> 8;
+                buffer[2 * x + 1] = row[x];
+            }
+            fwrite(buffer, 2L * w, 1, fp);
+        }
+        FREE(buffer);
+    }
+}
+
+void Graymap_free(T *map)
+{
+    assert(map != NULL && *map != NULL);
+    UArray2s_free(&(*map)->cells);
+    FREE(*map);
+}
+
+int Graymap_width(T map)
+{
+    assert(map != NULL);
+    return map->width;
+}
+
+int Graymap_height(T map)
+{
+    assert(map != NULL);
+    return map->height;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ *                              Rotations
+ * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/* Eight bytes as a word, the first in the least significant byte */
+static inline uint64_t load8(const uint8_t *p)
+{
+    uint64_t word = 0;
+    for (int k = 0; k < 8; k++) {
+        word |= (uint64_t)p[k] << (8 * k);
+    }
+    return word;
+}
+
+static inline void store8(uint8_t *p, uint64_t word)
+{
+    for (int k = 0; k < 8; k++) {
+        p[k] = word >> (8 * k);
+    }
+}
+
+/* Function: transposeBytes
+ * Purpose: Transposes an 8 x 8 matrix of bytes held as eight words,
+ *          byte k of word i being row i, column k: the off-diagonal
+ *          4 x 4, then 2 x 2, then 1 x 1 blocks are swapped
+ * Arguments: The rows
+ * Returns: none; afterwards byte k of word i is column i, row k
+ */
+static inline void transposeBytes(uint64_t rows[8])
+{
+    static const uint64_t masks[3] = {
+        0x00000000ffffffffULL, 0x0000ffff0000ffffULL, 0x00ff00ff00ff00ffULL
+    };
+    for (int round = 0, d = 4; d > 0; round++, d /= 2) {
+        int shift = 8 * d;
+        for (int i = 0; i < 8; i++) {
+            if ((i & d) == 0) {             /* rows i and i + d swap */
+                uint64_t t = ((rows[i] >> shift) ^ rows[i + d]) &
+                             masks[round];
+                rows[i] ^= t << shift;
+                rows[i + d] ^= t;
+            }
+        }
+    }
+}
+
+/* Function: transposeBits
+ * Purpose: Transposes an 8 x 8 matrix of bits, row i in byte i with
+ *          column 0 in its most significant bit (Hacker's Delight, 7-3)
+ * Arguments: The rows
+ * Returns: none; afterwards byte j holds column j, row 0 in its most
+ *          significant bit
+ */
+static inline void transposeBits(uint8_t rows[8])
+{
+    uint64_t x = 0;
+    for (int i = 0; i < 8; i++) {
+        x = x << 8 | rows[i];
+    }
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+    x = x ^ t ^ (t << 28);
+    for (int i = 7; i >= 0; i--, x >>= 8) {
+        rows[i] = x;
+    }
+}
+
+static inline uint8_t reverseBits(uint8_t b)
+{
+    b = (b & 0xf0) >> 4 | (b & 0x0f) << 4;
+    b = (b & 0xcc) >> 2 | (b & 0x33) << 2;
+    return (b & 0xaa) >> 1 | (b & 0x55) << 1;
+}
+
+/* Function: rotateBytes
+ * Purpose: Rotates an image of one-byte samples by 90 or 270 degrees,
+ *          block by block within tiles, then the edge strips
+ * Arguments: The source, the destination, the rotation
+ * Returns: none
+ */
+static void rotateBytes(T src, T dst, int rotation)
+{
+    int w = src->width, h = src->height;
+    int w8 = w & ~7, h8 = h & ~7;     /* the part made of whole blocks */
+
+    for (int y0 = 0; y0 < h8; y0 += TILE) {
+        for (int x0 = 0; x0 < w8; x0 += TILE) {
+            int yEnd = minInt(y0 + TILE, h8), xEnd = minInt(x0 + TILE, w8);
+            for (int y = y0; y < yEnd; y += 8) {
+                for (int x = x0; x < xEnd; x += 8) {
+                    uint64_t block[8];
+                    for (int i = 0; i < 8; i++) {
+                        int sy = rotation == 90 ? y + 7 - i : y + i;
+                        block[i] = load8(bytesRow(src, sy) + x);
+                    }
+                    transposeBytes(block);
+                    for (int j = 0; j < 8; j++) {
+                        if (rotation == 90) {   /* (x, y) -> (h-1-y, x) */
+                            store8(bytesRow(dst, x + j) + h - 8 - y,
+                                   block[j]);
+                        } else {                /* (x, y) -> (y, w-1-x) */
+                            store8(bytesRow(dst, w - 1 - x - j) + y,
+                                   block[j]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < h; y++) {
+        const uint8_t *in = bytesRow(src, y);
+        for (int x = y < h8 ? w8 : 0; x < w; x++) {
+            if (rotation == 90) {
+                bytesRow(dst, x)[h - 1 - y] = in[x];
+            } else {
+                bytesRow(dst, w - 1 - x)[y] = in[x];
+            }
+        }
+    }
+}
+
+/* Function: rotateShorts
+ * Purpose: Rotates an image of two-byte samples by 90 or 270 degrees,
+ *          tile by tile
+ * Arguments: The source, the destination, the rotation
+ * Returns: none
+ */
+static void rotateShorts(T src, T dst, int rotation)
+{
+    int w = src->width, h = src->height;
+    for (int y0 = 0; y0 < h; y0 += TILE) {
+        for (int x0 = 0; x0 < w; x0 += TILE) {
+            int yEnd = minInt(y0 + TILE, h), xEnd = minInt(x0 + TILE, w);
+            for (int y = y0; y < yEnd; y++) {
+                const uint16_t *in = shortsRow(src, y);
+                for (int x = x0; x < xEnd; x++) {
+                    if (rotation == 90) {
+                        shortsRow(dst, x)[h - 1 - y] = in[x];
+                    } else {
+                        shortsRow(dst, w - 1 - x)[y] = in[x];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Function: rotateBits
+ * Purpose: Rotates a bitmap by 90 or 270 degrees. Byte k of eight
+ *          destination rows is the transpose of one byte of the eight
+ *          source rows that become destination columns 8k to 8k + 7;
+ *          rows past the bottom of the source are zero, which leaves
+ *          the destination's padding clear
+ * Arguments: The source, the destination, the rotation
+ * Returns: none
+ */
+static void rotateBits(T src, T dst, int rotation)
+{
+    int w = src->width, h = src->height;
+    for (int k0 = 0; k0 < dst->pitch; k0 += 8) {
+        int kEnd = minInt(k0 + 8, dst->pitch);
+        for (int bx = 0; bx < src->pitch; bx++) {
+            for (int k = k0; k < kEnd; k++) {
+                uint8_t block[8];
+                for (int i = 0; i < 8; i++) {
+                    int sy = rotation == 90 ? h - 1 - (8 * k + i)
+                                            : 8 * k + i;
+                    block[i] = sy >= 0 && sy < h ? bytesRow(src, sy)[bx]
+                                                 : 0;
+                }
+                transposeBits(block);
+                for (int j = 0; j < 8 && 8 * bx + j < w; j++) {
+                    int dy = rotation == 90 ? 8 * bx + j
+                                            : w - 1 - (8 * bx + j);
+                    bytesRow(dst, dy)[k] = block[j];
+                }
+            }
+        }
+    }
+}
+
+/* Function: flipBits
+ * Purpose: Rotates a bitmap by 180 degrees: each row is reversed a
+ *          byte at a time, then shifted left past what was padding
+ * Arguments: The source, the destination
+ * Returns: none
+ */
+static void flipBits(T src, T dst)
+{
+    int pitch = src->pitch;
+    int pad = 8 * pitch - src->width;
+    uint8_t *reversed = ALLOC(pitch + 1);
+    reversed[pitch] = 0;
+    for (int y = 0; y < src->height; y++) {
+        const uint8_t *in = bytesRow(src, y);
+        uint8_t *out = bytesRow(dst, src->height - 1 - y);
+        for (int k = 0; k < pitch; k++) {
+            reversed[k] = reverseBits(in[pitch - 1 - k]);
+        }
+        for (int k = 0; k < pitch; k++) {
+            out[k] = reversed[k] << pad | reversed[k + 1] >> (8 - pad);
+        }
+    }
+    FREE(reversed);
+}
+
+/* Function: Graymap_rotate
+ * Purpose: Rotates an image clockwise into a new one
+ * Arguments: The image, the rotation (0, 90, 180 or 270)
+ * Returns: The rotated image
+ */
+T Graymap_rotate(T src, int rotation)
+{
+    assert(src != NULL);
+    assert(rotation == 0 || rotation == 90 ||
+           rotation == 180 || rotation == 270);
+    int w = src->width, h = src->height;
+    int sideways = rotation == 90 || rotation == 270;
+    T dst = newMap(sideways ? h : w, sideways ? w : h, src->denominator,
+                   src->bitmap);
+
+    if (rotation == 0) {
+        memcpy(dst->cells->elems, src->cells->elems,
+               (long)src->cells->pitch * h * src->cells->size);
+    } else if (src->bitmap) {
+        if (rotation == 180) {
+            flipBits(src, dst);
+        } else {
+            rotateBits(src, dst, rotation);
+        }
+    } else if (rotation == 180 && src->cells->size == 1) {
+        for (int y = 0; y < h; y++) {
+            const uint8_t *in = bytesRow(src, y);
+            uint8_t *out = bytesRow(dst, h - 1 - y);
+            for (int x = 0; x < w; x++) {
+                out[w - 1 - x] = in[x];
+            }
+        }
+    } else if (rotation == 180) {
+        for (int y = 0; y < h; y++) {
+            const uint16_t *in = shortsRow(src, y);
+            uint16_t *out = shortsRow(dst, h - 1 - y);
+            for (int x = 0; x < w; x++) {
+                out[w - 1 - x] = in[x];
+            }
+        }
+    } else if (src->cells->size == 1) {
+        rotateBytes(src, dst, rotation);
+    } else {
+        rotateShorts(src, dst, rotation);
+    }
+    return dst;
+}
@@ -0,0 +1,37 @@
+/*
+ *                              graymap
+ *
+ *   Purpose:
+ *
+ *     Interface to grayscale (PGM) and bilevel (PBM) images, rotated in
+ *     their own representation rather than as Pnm_rgb pixels. A PGM
+ *     keeps one byte per pixel, or two when its denominator is 256 or
+ *     more; a PBM keeps one bit per pixel, packed eight to a byte as
+ *     in a raw PBM file. Rotations by right angles move whole words:
+ *     8 x 8 blocks of bytes or of bits are transposed in a 64-bit word.
+ *
+ *     Graymap_read takes a file whose header PpmIO_readHeader has read
+ *     (see ppmio.h); Graymap_write writes a raw PGM (P5) or PBM (P4).
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef GRAYMAP_INCLUDED
+#define GRAYMAP_INCLUDED
+
+#include <stdio.h>
+#include "ppmio.h"
+
+#define T Graymap_T
+typedef struct T *T;
+
+extern T    Graymap_read  (FILE *fp, const struct PpmIO_header *header);
+extern T    Graymap_rotate(T source, int rotation);
+extern void Graymap_write (FILE *fp, T map);
+extern void Graymap_free  (T *map);
+extern int  Graymap_width (T map);
+extern int  Graymap_height(T map);
+
+#undef T
+#endif
@@ -0,0 +1,267 @@
+/*
+ *                              pipeline
+ *
+ *   Purpose:
+ *
+ *     Implementation of the pipelined rotation. Pixels never become
+ *     Pnm_rgb cells: the reader delivers bands already in the raw
+ *     output encoding (see ppmio.h), so a transform only moves 3- or
+ *     6-byte pixels and the writer only calls fwrite.
+ *
+ *       0 degrees    reader -> writer: each source band is an output
+ *                    band, written as the next one is read.
+ *       other        reader -> workers: each band is copied to its
+ *                    rotated place in one output image, several bands
+ *                    at once when there are several workers (their
+ *                    writes never overlap). When every band is placed,
+ *                    the output image goes to the writer band by band.
+ *
+ *     The queues hold QUEUE_BANDS bands, which bounds the memory held
+ *     between stages and makes a fast stage wait for a slow one.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "assert.h"
+#include "mem.h"
+#include "cacheinfo.h"
+#include "bqueue.h"
+#include "ppmio.h"
+#include "pipeline.h"
+
+#define QUEUE_BANDS 4
+
+/* Struct band
+* A run of whole rows, of the source or of the output
+*/
+struct band {
+    int first;              /* index of the first row */
+    int rows;
+    unsigned char *bytes;   /* raw rows */
+    int owned;              /* bytes belong to the band, not the image */
+};
+
+/* Struct pipeline
+* State shared by the stages
+*/
+struct pipeline {
+    FILE *in, *out;
+    struct PpmIO_header header;
+    int rotation;
+    int pixelBytes;
+    long rowBytes;          /* bytes in a source row */
+    int bandRows;           /* rows in a source band */
+    int outWidth, outHeight;
+    long outRowBytes;
+    unsigned char *image;   /* the output, unless rotation is 0 */
+    BQueue_T toWorkers;     /* source bands to place */
+    BQueue_T toWriter;      /* output bands, in order */
+    int truncated;          /* set by the reader */
+};
+
+static struct band *newBand(int first, int rows, long rowBytes)
+{
+    struct band *band;
+    NEW(band);
+    band->first = first;
+    band->rows = rows;
+    band->bytes = ALLOC(rows * rowBytes);
+    band->owned = 1;
+    return band;
+}
+
+static void freeBand(struct band *band)
+{
+    if (band->owned) {
+        FREE(band->bytes);
+    }
+    FREE(band);
+}
+
+/* Function: reader
+ * Purpose: Reads the source band by band, handing each band on as soon
+ *          as it is read
+ * Arguments: The pipeline
+ * Returns: NULL
+ */
+static void *reader(void *vpipe)
+{
+    struct pipeline *pipe = vpipe;
+    int height = pipe->header.height;
+    BQueue_T next = pipe->rotation == 0 ? pipe->toWriter : pipe->toWorkers;
+
+    for (int first = 0; first < height; first += pipe->bandRows) {
+        int rows = height - first < pipe->bandRows ? height - first
+                                                   : pipe->bandRows;
+        struct band *band = newBand(first, rows, pipe->rowBytes);
+        int got = PpmIO_readRows(pipe->in, &pipe->header, band->bytes,
+                                 rows);
+        if (got < rows) {
+            pipe->truncated = 1;
+            freeBand(band);
+            break;
+        }
+        BQueue_put(next, band);
+    }
+    BQueue_close(next);
+    return NULL;
+}
+
+/* Function: place
+ * Purpose: Copies a source band to its rotated place in the output
+ * Arguments: The pipeline, the band
+ * Returns: none
+ */
+static void place(struct pipeline *pipe, struct band *band)
+{
+    int w = pipe->header.width;
+    int h = pipe->header.height;
+    int pb = pipe->pixelBytes;
+    long outRow = pipe->outRowBytes;
+
+    for (int k = 0; k < band->rows; k++) {
+        int y = band->first + k;
+        const unsigned char *src = band->bytes + k * pipe->rowBytes;
+        unsigned char *dst;
+        long step;          /* output bytes between source neighbours */
+
+        switch (pipe->rotation) {
+        case 90:            /* src(x, y) -> out(h - y - 1, x) */
+            dst = pipe->image + (long)(h - y - 1) * pb;
+            step = outRow;
+            break;
+        case 180:           /* src(x, y) -> out(w - x - 1, h - y - 1) */
+            dst = pipe->image + (h - y - 1) * outRow + (long)(w - 1) * pb;
+            step = -pb;
+            break;
+        default:            /* 270: src(x, y) -> out(y, w - x - 1) */
+            dst = pipe->image + (w - 1) * outRow + (long)y * pb;
+            step = -outRow;
+            break;
+        }
+        if (pb == 3) {
+            for (int x = 0; x < w; x++, src += 3, dst += step) {
+                memcpy(dst, src, 3);
+            }
+        } else {
+            for (int x = 0; x < w; x++, src += 6, dst += step) {
+                memcpy(dst, src, 6);
+            }
+        }
+    }
+}
+
+static void *worker(void *vpipe)
+{
+    struct pipeline *pipe = vpipe;
+    struct band *band;
+    while ((band = BQueue_get(pipe->toWorkers)) != NULL) {
+        place(pipe, band);
+        freeBand(band);
+    }
+    return NULL;
+}
+
+/* Function: writer
+ * Purpose: Writes the output header, then each output band as it
+ *          arrives
+ * Arguments: The pipeline
+ * Returns: NULL
+ */
+static void *writer(void *vpipe)
+{
+    struct pipeline *pipe = vpipe;
+    struct band *band;
+    fprintf(pipe->out, "P6\n%d %d\n%u\n", pipe->outWidth, pipe->outHeight,
+            pipe->header.denominator);
+    while ((band = BQueue_get(pipe->toWriter)) != NULL) {
+        fwrite(band->bytes, pipe->outRowBytes, band->rows, pipe->out);
+        freeBand(band);
+    }
+    fflush(pipe->out);
+    return NULL;
+}
+
+/* Function: Pipeline_run
+ * Purpose: Reads a PPM, rotates it and writes it as a raw PPM, with
+ *          reading, transforming and writing overlapped
+ * Arguments: The input and output files, the rotation (0, 90, 180 or
+ *            270), and the number of transform workers
+ * Returns: 0 on success; 1, after a message on stderr, if the input is
+ *          not a PPM or ends early (the output is then incomplete)
+ */
+int Pipeline_run(FILE *in, FILE *out, int rotation, int workers)
+{
+    assert(in != NULL && out != NULL && workers >= 1);
+    assert(rotation == 0 || rotation == 90 ||
+           rotation == 180 || rotation == 270);
+    struct pipeline pipe;
+    pipe.in = in;
+    pipe.out = out;
+    pipe.rotation = rotation;
+    pipe.truncated = 0;
+    if (!PpmIO_readHeader(in, &pipe.header) ||
+        !PpmIO_isColor(&pipe.header)) {
+        fprintf(stderr, "Input is not a PPM image\n");
+        return 1;
+    }
+    int sideways = rotation == 90 || rotation == 270;
+    pipe.pixelBytes = PpmIO_pixelBytes(&pipe.header);
+    pipe.rowBytes = (long)pipe.header.width * pipe.pixelBytes;
+    pipe.outWidth = sideways ? pipe.header.height : pipe.header.width;
+    pipe.outHeight = sideways ? pipe.header.width : pipe.header.height;
+    pipe.outRowBytes = (long)pipe.outWidth * pipe.pixelBytes;
+    pipe.bandRows = CacheInfo_l2Bytes() / 2 / pipe.rowBytes;
+    pipe.bandRows = pipe.bandRows < 1 ? 1 : pipe.bandRows;
+    pipe.image = rotation == 0 ? NULL
+                               : ALLOC(pipe.outHeight * pipe.outRowBytes);
+    pipe.toWorkers = BQueue_new(QUEUE_BANDS);
+    pipe.toWriter = BQueue_new(QUEUE_BANDS);
+
+    pthread_t readThread, writeThread;
+    pthread_t *workThreads = CALLOC(workers, sizeof(pthread_t));
+    pthread_create(&readThread, NULL, reader, &pipe);
+    pthread_create(&writeThread, NULL, writer, &pipe);
+    if (rotation != 0) {
+        for (int k = 0; k < workers; k++) {
+            pthread_create(&workThreads[k], NULL, worker, &pipe);
+        }
+    }
+
+    pthread_join(readThread, NULL);
+    if (rotation != 0) {
+        for (int k = 0; k < workers; k++) {
+            pthread_join(workThreads[k], NULL);
+        }
+        /* every band is placed: hand the output over band by band */
+        int outBand = CacheInfo_l2Bytes() / 2 / pipe.outRowBytes;
+        outBand = outBand < 1 ? 1 : outBand;
+        for (int first = 0; first < pipe.outHeight && !pipe.truncated;
+             first += outBand) {
+            struct band *band;
+            NEW(band);
+            band->first = first;
+            band->rows = pipe.outHeight - first < outBand
+                                ? pipe.outHeight - first : outBand;
+            band->bytes = pipe.image + first * pipe.outRowBytes;
+            band->owned = 0;
+            BQueue_put(pipe.toWriter, band);
+        }
+        BQueue_close(pipe.toWriter);
+    }
+    pthread_join(writeThread, NULL);
+
+    FREE(workThreads);
+    FREE(pipe.image);
+    BQueue_free(&pipe.toWriter);
+    BQueue_free(&pipe.toWorkers);
+    if (pipe.truncated) {
+        fprintf(stderr, "Input image is truncated or malformed\n");
+        return 1;
+    }
+    return 0;
+}
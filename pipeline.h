@@ -0,0 +1,27 @@
+/*
+ *                              pipeline
+ *
+ *   Purpose:
+ *
+ *     Interface to pipelined rotation of a PPM stream. A reader
+ *     thread decodes the input in bands of rows, transform workers
+ *     place each band in the output as soon as it arrives, and a
+ *     writer thread drains finished output bands, with bounded queues
+ *     between the stages. At 0 degrees every output band is ready as
+ *     soon as its source band is read, so reading and writing overlap
+ *     completely; the other rotations need the last source row before
+ *     the first output row is complete, so there reading overlaps the
+ *     transform and the writer follows.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef PIPELINE_INCLUDED
+#define PIPELINE_INCLUDED
+
+#include <stdio.h>
+
+extern int Pipeline_run(FILE *in, FILE *out, int rotation, int workers);
+
+#endif
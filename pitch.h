@@ -0,0 +1,54 @@
+/*
+ *                              pitch
+ *
+ *   Purpose:
+ *
+ *     The padded strides of the in-memory arrays. A cache finds the
+ *     set of a line from the low bits of its address, so cells whose
+ *     addresses differ by a large power of two share a set: walking
+ *     down a column of an image 1024 or 2048 pixels wide touches one
+ *     line per row, and those lines crowd into a few sets and evict
+ *     each other long before the cache is full. UArray2 and UArray2s
+ *     pad their rows, and UArray2b and the blocked UArray2s pad their
+ *     blocks, to a stride whose lines step through every set.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef PITCH_INCLUDED
+#define PITCH_INCLUDED
+
+/* the line of every x86 core and most ARM ones; on a machine with
+   longer lines the padded strides are still spread over twice as many
+   sets as the unpadded ones */
+#define PITCH_LINE 64
+
+/* Function: Pitch_pad
+ * Purpose: Chooses the stride of a row (or block) of cells. A stride
+ *          of a multiple of four lines is lengthened to the nearest one
+ *          that is an odd number of lines, which visits every set of a
+ *          cache with a power-of-two number of sets before revisiting
+ *          one. Any other stride already spreads over at least a
+ *          quarter of the sets and is left alone.
+ * Arguments: The cells in the row, the bytes in a cell
+ * Returns: The cells from the start of one row to the start of the
+ *          next; 'cells' itself if no padding is needed or cells of
+ *          'size' bytes cannot make an odd number of lines
+ */
+static inline int Pitch_pad(int cells, int size)
+{
+    if (cells == 0 || (long)cells * size % (4 * PITCH_LINE) != 0) {
+        return cells;
+    }
+    for (int padded = cells + 1; padded <= cells + 2 * PITCH_LINE;
+         padded++) {
+        long bytes = (long)padded * size;
+        if (bytes % (2 * PITCH_LINE) == PITCH_LINE) {
+            return padded;
+        }
+    }
+    return cells;
+}
+
+#endif
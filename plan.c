@@ -0,0 +1,593 @@
+/*
+ *                              plan
+ *
+ *   Purpose:
+ *
+ *     Implementation of the planner. Every candidate -- rows or
+ *     blocks, fused or through an array walked by scatter, gather or
+ *     stream -- is priced as the sum of its steps, and the cheapest
+ *     wins; ties go to the candidate tried first, rows before blocks
+ *     and fused before arrays.
+ *
+ *     A calibration times each step on an image of the planner's own
+ *     making, small enough that a column of it fits in half the level
+ *     1 cache, so the measured coefficients carry none of the penalties
+ *     the model adds for larger images. The saved coefficients are
+ *     used only on a machine whose caches match those they were
+ *     measured with.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "assert.h"
+#include "mem.h"
+#include "pnm.h"
+#include "cputiming.h"
+#include "cacheinfo.h"
+#include "a2spec.h"
+#include "a2convert.h"
+#include "ppmio.h"
+#include "tiled.h"
+#include "plan.h"
+
+typedef A2Methods_UArray2 A2;
+
+#define CACHE_VERSION 1
+#define REPEATS       7     /* a calibrated cost is the best of these */
+#define MIN_BLOCKSIZE 8
+#define MIN_SIDE      64    /* of the calibration image */
+#define WRITE_MISS    2.0   /* a write miss also fetches the line for
+                               ownership, and later writes it back */
+#define NS_PER_BYTE   0.1   /* moving a byte to or from memory */
+#define NSLOTS        38    /* doubles in struct costs */
+#define SLOT_NAME     32
+
+/* nanoseconds an access costs when its line is found in the level 1
+ * cache, the level 2 cache, the last-level cache and memory */
+static const double LATENCY[4] = { 0, 4, 15, 60 };
+
+/* Struct costs
+* Per-pixel costs, in nanoseconds, of the steps of a rotation on an
+* image whose strided walks stay in the level 1 cache. The last index
+* of fused and rotate is the rotation over 90, and the order index of
+* rotate is the order less TRANSFORM_SCATTER
+*/
+struct costs {
+    double readPpm[2];          /* parse a raw PPM into rows, blocks */
+    double readTiled;           /* load a tiled file into its blocks */
+    double convert;             /* copy rows into blocks (a2convert.h) */
+    double fused[2][4];         /* write oriented (ppmio.h) */
+    double rotate[2][3][4];     /* Transform_rotate into a new array */
+    double write[2];            /* write an array as a PPM */
+};
+
+/* measured on a Xeon with 48KB of level 1 data cache, 2MB of level 2
+ * and 105MB of level 3 */
+static const struct costs DEFAULT_COSTS = {
+    { 3.9, 8.2 },                                       /* readPpm */
+    2.1,                                                /* readTiled */
+    2.1,                                                /* convert */
+    { { 3.1, 4.5, 3.6, 4.5 }, { 6.6, 7.1, 7.5, 6.9 } },  /* fused */
+    { { { 2.0, 4.7, 2.0, 4.6 },                         /* rotate */
+        { 2.0, 3.5, 1.8, 3.6 },
+        { 4.9, 62.3, 5.4, 62.4 } },
+      { { 4.3, 5.1, 4.3, 4.9 },
+        { 4.5, 5.7, 4.6, 6.3 },
+        { 11.1, 12.3, 11.6, 13.8 } } },
+    { 15.5, 15.6 }                                      /* write */
+};
+
+static struct costs machineCosts;   /* valid when calibrated is 1 */
+static int calibrated = -1;         /* -1 until the cache is looked at */
+
+static const char *const LAYOUTS[2] = { "rows", "blocks" };
+static const char *const ORDERS[3]  = { "scatter", "gather", "stream" };
+
+/* Function: slotsOf
+ * Purpose: Lists the costs of a struct costs with their names in the
+ *          cache file, in the file's order
+ * Arguments: The costs, room for NSLOTS pointers and names
+ * Returns: none
+ */
+static void slotsOf(struct costs *c, double *slots[NSLOTS],
+                    char names[NSLOTS][SLOT_NAME])
+{
+    int n = 0;
+#define SLOT(VALUE, ...)                                                  \
+    (slots[n] = &(VALUE), snprintf(names[n++], SLOT_NAME, __VA_ARGS__))
+    for (int l = 0; l < 2; l++) {
+        SLOT(c->readPpm[l], "read-ppm-%s", LAYOUTS[l]);
+    }
+    SLOT(c->readTiled, "read-tiled");
+    SLOT(c->convert, "convert");
+    for (int l = 0; l < 2; l++) {
+        for (int r = 0; r < 4; r++) {
+            SLOT(c->fused[l][r], "fused-%s-%d", LAYOUTS[l], r * 90);
+        }
+    }
+    for (int l = 0; l < 2; l++) {
+        for (int o = 0; o < 3; o++) {
+            for (int r = 0; r < 4; r++) {
+                SLOT(c->rotate[l][o][r], "%s-%s-%d", ORDERS[o],
+                     LAYOUTS[l], r * 90);
+            }
+        }
+    }
+    for (int l = 0; l < 2; l++) {
+        SLOT(c->write[l], "write-%s", LAYOUTS[l]);
+    }
+#undef SLOT
+    assert(n == NSLOTS);
+}
+
+/* Function: loadCosts
+ * Purpose: Reads a calibration saved by saveCosts
+ * Arguments: The path of the file, the costs to fill
+ * Returns: 1 if the file holds a calibration for this machine's caches
+ */
+static int loadCosts(const char *path, struct costs *c)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return 0;
+    }
+    double *slots[NSLOTS];
+    char names[NSLOTS][SLOT_NAME];
+    slotsOf(c, slots, names);
+    int version;
+    long l1, l2, llc, line;
+    int ok = fscanf(fp, "ppmtrans-plan %d %ld %ld %ld %ld", &version, &l1,
+                    &l2, &llc, &line) == 5 &&
+             version == CACHE_VERSION && l1 == CacheInfo_l1Bytes() &&
+             l2 == CacheInfo_l2Bytes() && llc == CacheInfo_llcBytes() &&
+             line == CacheInfo_lineBytes();
+    for (int k = 0; ok && k < NSLOTS; k++) {
+        char name[SLOT_NAME];
+        ok = fscanf(fp, " %31s %lf", name, slots[k]) == 2 &&
+             strcmp(name, names[k]) == 0 && *slots[k] >= 0;
+    }
+    fclose(fp);
+    return ok;
+}
+
+/* Function: saveCosts
+ * Purpose: Writes a calibration, with the cache sizes it was made with
+ * Arguments: The path of the file, the costs
+ * Returns: 1 on success, 0 if the file cannot be written
+ */
+static int saveCosts(const char *path, struct costs *c)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        return 0;
+    }
+    double *slots[NSLOTS];
+    char names[NSLOTS][SLOT_NAME];
+    slotsOf(c, slots, names);
+    fprintf(fp, "ppmtrans-plan %d %ld %ld %ld %ld\n", CACHE_VERSION,
+            CacheInfo_l1Bytes(), CacheInfo_l2Bytes(), CacheInfo_llcBytes(),
+            CacheInfo_lineBytes());
+    for (int k = 0; k < NSLOTS; k++) {
+        fprintf(fp, "%s %.3f\n", names[k], *slots[k]);
+    }
+    return fclose(fp) == 0;
+}
+
+/* Function: costsInUse
+ * Purpose: Finds the coefficients to price plans with, looking for a
+ *          calibration the first time
+ * Arguments: none
+ * Returns: This machine's calibrated costs, or the defaults
+ */
+static const struct costs *costsInUse(void)
+{
+    if (calibrated < 0) {
+        const char *path = Plan_cachePath();
+        calibrated = path != NULL && loadCosts(path, &machineCosts);
+    }
+    return calibrated ? &machineCosts : &DEFAULT_COSTS;
+}
+
+/* Function: missCost
+ * Purpose: Prices an access to one of a set of lines that is walked
+ *          over and over: the latency of the nearest level that holds
+ *          the whole set
+ * Arguments: The bytes of the set
+ * Returns: Nanoseconds per access
+ */
+static double missCost(double bytes)
+{
+    if (bytes <= CacheInfo_l1Bytes()) {
+        return LATENCY[0];
+    } else if (bytes <= CacheInfo_l2Bytes()) {
+        return LATENCY[1];
+    } else if (bytes <= CacheInfo_llcBytes()) {
+        return LATENCY[2];
+    }
+    return LATENCY[3];
+}
+
+/* Function: blocksizeFor
+ * Purpose: Picks a blocksize whose source and destination blocks fit
+ *          in the level 1 cache together
+ * Arguments: The bytes per cell
+ * Returns: The blocksize
+ */
+static int blocksizeFor(int size)
+{
+    int blocksize = sqrt(CacheInfo_l1Bytes() / (2.0 * size));
+    return blocksize < MIN_BLOCKSIZE ? MIN_BLOCKSIZE : blocksize;
+}
+
+/* Function: stridePenalty
+ * Purpose: Prices the strided side of a 90 or 270 degree rotation into
+ *          an array: the destination columns a scatter writes or the
+ *          source columns a gather reads, each pixel on its own line.
+ *          The stream kernels work in cache-sized tiles, and 0 and 180
+ *          degrees walk both sides along their rows.
+ * Arguments: The job, the layout and its blocksize, the order
+ * Returns: Nanoseconds per pixel
+ */
+static double stridePenalty(const struct Plan_job *job, Plan_layout layout,
+                            int blocksize, Transform_order order)
+{
+    if (job->rotation % 180 == 0 || order == TRANSFORM_STREAM) {
+        return 0;
+    }
+    double miss = order == TRANSFORM_SCATTER ? WRITE_MISS : 1;
+    if (layout == PLAN_BLOCKS) {
+        return miss * missCost(2.0 * blocksize * blocksize * job->size);
+    }
+    /* a destination column is as long as the source is wide */
+    int lines = order == TRANSFORM_SCATTER ? job->width : job->height;
+    return miss * missCost((double)lines * CacheInfo_lineBytes());
+}
+
+/* Function: trafficCost
+ * Purpose: Prices moving an image through memory several times, which
+ *          is paid only when a source and a destination together
+ *          overflow the last-level cache
+ * Arguments: The job, the number of times the image is moved
+ * Returns: Nanoseconds per pixel
+ */
+static double trafficCost(const struct Plan_job *job, int passes)
+{
+    double bytes = (double)job->width * job->height * job->size;
+    if (2 * bytes <= CacheInfo_llcBytes()) {
+        return 0;
+    }
+    return passes * job->size * NS_PER_BYTE;
+}
+
+/* Function: consider
+ * Purpose: Keeps the cheaper of the best plan so far and a candidate
+ * Arguments: The best plan so far, the candidate
+ * Returns: none
+ */
+static void consider(struct Plan *best, const struct Plan *candidate)
+{
+    if (candidate->cost < best->cost) {
+        *best = *candidate;
+    }
+}
+
+/* Function: Plan_choose
+ * Purpose: Prices every way of carrying out a rotation and picks the
+ *          cheapest
+ * Arguments: The rotation
+ * Returns: The plan
+ */
+struct Plan Plan_choose(const struct Plan_job *job)
+{
+    assert(job != NULL && job->width > 0 && job->height > 0);
+    assert(job->size > 0 && job->threads > 0 && job->tiledBlocksize >= 0);
+    assert(job->rotation >= 0 && job->rotation < 360 &&
+           job->rotation % 90 == 0);
+    const struct costs *c = costsInUse();
+    int r = job->rotation / 90;
+    struct Plan best = { PLAN_ROWS, 1, 1, TRANSFORM_AUTO, 1, HUGE_VAL,
+                         calibrated };
+
+    for (Plan_layout layout = PLAN_ROWS; layout <= PLAN_BLOCKS; layout++) {
+        int blocksize = layout == PLAN_ROWS ? 1
+                        : job->tiledBlocksize > 0 ? job->tiledBlocksize
+                                                  : blocksizeFor(job->size);
+        /* a tiled file is read as its blocks and filters run on rows;
+         * any other layout costs a conversion */
+        double read;
+        if (job->tiledBlocksize > 0) {
+            read = c->readTiled;
+        } else {
+            read = c->readPpm[job->filtered ? PLAN_ROWS : layout];
+        }
+        if (job->tiledBlocksize > 0 ? layout == PLAN_ROWS
+                                    : job->filtered && layout == PLAN_BLOCKS) {
+            read += c->convert + trafficCost(job, 3);
+        }
+
+        struct Plan fused = { layout, blocksize, 1, TRANSFORM_AUTO, 1,
+                              read + c->fused[layout][r] +
+                              trafficCost(job, 1), calibrated };
+        consider(&best, &fused);
+
+        /* several threads rotate an array only by gathering */
+        for (Transform_order order = TRANSFORM_SCATTER;
+             order <= TRANSFORM_STREAM; order++) {
+            if (job->threads > 1 && order != TRANSFORM_GATHER) {
+                continue;
+            }
+            double rotate = c->rotate[layout][order - TRANSFORM_SCATTER][r]
+                            + stridePenalty(job, layout, blocksize, order);
+            struct Plan array = { layout, blocksize, 0, order, job->threads,
+                                  read + rotate / job->threads +
+                                  c->write[layout] +
+                                  trafficCost(job, order == TRANSFORM_STREAM
+                                                   ? 3 : 4),
+                                  calibrated };
+            consider(&best, &array);
+        }
+    }
+    return best;
+}
+
+/* Function: Plan_methods
+ * Purpose: Finds the table for the arrays of a plan
+ * Arguments: The plan, the bytes per cell
+ * Returns: The a2spec table
+ */
+A2Methods_T Plan_methods(const struct Plan *plan, int size)
+{
+    assert(plan != NULL);
+    A2Methods_T methods = plan->layout == PLAN_ROWS ? A2Spec_plain(size)
+                                                    : A2Spec_blocked(size);
+    assert(methods != NULL);
+    return methods;
+}
+
+/* Function: Plan_cachePath
+ * Purpose: Finds where calibrations are kept
+ * Arguments: none
+ * Returns: $PPMTRANS_PLAN if set, else .ppmtrans-plan in the home
+ *          directory, else NULL
+ */
+const char *Plan_cachePath(void)
+{
+    static char path[4096];
+    const char *env = getenv("PPMTRANS_PLAN");
+    if (env != NULL && *env != '\0') {
+        return env;
+    }
+    const char *home = getenv("HOME");
+    if (home == NULL || *home == '\0') {
+        return NULL;
+    }
+    snprintf(path, sizeof(path), "%s/.ppmtrans-plan", home);
+    return path;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ *                          Calibration
+ * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/* Struct sample
+* The image a calibration times its steps on, and the step's settings
+*/
+struct sample {
+    Pnm_ppm image[2];           /* the same pixels as rows and blocks */
+    char *ppm, *tiled;          /* the image as a raw PPM, tiled file */
+    size_t ppmLength, tiledLength;
+    FILE *sink;                 /* /dev/null */
+    Plan_layout layout;
+    Transform_order order;
+    int rotation;
+    int failed;                 /* a step could not read the image */
+};
+
+typedef void step(struct sample *s);
+
+/*
+ * The steps: each carries out one step of a rotation of the sample
+ * image, as ppmtrans would, and throws the result away
+ */
+
+static A2Methods_T methodsOf(struct sample *s, Plan_layout layout)
+{
+    return (A2Methods_T)s->image[layout]->methods;
+}
+
+static void readPpmStep(struct sample *s)
+{
+    FILE *fp = fmemopen(s->ppm, s->ppmLength, "rb");
+    struct PpmIO_header header;
+    Pnm_ppm image = NULL;
+    A2Methods_T methods = methodsOf(s, s->layout);
+    if (fp == NULL) {
+        s->failed = 1;
+        return;
+    }
+    if (PpmIO_readHeader(fp, &header)) {
+        image = PpmIO_readPixels(fp, &header, methods,
+                                 methods->blocksize(s->image[s->layout]
+                                                    ->pixels), NULL);
+    }
+    fclose(fp);
+    if (image == NULL) {
+        s->failed = 1;
+        return;
+    }
+    Pnm_ppmfree(&image);
+}
+
+static void readTiledStep(struct sample *s)
+{
+    FILE *fp = fmemopen(s->tiled, s->tiledLength, "rb");
+    if (fp == NULL) {
+        s->failed = 1;
+        return;
+    }
+    Pnm_ppm image = Tiled_read(fp, methodsOf(s, PLAN_BLOCKS));
+    fclose(fp);
+    if (image == NULL) {
+        s->failed = 1;
+        return;
+    }
+    Pnm_ppmfree(&image);
+}
+
+static void convertStep(struct sample *s)
+{
+    A2Methods_T from = methodsOf(s, PLAN_ROWS);
+    A2Methods_T to = methodsOf(s, PLAN_BLOCKS);
+    A2 blocks = s->image[PLAN_BLOCKS]->pixels;
+    A2 copy = to->new_with_blocksize(to->width(blocks), to->height(blocks),
+                                     to->size(blocks),
+                                     to->blocksize(blocks));
+    A2Convert_copy(from, s->image[PLAN_ROWS]->pixels, to, copy);
+    to->free(&copy);
+}
+
+static void fusedStep(struct sample *s)
+{
+    PpmIO_writeOriented(s->sink, s->image[s->layout], s->rotation);
+}
+
+static void rotateStep(struct sample *s)
+{
+    A2Methods_T methods = methodsOf(s, s->layout);
+    A2 src = s->image[s->layout]->pixels;
+    A2 dest = Transform_newDest(methods, src, s->rotation);
+    Transform_rotate(methods, methods->map_default, src, dest, s->rotation,
+                     s->order);
+    methods->free(&dest);
+}
+
+static void writeStep(struct sample *s)
+{
+    Pnm_ppmwrite(s->sink, s->image[s->layout]);
+}
+
+/* Function: timeStep
+ * Purpose: Times a calibration step, once to warm the caches and then
+ *          REPEATS times
+ * Arguments: The step, its sample
+ * Returns: The fastest run, in nanoseconds per pixel; meaningless if
+ *          the step set the sample's 'failed' flag
+ */
+static double timeStep(step run, struct sample *s)
+{
+    double pixels = (double)s->image[PLAN_ROWS]->width *
+                    s->image[PLAN_ROWS]->height;
+    CPUTime_T timer = CPUTime_New();
+    double best = HUGE_VAL;
+    run(s);
+    for (int k = 0; !s->failed && k < REPEATS; k++) {
+        CPUTime_Start(timer);
+        run(s);
+        double ns = CPUTime_Stop(timer);
+        best = ns < best ? ns : best;
+    }
+    CPUTime_Free(&timer);
+    fflush(s->sink);
+    return best / pixels;
+}
+
+/* Function: newSample
+ * Purpose: Makes the calibration image, square and with columns that
+ *          fit in half the level 1 cache, in both layouts and both
+ *          file formats
+ * Arguments: The sample to fill, with its sink open
+ * Returns: none
+ */
+static void newSample(struct sample *s)
+{
+    int side = CacheInfo_l1Bytes() / CacheInfo_lineBytes() / 2;
+    side = side < MIN_SIDE ? MIN_SIDE : side;
+    int size = sizeof(struct Pnm_rgb);
+    A2Methods_T plain = A2Spec_plain(size);
+    A2Methods_T blocked = A2Spec_blocked(size);
+    A2 rows = plain->new(side, side, size);
+    for (int j = 0; j < side; j++) {
+        for (int i = 0; i < side; i++) {
+            struct Pnm_rgb *pixel = plain->at(rows, i, j);
+            pixel->red = i % 256;
+            pixel->green = j % 256;
+            pixel->blue = (i * j) % 256;
+        }
+    }
+    A2 blocks = blocked->new_with_blocksize(side, side, size,
+                                            blocksizeFor(size));
+    A2Convert_copy(plain, rows, blocked, blocks);
+
+    A2 arrays[2] = { rows, blocks };
+    for (int l = 0; l < 2; l++) {
+        Pnm_ppm image;
+        NEW(image);
+        image->width = image->height = side;
+        image->denominator = 255;
+        image->pixels = arrays[l];
+        image->methods = l == PLAN_ROWS ? plain : blocked;
+        s->image[l] = image;
+    }
+
+    FILE *fp = open_memstream(&s->ppm, &s->ppmLength);
+    assert(fp != NULL);
+    Pnm_ppmwrite(fp, s->image[PLAN_ROWS]);
+    fclose(fp);
+    fp = open_memstream(&s->tiled, &s->tiledLength);
+    assert(fp != NULL);
+    Tiled_write(fp, s->image[PLAN_BLOCKS]);
+    fclose(fp);
+}
+
+/* Function: Plan_calibrate
+ * Purpose: Measures this machine's coefficients, uses them for the rest
+ *          of the run and saves them
+ * Arguments: The path of the file to save them in
+ * Returns: 1 on success, 0 if a step cannot read its sample image or
+ *          the file cannot be written
+ */
+int Plan_calibrate(const char *path)
+{
+    assert(path != NULL);
+    struct sample s;
+    s.sink = fopen("/dev/null", "w");
+    assert(s.sink != NULL);
+    s.failed = 0;
+    newSample(&s);
+    struct costs c;
+
+    for (int l = 0; l < 2; l++) {
+        s.layout = l;
+        c.readPpm[l] = timeStep(readPpmStep, &s);
+        for (int r = 0; r < 4; r++) {
+            s.rotation = r * 90;
+            c.fused[l][r] = timeStep(fusedStep, &s);
+            for (int o = 0; o < 3; o++) {
+                s.order = TRANSFORM_SCATTER + o;
+                c.rotate[l][o][r] = timeStep(rotateStep, &s);
+            }
+        }
+        c.write[l] = timeStep(writeStep, &s);
+    }
+    c.readTiled = timeStep(readTiledStep, &s);
+    c.convert = timeStep(convertStep, &s);
+
+    for (int l = 0; l < 2; l++) {
+        Pnm_ppmfree(&s.image[l]);
+    }
+    free(s.ppm);
+    free(s.tiled);
+    fclose(s.sink);
+    if (s.failed) {
+        return 0;
+    }
+
+    machineCosts = c;
+    calibrated = 1;
+    return saveCosts(path, &c);
+}
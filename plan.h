@@ -0,0 +1,71 @@
+/*
+ *                              plan
+ *
+ *   Purpose:
+ *
+ *     Interface to the planner behind ppmtrans -auto. Given the shape
+ *     of a right-angle rotation, the planner prices every way ppmtrans
+ *     can carry it out and picks the cheapest: the layout the image is
+ *     rotated from (rows or blocks, and the blocksize), whether the
+ *     rotation is fused into the write or fills a destination array,
+ *     and the traversal of that array.
+ *
+ *     A price is in nanoseconds per pixel: reading the input into the
+ *     layout, rotating, and writing the result. Each step costs a
+ *     coefficient measured on a small image, whose strided walks stay
+ *     in the level 1 cache, plus penalties worked out from the cache
+ *     sizes (cacheinfo.h) for walks whose lines overflow a cache and
+ *     for images that overflow the last-level cache. The coefficients
+ *     are those of the machine the defaults were measured on, unless
+ *     Plan_calibrate has measured this machine's and saved them.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef PLAN_INCLUDED
+#define PLAN_INCLUDED
+
+#include "a2methods.h"
+#include "transform.h"
+
+typedef enum Plan_layout { PLAN_ROWS = 0, PLAN_BLOCKS } Plan_layout;
+
+/* Struct Plan_job
+* What the planner is told about a rotation
+*/
+struct Plan_job {
+    int width, height;      /* of the source image */
+    int size;               /* bytes per pixel in memory */
+    int rotation;           /* 0, 90, 180 or 270 */
+    int tiledBlocksize;     /* of a tiled input, read as its blocks;
+                               0 for a PPM */
+    int filtered;           /* filters run over rows before rotating */
+    int threads;            /* threads that may rotate an array */
+};
+
+/* Struct Plan
+* How to carry a rotation out
+*/
+struct Plan {
+    Plan_layout layout;     /* of the source, and of the destination
+                               array unless the rotation is fused */
+    int blocksize;          /* of PLAN_BLOCKS arrays */
+    int fused;              /* rotate while writing; no destination */
+    Transform_order order;  /* traversal of the destination array */
+    int threads;            /* threads rotating the destination array */
+    double cost;            /* predicted nanoseconds per pixel */
+    int calibrated;         /* priced with this machine's coefficients */
+};
+
+extern struct Plan  Plan_choose   (const struct Plan_job *job);
+/* the a2spec table of the plan's layout, for cells of 'size' bytes */
+extern A2Methods_T  Plan_methods  (const struct Plan *plan, int size);
+/* where calibrations are kept: $PPMTRANS_PLAN, else ~/.ppmtrans-plan;
+ * NULL if neither is set */
+extern const char  *Plan_cachePath(void);
+/* measures this machine's coefficients and saves them at 'path';
+ * 0 if a timed step fails or the file cannot be written */
+extern int          Plan_calibrate(const char *path);
+
+#endif
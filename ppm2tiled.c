@@ -0,0 +1,57 @@
+/*
+ *                              ppm2tiled
+ *
+ *   Purpose:
+ *
+ *     Converts a PPM image (P3 or P6) to the tiled format of tiled.h,
+ *     with the blocks ppmtrans -block-major would use, so that images
+ *     rotated again and again are parsed once:
+ *
+ *         ppm2tiled [image.ppm] > image.tiled
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "assert.h"
+#include "a2methods.h"
+#include "a2spec.h"
+#include "pnm.h"
+#include "ppmio.h"
+#include "tiled.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [image.ppm] > image.tiled\n", argv[0]);
+        exit(1);
+    }
+    FILE *in = argc == 2 ? fopen(argv[1], "rb") : stdin;
+    if (in == NULL) {
+        fprintf(stderr, "%s: Could not open file %s for reading\n",
+                argv[0], argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    struct PpmIO_header header;
+    if (!PpmIO_readHeader(in, &header) || !PpmIO_isColor(&header)) {
+        fprintf(stderr, "%s: input is not a PPM image\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    A2Methods_T methods = A2Spec_blocked(sizeof(struct Pnm_rgb));
+    assert(methods != NULL);
+    Pnm_ppm image = PpmIO_readPixels(in, &header, methods, 0, NULL);
+    if (image == NULL) {
+        fprintf(stderr, "%s: input is not a complete PPM image\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    Tiled_write(stdout, image);
+    Pnm_ppmfree(&image);
+    return fflush(stdout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
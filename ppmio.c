@@ -0,0 +1,649 @@
+/*
+ *                              ppmio
+ *
+ *   Purpose:
+ *
+ *     Implementation of the fused orient-and-write output. The output
+ *     is produced band by band, a band being as many whole output rows
+ *     as fit in half of the L2 cache. Within a band the source is read
+ *     along its rows: for 0 and 180 degrees one output row is one
+ *     source row, and for 90 and 270 degrees a band of output rows is a
+ *     band of source columns, so each source row contributes one short
+ *     contiguous run that is scattered down one column of the band.
+ *     The band buffer stays in cache while it is filled, and leaves it
+ *     once, through fwrite.
+ *
+ *     Samples are written the way Pnm_ppmwrite writes them: one byte
+ *     each when the denominator is below 256, two big-endian bytes
+ *     otherwise.
+ *
+ *     Reading follows the netpbm header rules: whitespace and '#'
+ *     comments may separate the fields, and a single whitespace
+ *     character ends the header of a raw image. Headers of PGM and PBM
+ *     images are read too, for graymap.h. Raw rows are already
+ *     in the output encoding and are read as they are; plain rows are
+ *     parsed sample by sample.
+ *
+ *     PpmIO_readPixels parses a whole plain image at once. The text after the
+ *     header is split into chunks that end at whitespace, so no number
+ *     straddles two chunks. A first parallel pass counts the numbers
+ *     in each chunk, eight bytes at a time; a prefix sum of the counts
+ *     tells each chunk the index of its first sample; a second
+ *     parallel pass parses the chunks, each storing its samples
+ *     straight into their cells. A raw image is read a chunk of rows at
+ *     a time, each chunk decoded in parallel bands of rows, so only the
+ *     array holds the whole image.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "mem.h"
+#include "a2methods.h"
+#include "cacheinfo.h"
+#include "rgbcells.h"
+#include "ppmio.h"
+
+typedef A2Methods_UArray2 A2;
+
+/* Function: putPixel
+ * Purpose: Stores one pixel's samples in an output buffer
+ * Arguments: Where the pixel goes, the pixel, whether samples are
+ *            two bytes wide
+ * Returns: none
+ */
+static inline void putPixel(unsigned char *out, const struct Pnm_rgb *pixel,
+                            int wide)
+{
+    if (wide) {
+        out[0] = pixel->red >> 8;
+        out[1] = pixel->red;
+        out[2] = pixel->green >> 8;
+        out[3] = pixel->green;
+        out[4] = pixel->blue >> 8;
+        out[5] = pixel->blue;
+    } else {
+        out[0] = pixel->red;
+        out[1] = pixel->green;
+        out[2] = pixel->blue;
+    }
+}
+
+/* Function: fillBand
+ * Purpose: Assembles output rows [r0, r0 + rows) of the rotated image
+ * Arguments: The source image, the rotation, the band buffer, the
+ *            first output row and number of rows in the band, the
+ *            bytes per output row and per output pixel
+ * Returns: none
+ */
+static void fillBand(Pnm_ppm pixmap, int rotation, unsigned char *band,
+                     int r0, int rows, long rowBytes, int pixelBytes)
+{
+    const struct A2Methods_T *methods = pixmap->methods;
+    A2 src = pixmap->pixels;
+    int w = pixmap->width;
+    int h = pixmap->height;
+    int wide = pixelBytes == 6;
+
+    if (rotation == 0 || rotation == 180) {
+        /* output (c, r) = src(c, r), or src(w - c - 1, h - r - 1) */
+        for (int k = 0; k < rows; k++) {
+            unsigned char *out = band + k * rowBytes;
+            int y = rotation == 0 ? r0 + k : h - r0 - k - 1;
+            for (int x = 0; x < w; x++) {
+                int c = rotation == 0 ? x : w - x - 1;
+                putPixel(out + (long)c * pixelBytes,
+                         methods->at(src, x, y), wide);
+            }
+        }
+        return;
+    }
+
+    /* 90: output (c, r) = src(r, h - c - 1);
+       270: output (c, r) = src(w - r - 1, c) */
+    int x0 = rotation == 90 ? r0 : w - r0 - rows;
+    for (int y = 0; y < h; y++) {
+        int c = rotation == 90 ? h - y - 1 : y;
+        unsigned char *out = band + (long)c * pixelBytes;
+        for (int x = x0; x < x0 + rows; x++) {
+            int k = rotation == 90 ? x - r0 : w - x - 1 - r0;
+            putPixel(out + k * rowBytes, methods->at(src, x, y), wide);
+        }
+    }
+}
+
+/* Function: PpmIO_writeOriented
+ * Purpose: Writes an image, rotated, as a raw PPM without building
+ *          the rotated image
+ * Arguments: The output file, the unrotated image, and the rotation:
+ *            0, 90, 180 or 270
+ * Returns: none
+ */
+void PpmIO_writeOriented(FILE *fp, Pnm_ppm pixmap, int rotation)
+{
+    assert(fp != NULL && pixmap != NULL);
+    assert(rotation == 0 || rotation == 90 ||
+           rotation == 180 || rotation == 270);
+    int sideways = rotation == 90 || rotation == 270;
+    int outWidth  = sideways ? pixmap->height : pixmap->width;
+    int outHeight = sideways ? pixmap->width : pixmap->height;
+    int pixelBytes = pixmap->denominator < 256 ? 3 : 6;
+    long rowBytes = (long)outWidth * pixelBytes;
+
+    fprintf(fp, "P6\n%d %d\n%u\n", outWidth, outHeight,
+            pixmap->denominator);
+    if (rowBytes == 0 || outHeight == 0) {
+        return;
+    }
+
+    long bandRows = CacheInfo_l2Bytes() / 2 / rowBytes;
+    if (bandRows < 1) {
+        bandRows = 1;
+    } else if (bandRows > outHeight) {
+        bandRows = outHeight;
+    }
+    unsigned char *band = ALLOC(bandRows * rowBytes);
+
+    for (int r0 = 0; r0 < outHeight; r0 += bandRows) {
+        int rows = outHeight - r0 < bandRows ? outHeight - r0 : bandRows;
+        fillBand(pixmap, rotation, band, r0, rows, rowBytes, pixelBytes);
+        fwrite(band, rowBytes, rows, fp);
+    }
+    FREE(band);
+}
+
+/* Function: PpmIO_readNumber
+ * Purpose: Reads an unsigned decimal number, skipping whitespace and
+ *          comments before it, and consuming the character after it
+ * Arguments: The file, a pointer receiving the number
+ * Returns: 1 on success, 0 at end of file or on anything else
+ */
+int PpmIO_readNumber(FILE *fp, unsigned *number)
+{
+    assert(fp != NULL && number != NULL);
+    int c = getc(fp);
+    while (c == '#' || isspace(c)) {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = getc(fp);
+            }
+        }
+        c = getc(fp);
+    }
+    if (!isdigit(c)) {
+        return 0;
+    }
+    unsigned long value = 0;
+    while (isdigit(c)) {
+        value = value * 10 + (c - '0');
+        if (value > 0xffffffffUL) {
+            return 0;
+        }
+        c = getc(fp);
+    }
+    *number = value;
+    return 1;
+}
+
+/* Function: PpmIO_readHeader
+ * Purpose: Reads the header of a netpbm image (P1 to P6), leaving the
+ *          file at the first sample
+ * Arguments: The file, the header to fill in
+ * Returns: 1 on success, 0 if the file does not start with a valid
+ *          header
+ */
+int PpmIO_readHeader(FILE *fp, struct PpmIO_header *header)
+{
+    assert(fp != NULL && header != NULL);
+    if (getc(fp) != 'P') {
+        return 0;
+    }
+    int kind = getc(fp);
+    if (kind < '1' || kind > '6') {
+        return 0;
+    }
+    header->format = kind - '0';
+    header->raw = header->format >= 4;
+    header->denominator = 1;            /* bitmaps have no maxval */
+    if (!PpmIO_readNumber(fp, &header->width) ||
+        !PpmIO_readNumber(fp, &header->height)) {
+        return 0;
+    }
+    if (header->format != 1 && header->format != 4 &&
+        !PpmIO_readNumber(fp, &header->denominator)) {
+        return 0;
+    }
+    return header->width > 0 && header->height > 0 &&
+           header->denominator > 0 && header->denominator < 65536;
+}
+
+/* Function: PpmIO_isColor
+ * Purpose: Tells whether a header is that of a PPM (P3 or P6)
+ * Arguments: The header
+ * Returns: 1 for a PPM, 0 for a PGM or PBM
+ */
+int PpmIO_isColor(const struct PpmIO_header *header)
+{
+    assert(header != NULL);
+    return header->format == 3 || header->format == 6;
+}
+
+/* Function: PpmIO_pixelBytes
+ * Purpose: Tells how many bytes encode one raw pixel of an image
+ * Arguments: The image's header
+ * Returns: 3 or 6
+ */
+int PpmIO_pixelBytes(const struct PpmIO_header *header)
+{
+    assert(header != NULL);
+    return header->denominator < 256 ? 3 : 6;
+}
+
+/* Function: PpmIO_readRows
+ * Purpose: Reads the next rows of a P3 or P6 image as raw PPM rows
+ * Arguments: The file, positioned by PpmIO_readHeader or an earlier
+ *            call; its header; room for 'count' rows; the number of
+ *            rows wanted
+ * Returns: The number of whole rows read, less than 'count' only if
+ *          the image is truncated or malformed
+ */
+int PpmIO_readRows(FILE *fp, const struct PpmIO_header *header,
+                   unsigned char *rows, int count)
+{
+    assert(fp != NULL && header != NULL && rows != NULL && count >= 0);
+    int pixelBytes = PpmIO_pixelBytes(header);
+    long rowBytes = (long)header->width * pixelBytes;
+
+    if (header->raw) {
+        return fread(rows, rowBytes, count, fp);
+    }
+    long samples = (long)header->width * 3;
+    for (int r = 0; r < count; r++) {
+        unsigned char *out = rows + r * rowBytes;
+        for (long k = 0; k < samples; k++) {
+            unsigned value;
+            if (!PpmIO_readNumber(fp, &value) ||
+                value > header->denominator) {
+                return r;
+            }
+            if (pixelBytes == 6) {
+                *out++ = value >> 8;
+            }
+            *out++ = value;
+        }
+    }
+    return count;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ *              Reading a whole image into an A2 array
+ * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MIN_CHUNK 65536     /* fewest bytes of text per parse task */
+#define CHUNKS_PER_WORKER 4
+
+/* Struct parse_job
+* A P3 payload split into chunks that end at whitespace, and where the
+* samples of each chunk go
+*/
+struct parse_job {
+    const unsigned char *text;
+    long *bounds;           /* chunk k is text[bounds[k], bounds[k + 1]) */
+    long *firsts;           /* samples in chunk k, then index of its first */
+    int *failed;            /* set for a chunk with a bad character/value */
+    RgbCells cells;
+    unsigned denominator;
+    long samples;           /* 3 * width * height */
+};
+
+/* Struct decode_job
+* Raw rows, and the rows of the array they fill
+*/
+struct decode_job {
+    const unsigned char *bytes;     /* rows first to first + rows - 1 */
+    int first, rows;
+    int pixelBytes;
+    int bandRows;
+    RgbCells cells;
+};
+
+static inline int isSpace(unsigned char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+#define ONES 0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+
+/* Function: digitBytes
+ * Purpose: Finds the ASCII digits among eight bytes at once: each byte
+ *          is masked to 7 bits and offset so that its high bit tells
+ *          whether it is at least '0', and whether it is above '9'
+ * Arguments: Eight bytes, as loaded from memory
+ * Returns: 0x80 in each byte that is a digit, 0 in the others
+ */
+static inline uint64_t digitBytes(uint64_t word)
+{
+    uint64_t low = word & ~HIGHS;
+    uint64_t atLeast0 = low + (0x80 - '0') * ONES;
+    uint64_t above9 = low + (0x80 - '9' - 1) * ONES;
+    return atLeast0 & ~above9 & ~word & HIGHS;
+}
+
+/* Function: countSamples
+ * Purpose: Counts the numbers in a run of text, eight bytes at a time:
+ *          a number starts at each digit byte whose predecessor is not
+ *          a digit
+ * Arguments: The text, its length
+ * Returns: The number of runs of digits
+ */
+static long countSamples(const unsigned char *text, long length)
+{
+    long count = 0;
+    uint64_t carry = 0;     /* whether the byte before is a digit */
+    long k = 0;
+    for (; k + 8 <= length; k += 8) {
+        uint64_t word;
+        memcpy(&word, text + k, 8);
+        uint64_t digits = digitBytes(word);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        uint64_t before = digits >> 8 | carry << 56;
+        carry = digits & 0x80;
+#else
+        uint64_t before = digits << 8 | carry;
+        carry = digits >> 56;
+#endif
+        count += __builtin_popcountll(digits & ~before);
+    }
+    int inDigits = carry != 0;
+    for (; k < length; k++) {
+        int digit = text[k] >= '0' && text[k] <= '9';
+        count += digit && !inDigits;
+        inDigits = digit;
+    }
+    return count;
+}
+
+static void countTask(int task, int worker, void *cl)
+{
+    struct parse_job *job = cl;
+    (void)worker;
+    job->firsts[task] = countSamples(job->text + job->bounds[task],
+                                     job->bounds[task + 1] -
+                                     job->bounds[task]);
+}
+
+/* Function: parseTask
+ * Purpose: Parses one chunk, storing each sample straight into its
+ *          cell; samples past the image's last are ignored
+ * Arguments: The chunk, the worker (unused), the parse_job
+ * Returns: none
+ */
+static void parseTask(int task, int worker, void *cl)
+{
+    struct parse_job *job = cl;
+    const unsigned char *p = job->text + job->bounds[task];
+    const unsigned char *end = job->text + job->bounds[task + 1];
+    long sample = job->firsts[task];
+    int width = job->cells.width;
+    long pixel = sample / 3;
+    int channel = sample % 3;
+    int x = pixel % width;
+    int y = pixel / width;
+    struct Pnm_rgb *cell = NULL;
+    (void)worker;
+
+    while (p < end && sample < job->samples) {
+        if (isSpace(*p)) {
+            p++;
+            continue;
+        }
+        unsigned value = 0;
+        const unsigned char *digits = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (value <= job->denominator) {    /* else too big anyway */
+                value = value * 10 + (*p - '0');
+            }
+            p++;
+        }
+        if (p == digits || (p < end && !isSpace(*p)) ||
+            value > job->denominator) {
+            job->failed[task] = 1;
+            return;
+        }
+        if (cell == NULL) {
+            cell = RgbCells_at(&job->cells, x, y);
+        }
+        if (channel == 0) {
+            cell->red = value;
+        } else if (channel == 1) {
+            cell->green = value;
+        } else {
+            cell->blue = value;
+            channel = -1;
+            cell = NULL;
+            if (++x == width) {
+                x = 0;
+                y++;
+            }
+        }
+        channel++;
+        sample++;
+    }
+}
+
+/* Function: parsePlain
+ * Purpose: Parses the samples of a P3 image into its array: chunks are
+ *          counted in parallel, a prefix sum gives each chunk its first
+ *          sample, and the chunks are parsed in parallel
+ * Arguments: The text after the header, its length, the cells, the
+ *            denominator, a pool or NULL
+ * Returns: 1 on success, 0 if the text is short or malformed
+ */
+static int parsePlain(const unsigned char *text, long length,
+                      RgbCells cells, unsigned denominator, WorkPool_T pool)
+{
+    int workers = pool == NULL ? 1 : WorkPool_workers(pool);
+    long chunks = length / MIN_CHUNK + 1;
+    if (chunks > workers * CHUNKS_PER_WORKER) {
+        chunks = workers * CHUNKS_PER_WORKER;
+    }
+    struct parse_job job;
+    job.text = text;
+    job.bounds = CALLOC(chunks + 1, sizeof(long));
+    job.firsts = CALLOC(chunks, sizeof(long));
+    job.failed = CALLOC(chunks, sizeof(int));
+    job.cells = cells;
+    job.denominator = denominator;
+    job.samples = 3L * cells.width * cells.height;
+    for (int k = 1; k < chunks; k++) {
+        long b = length * k / chunks;
+        b = b < job.bounds[k - 1] ? job.bounds[k - 1] : b;
+        while (b < length && !isSpace(text[b])) {
+            b++;
+        }
+        job.bounds[k] = b;
+    }
+    job.bounds[chunks] = length;
+
+    if (pool != NULL) {
+        WorkPool_run(pool, chunks, countTask, &job);
+    } else {
+        for (int k = 0; k < chunks; k++) {
+            countTask(k, 0, &job);
+        }
+    }
+    long total = 0;
+    for (int k = 0; k < chunks; k++) {
+        long count = job.firsts[k];
+        job.firsts[k] = total;
+        total += count;
+    }
+
+    int ok = total >= job.samples;
+    if (ok && pool != NULL) {
+        WorkPool_run(pool, chunks, parseTask, &job);
+    } else if (ok) {
+        for (int k = 0; k < chunks; k++) {
+            parseTask(k, 0, &job);
+        }
+    }
+    for (int k = 0; ok && k < chunks; k++) {
+        ok = !job.failed[k];
+    }
+    FREE(job.failed);
+    FREE(job.firsts);
+    FREE(job.bounds);
+    return ok;
+}
+
+static void decodeTask(int task, int worker, void *cl)
+{
+    struct decode_job *job = cl;
+    int width = job->cells.width;
+    int first = job->first + task * job->bandRows;
+    int last = first + job->bandRows;
+    last = last < job->first + job->rows ? last : job->first + job->rows;
+    (void)worker;
+    for (int y = first; y < last; y++) {
+        const unsigned char *in = job->bytes + (long)(y - job->first) *
+                                               width * job->pixelBytes;
+        for (int x = 0; x < width; x++) {
+            struct Pnm_rgb *cell = RgbCells_at(&job->cells, x, y);
+            if (job->pixelBytes == 3) {
+                cell->red = in[0];
+                cell->green = in[1];
+                cell->blue = in[2];
+            } else {
+                cell->red = in[0] << 8 | in[1];
+                cell->green = in[2] << 8 | in[3];
+                cell->blue = in[4] << 8 | in[5];
+            }
+            in += job->pixelBytes;
+        }
+    }
+}
+
+/* Function: decodeRaw
+ * Purpose: Reads the samples of a P6 image into its array, a chunk of
+ *          rows at a time, decoding bands of each chunk in parallel
+ * Arguments: The file, the header, the cells, a pool or NULL
+ * Returns: 1 on success, 0 if the image is short or a sample exceeds
+ *          the denominator
+ */
+static int decodeRaw(FILE *fp, const struct PpmIO_header *header,
+                     RgbCells cells, WorkPool_T pool)
+{
+    struct decode_job job;
+    job.pixelBytes = PpmIO_pixelBytes(header);
+    job.cells = cells;
+    long rowBytes = (long)cells.width * job.pixelBytes;
+    job.bandRows = CacheInfo_l2Bytes() / 2 / rowBytes;
+    job.bandRows = job.bandRows < 1 ? 1 : job.bandRows;
+    int workers = pool == NULL ? 1 : WorkPool_workers(pool);
+    int chunkRows = job.bandRows * workers * CHUNKS_PER_WORKER;
+    unsigned char *bytes = ALLOC(rowBytes * chunkRows);
+    job.bytes = bytes;
+
+    int ok = 1;
+    for (job.first = 0; ok && job.first < cells.height;
+         job.first += chunkRows) {
+        job.rows = cells.height - job.first < chunkRows
+                        ? cells.height - job.first : chunkRows;
+        ok = PpmIO_readRows(fp, header, bytes, job.rows) == job.rows;
+        for (long k = 0; ok && job.pixelBytes == 6 &&
+                         k < rowBytes * job.rows; k += 2) {
+            ok = (unsigned)(bytes[k] << 8 | bytes[k + 1]) <=
+                 header->denominator;
+        }
+        /* a denominator of 255 admits every byte */
+        for (long k = 0; ok && job.pixelBytes == 3 &&
+                         header->denominator < 255 &&
+                         k < rowBytes * job.rows; k++) {
+            ok = bytes[k] <= header->denominator;
+        }
+        int bands = (job.rows + job.bandRows - 1) / job.bandRows;
+        if (ok && pool != NULL) {
+            WorkPool_run(pool, bands, decodeTask, &job);
+        } else if (ok) {
+            for (int k = 0; k < bands; k++) {
+                decodeTask(k, 0, &job);
+            }
+        }
+    }
+    FREE(bytes);
+    return ok;
+}
+
+/* Function: readRest
+ * Purpose: Reads a file to its end
+ * Arguments: The file, a pointer receiving the number of bytes read
+ * Returns: The bytes, in memory the caller must FREE
+ */
+static unsigned char *readRest(FILE *fp, long *length)
+{
+    long size = MIN_CHUNK, used = 0;
+    unsigned char *text = ALLOC(size);
+    size_t got;
+    while ((got = fread(text + used, 1, size - used, fp)) > 0) {
+        used += got;
+        if (used == size) {
+            size *= 2;
+            RESIZE(text, size);
+        }
+    }
+    *length = used;
+    return text;
+}
+
+/* Function: PpmIO_readPixels
+ * Purpose: Reads the pixels of a P3 or P6 image into a new Pnm_ppm, with
+ *          the same pixels Pnm_ppmread would give. The array is filled
+ *          in place, on the pool's workers if a pool is given
+ * Arguments: The file, positioned by PpmIO_readHeader; the header, which
+ *            must be a PPM's; the methods of the array to build and its
+ *            blocksize, 0 for the default; a pool or NULL
+ * Returns: The image, to be freed with Pnm_ppmfree, or NULL if the file
+ *          is not a complete, valid PPM
+ */
+Pnm_ppm PpmIO_readPixels(FILE *fp, const struct PpmIO_header *header,
+                         A2Methods_T methods, int blocksize,
+                         WorkPool_T pool)
+{
+    assert(fp != NULL && header != NULL && methods != NULL);
+    assert(PpmIO_isColor(header) && blocksize >= 0);
+    A2 pixels = blocksize > 0
+                ? methods->new_with_blocksize(header->width, header->height,
+                                              sizeof(struct Pnm_rgb),
+                                              blocksize)
+                : methods->new(header->width, header->height,
+                               sizeof(struct Pnm_rgb));
+    RgbCells cells = RgbCells_of(methods, pixels);
+    int ok;
+    if (header->raw) {
+        ok = decodeRaw(fp, header, cells, pool);
+    } else {
+        long length;
+        unsigned char *text = readRest(fp, &length);
+        ok = parsePlain(text, length, cells, header->denominator, pool);
+        FREE(text);
+    }
+    if (!ok) {
+        methods->free(&pixels);
+        return NULL;
+    }
+
+    Pnm_ppm pixmap;
+    NEW(pixmap);
+    pixmap->width = header->width;
+    pixmap->height = header->height;
+    pixmap->denominator = header->denominator;
+    pixmap->pixels = pixels;
+    pixmap->methods = methods;
+    return pixmap;
+}
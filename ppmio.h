@@ -0,0 +1,59 @@
+/*
+ *                              ppmio
+ *
+ *   Purpose:
+ *
+ *     Interface to ppmtrans's own image input and output.
+ *     PpmIO_writeOriented writes a rotated image as a raw (P6) PPM
+ *     straight from the unrotated source: output rows are assembled in
+ *     cache-sized bands by walking the source through the inverse
+ *     rotation, and each band is written as soon as it is complete. No
+ *     rotated copy of the image is ever built.
+ *
+ *     PpmIO_readHeader and PpmIO_readRows read a plain (P3) or raw
+ *     (P6) PPM incrementally, for callers that process an image band
+ *     by band as it arrives. Rows are delivered already encoded as
+ *     raw PPM rows: three bytes per pixel when the denominator is
+ *     below 256, six (big-endian samples) otherwise.
+ *
+ *     PpmIO_readPixels reads a whole P3 or P6 image into an A2 array,
+ *     like Pnm_ppmread, but parses plain images on several threads.
+ *     PpmIO_readHeader also reads PGM and PBM headers, so that a caller
+ *     can tell the kind of an image before reading its pixels.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef PPMIO_INCLUDED
+#define PPMIO_INCLUDED
+
+#include <stdio.h>
+#include "pnm.h"
+#include "a2methods.h"
+#include "workpool.h"
+
+/* Struct PpmIO_header
+* What the header of a PPM says about its pixels
+*/
+struct PpmIO_header {
+    int format;               /* the digit after 'P', 1 to 6 */
+    int raw;                  /* 1 for P4 to P6, 0 for P1 to P3 */
+    unsigned width, height;
+    unsigned denominator;     /* the maximum sample value; 1 for PBM */
+};
+
+extern void PpmIO_writeOriented(FILE *fp, Pnm_ppm pixmap, int rotation);
+extern int  PpmIO_readHeader(FILE *fp, struct PpmIO_header *header);
+extern int  PpmIO_isColor(const struct PpmIO_header *header);
+extern int  PpmIO_readNumber(FILE *fp, unsigned *number);
+extern int  PpmIO_pixelBytes(const struct PpmIO_header *header);
+extern int  PpmIO_readRows(FILE *fp, const struct PpmIO_header *header,
+                           unsigned char *rows, int count);
+/* blocksize 0 gives blocked arrays the methods' default blocksize */
+extern Pnm_ppm PpmIO_readPixels(FILE *fp,
+                                const struct PpmIO_header *header,
+                                A2Methods_T methods, int blocksize,
+                                WorkPool_T pool);
+
+#endif
@@ -15,6 +15,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 #include "cputiming.h"
 
 #include "assert.h"
@@ -22,40 +23,94 @@
 #include "a2plain.h"
 #include "a2blocked.h"
 #include "pnm.h"
+#include "transform.h"
+#include "streamrot.h"
+#include "a2spec.h"
+#include "a2unchecked.h"
+#include "a2colmajor.h"
+#include "a2view.h"
+#include "ppmio.h"
+#include "anglerot.h"
+#include "filter.h"
+#include "workpool.h"
+#include "pipeline.h"
+#include "graymap.h"
+#include "a2disk.h"
+#include "uarray2file.h"
+#include "a2compressed.h"
+#include "tiled.h"
+#include "batch.h"
+#include "a2convert.h"
+#include "plan.h"
 
 
 typedef A2Methods_UArray2 A2;
 
+#define MAX_FILTERS 8   /* most filters in one invocation */
+
+/* struct filter_step
+ * One filter named on the command line, with its radius
+ */
+struct filter_step {
+        Filter_kind kind;
+        int radius;
+};
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
  *              Forward declaration of functions/
  * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-Pnm_ppm fileToPnm(char *fileName, A2Methods_T methods);
+FILE *openInput(char *fileName);
+Pnm_ppm fileToPnm(FILE *fp, const struct PpmIO_header *header,
+                A2Methods_T methods, int blocksize, int threads);
+Pnm_ppm tiledToPnm(FILE *fp, A2Methods_T methods);
+void grayTransformImg(FILE *fp, const struct PpmIO_header *header,
+                int rotation,
+                char *time_file_name);
 void transformImg(Pnm_ppm pixMap,
                 int rotation,
                 A2Methods_mapfun map,
                 A2Methods_T methods,
+                Transform_order order,
                 char *time_file_name);
-A2 createResArr(Pnm_ppm pixMap,
+void fusedTransformImg(Pnm_ppm pixMap,
+                int rotation,
                 A2Methods_T methods,
-                int rotation);
-struct transformedArr *createClosure(A2Methods_T methods,
-                                A2 finalArr,
-                                int rotation);
-void timeFileWrite(Pnm_ppm pixMap, A2Methods_T methods, A2Methods_mapfun map, 
-                int rotation, float timeUsed, char *time_file_name);
-void rotationApply(int col, int row, A2 array,
-void *elem, void *cl);
-
-/* Struct transformedArr                                
-* Struct to hold an initially empty A2 array 
-* that is used to fill pixel coordinates post rotation
-*/
-struct transformedArr{
-    A2Methods_T methods; /* Methods of current 2D array representation */
-    A2 resArr; /* Stores final rotated arr */
-    int rotation; /* Rotation to be performed */
-};
+                char *time_file_name);
+void parallelTransformImg(Pnm_ppm pixMap,
+                int rotation,
+                int threads,
+                A2Methods_T methods,
+                char *time_file_name);
+int pipelineTransformImg(char *fileName, int rotation, int threads);
+void applyFilters(Pnm_ppm pixMap, struct filter_step *filters, int count,
+                A2Methods_T methods);
+A2Methods_T rowTwin(A2Methods_T methods);
+void convertPnm(Pnm_ppm pixMap, A2Methods_T methods, int blocksize);
+struct Plan planRotation(int width, int height, int tiledBlocksize,
+                int nfilters, int threads, int rotation,
+                char *time_file_name);
+void planFileWrite(const struct Plan *plan, char *time_file_name);
+void angleTransformImg(Pnm_ppm pixMap,
+                double angle,
+                AngleRot_filter filter,
+                struct Pnm_rgb background,
+                A2Methods_T methods,
+                char *time_file_name);
+void cropTransformImg(Pnm_ppm pixMap,
+                int crop[4],
+                int rotation,
+                A2Methods_mapfun map,
+                A2Methods_T methods,
+                char *time_file_name);
+void timeFileWrite(long pixels, A2Methods_T methods, A2Methods_mapfun map,
+                double rotation, const char *order, float timeUsed,
+                char *time_file_name);
+const char *orderName(Transform_order order);
+int positiveArg(int argc, char *argv[], int i);
+void cropArgs(int argc, char *argv[], int i, int crop[4]);
+void backgroundArgs(int argc, char *argv[], int i, struct Pnm_rgb *color);
+A2Methods_T uncheckedMethods(A2Methods_T methods, A2Methods_mapfun **map);
 
 #define SET_METHODS(METHODS, MAP, WHAT) do {                    \
         methods = (METHODS);                                    \
@@ -69,12 +124,37 @@ struct transformedArr{
         }                                                       \
 } while (0)
 
+/* -auto: the arrays, map and order a plan picked */
+#define USE_PLAN(PLAN) do {                                     \
+        methods   = Plan_methods(&(PLAN), sizeof(struct Pnm_rgb)); \
+        map       = methods->map_default;                       \
+        order     = (PLAN).order;                               \
+        fused     = (PLAN).fused;                               \
+        blocksize = (PLAN).blocksize;                           \
+} while (0)
+
 static void
 usage(const char *progname)
 {
         fprintf(stderr, "Usage: %s [-rotate <angle>] "
-                        "[-{row,col,block}-major] [filename]\n",
-                        progname);
+                        "[-{row,col,block}-major]\n"
+                        "          [-nearest|-bilinear] "
+                        "[-background <r> <g> <b>]\n"
+                        "          [-blur <r>] [-gaussian <r>] "
+                        "[-sharpen <r>]\n"
+                        "          [-fused|-gather|-scatter|-stream] "
+                        "[-generic|-unchecked|-col-storage]\n"
+                        "          [-auto] [-pipeline] [-disk <cache-MB>] "
+                        "[-compressed] [-threads <n>]\n"
+                        "          [-crop <x> <y> <w> <h>] "
+                        "[-time <file>] [filename]\n"
+                        "       %s [-rotate <angle>] "
+                        "[-{row,col,block}-major]\n"
+                        "          [-gather|-scatter|-stream] "
+                        "[-jobs <n>] {-batch <listfile> | "
+                        "-batch-dir <dir> <outpattern>}\n"
+                        "       %s -calibrate\n",
+                        progname, progname, progname);
         exit(1);
 }
 
@@ -82,8 +162,30 @@ int main(int argc, char *argv[])
 {
 
     char *time_file_name = NULL;
-    int   rotation       = 0;
+    int   rotation       = 0;    /* -1 for angles other than right ones */
+    double angle         = 0;    /* -rotate, in [0, 360) */
+    AngleRot_filter filter = ANGLEROT_BILINEAR;
+    struct Pnm_rgb background = { 0, 0, 0 };
     int   i;
+    char *batch_list     = NULL; /* -batch list file, "-" for stdin */
+    char *batch_dir      = NULL; /* -batch-dir input directory */
+    char *batch_pattern  = NULL; /* -batch-dir output pattern */
+    int   jobs           = 1;
+    int   threads        = 1;    /* -threads: workers for one image */
+    int   generic        = 0;    /* -generic: keep UArray2/UArray2b */
+    int   unchecked      = 0;    /* -unchecked: UArray2/UArray2b, no checks */
+    int   colStorage     = 0;    /* -col-storage: UArray2 of columns */
+    int   autoPlan       = 0;    /* -auto: let plan.h pick the arrays */
+    int   calibrate      = 0;    /* -calibrate: measure costs for -auto */
+    int   blocksize      = 0;    /* of blocked arrays, 0 for the default */
+    int   fused          = 0;    /* -fused: rotate while writing */
+    int   pipelined      = 0;    /* -pipeline: overlap read and write */
+    int   diskCache      = 0;    /* -disk: MB of block cache per array */
+    struct filter_step filters[MAX_FILTERS]; /* in command-line order */
+    int   nfilters       = 0;
+    int   cropping       = 0;    /* -crop given */
+    int   crop[4];               /* -crop x, y, width and height */
+    Transform_order order = TRANSFORM_AUTO;
 
 
     /* default to UArray2 methods */
@@ -93,7 +195,7 @@ int main(int argc, char *argv[])
     /* default to best map */
     A2Methods_mapfun *map = methods->map_default; 
     assert(map);
-    char *fileName;
+    char *fileName = NULL;
     for (i = 1; i < argc; i++) {
 
         if (strcmp(argv[i], "-row-major") == 0) {
@@ -111,16 +213,25 @@ int main(int argc, char *argv[])
                         usage(argv[0]);
                 }
                 char *endptr;
-                rotation = strtol(argv[++i], &endptr, 10);
-                if (!(rotation == 0 || rotation == 90 ||
-                    rotation == 180 || rotation == 270)) {
-                        fprintf(stderr, 
-                                "Rotation must be 0, 90 180 or 270\n");
-                        usage(argv[0]);
+                angle = strtod(argv[++i], &endptr);
+                if (!(*endptr == '\0') || !isfinite(angle)) {
+                        usage(argv[0]);      /* Not a number */
                 }
-                if (!(*endptr == '\0')) {    /* Not a number */
-                        usage(argv[0]);
+                angle = fmod(angle, 360);
+                if (angle < 0) {
+                        angle += 360;
                 }
+                rotation = (int)angle;
+                if (!(rotation == angle && rotation % 90 == 0)) {
+                        rotation = -1;       /* not a right angle */
+                }
+        } else if (strcmp(argv[i], "-nearest") == 0) {
+                filter = ANGLEROT_NEAREST;
+        } else if (strcmp(argv[i], "-bilinear") == 0) {
+                filter = ANGLEROT_BILINEAR;
+        } else if (strcmp(argv[i], "-background") == 0) {
+                backgroundArgs(argc, argv, i, &background);
+                i += 3;
         } else if (strcmp(argv[i], "-transpose") == 0) {
                 fprintf(stderr, "Transpose functionality not implemented\n");
                 usage(argv[0]);
@@ -128,8 +239,67 @@ int main(int argc, char *argv[])
                 fprintf(stderr, "Transpose functionality not implemented\n");
                 usage(argv[0]);
 
+        } else if (strcmp(argv[i], "-gather") == 0) {
+                order = TRANSFORM_GATHER;
+        } else if (strcmp(argv[i], "-scatter") == 0) {
+                order = TRANSFORM_SCATTER;
+        } else if (strcmp(argv[i], "-stream") == 0) {
+                order = TRANSFORM_STREAM;
+        } else if (strcmp(argv[i], "-fused") == 0) {
+                fused = 1;
+        } else if (strcmp(argv[i], "-pipeline") == 0) {
+                pipelined = 1;
+        } else if (strcmp(argv[i], "-disk") == 0) {
+                diskCache = positiveArg(argc, argv, i++);
+                SET_METHODS(uarray2_methods_disk, map_block_major,
+                            "block-major");
+        } else if (strcmp(argv[i], "-compressed") == 0) {
+                SET_METHODS(uarray2_methods_compressed, map_block_major,
+                            "block-major");
+        } else if (strcmp(argv[i], "-generic") == 0) {
+                generic = 1;
+        } else if (strcmp(argv[i], "-unchecked") == 0) {
+                unchecked = 1;
+        } else if (strcmp(argv[i], "-col-storage") == 0) {
+                colStorage = 1;
+        } else if (strcmp(argv[i], "-auto") == 0) {
+                autoPlan = 1;
+        } else if (strcmp(argv[i], "-calibrate") == 0) {
+                calibrate = 1;
+        } else if (strcmp(argv[i], "-blur") == 0 ||
+                   strcmp(argv[i], "-gaussian") == 0 ||
+                   strcmp(argv[i], "-sharpen") == 0) {
+                if (nfilters == MAX_FILTERS) {
+                        fprintf(stderr, "At most %d filters\n",
+                                MAX_FILTERS);
+                        usage(argv[0]);
+                }
+                filters[nfilters].kind =
+                        strcmp(argv[i], "-blur") == 0 ? FILTER_BOX :
+                        strcmp(argv[i], "-gaussian") == 0 ? FILTER_GAUSSIAN
+                                                          : FILTER_SHARPEN;
+                filters[nfilters++].radius = positiveArg(argc, argv, i++);
+        } else if (strcmp(argv[i], "-crop") == 0) {
+                cropArgs(argc, argv, i, crop);
+                cropping = 1;
+                i += 4;
         } else if (strcmp(argv[i], "-time") == 0) {
                 time_file_name = argv[++i];
+        } else if (strcmp(argv[i], "-batch") == 0) {
+                if (!(i + 1 < argc)) {
+                        usage(argv[0]);
+                }
+                batch_list = argv[++i];
+        } else if (strcmp(argv[i], "-batch-dir") == 0) {
+                if (!(i + 2 < argc)) {
+                        usage(argv[0]);
+                }
+                batch_dir = argv[++i];
+                batch_pattern = argv[++i];
+        } else if (strcmp(argv[i], "-jobs") == 0) {
+                jobs = positiveArg(argc, argv, i++);
+        } else if (strcmp(argv[i], "-threads") == 0) {
+                threads = positiveArg(argc, argv, i++);
         } else if (*argv[i] == '-') {
                 fprintf(stderr, "%s: unknown option '%s'\n", argv[0],
                         argv[i]);
@@ -142,9 +312,174 @@ int main(int argc, char *argv[])
         }
     }
 
-    Pnm_ppm pixMap = fileToPnm(fileName, methods);
+    if (calibrate) {
+        const char *path = Plan_cachePath();
+        if (path == NULL || !Plan_calibrate(path)) {
+                fprintf(stderr, "%s: could not calibrate, or save the "
+                                "calibration; set PPMTRANS_PLAN to a "
+                                "writable file\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+        printf("Calibration saved in %s\n", path);
+        exit(EXIT_SUCCESS);
+    }
+    if (autoPlan && (rotation < 0 || cropping || pipelined || fused ||
+                     order != TRANSFORM_AUTO || generic || unchecked ||
+                     colStorage || methods == uarray2_methods_disk ||
+                     methods == uarray2_methods_compressed ||
+                     batch_list != NULL || batch_dir != NULL)) {
+        fprintf(stderr, "-auto plans right-angle rotations of whole "
+                        "images, and picks the arrays and order itself\n");
+        usage(argv[0]);
+    }
 
-    transformImg(pixMap, rotation, map, methods, time_file_name);
+    /* arrays specialized for Pnm_rgb cells, unless told otherwise */
+    if (methods == uarray2_methods_disk) {
+        /* file-backed arrays, for images larger than memory */
+        UArray2f_configure((long)diskCache << 20, NULL);
+        if (threads > 1 || batch_list != NULL || batch_dir != NULL) {
+                fprintf(stderr, "-disk arrays take one thread, and no "
+                                "batch mode\n");
+                usage(argv[0]);
+        }
+    } else if (methods == uarray2_methods_compressed) {
+        /* compressed arrays, for mostly flat images */
+        if (threads > 1) {
+                fprintf(stderr, "-compressed arrays take one thread\n");
+                usage(argv[0]);
+        }
+    } else if (colStorage) {
+        /* UArray2 storing columns; its maps are the UArray2 ones */
+        if (methods != uarray2_methods_plain || unchecked) {
+                fprintf(stderr, "-col-storage takes -row-major or "
+                                "-col-major, and no -unchecked\n");
+                usage(argv[0]);
+        }
+        methods = uarray2_methods_colmajor;
+    } else if (unchecked) {
+        methods = uncheckedMethods(methods, &map);
+    } else if (!generic) {
+        methods = A2Spec_specialize(methods, &map, sizeof(struct Pnm_rgb));
+    }
+
+    if (rotation < 0 && (cropping || batch_list != NULL ||
+                         batch_dir != NULL)) {
+        fprintf(stderr, "-crop and batch mode rotate by 0, 90, 180 "
+                        "or 270 degrees only\n");
+        usage(argv[0]);
+    }
+    if (cropping && (order != TRANSFORM_AUTO || fused || threads > 1)) {
+        /* the crop gathers its window in one pass with the chosen map */
+        fprintf(stderr, "-crop takes no -gather, -scatter, -stream, "
+                        "-fused or -threads\n");
+        usage(argv[0]);
+    }
+    if (nfilters > 0 && (batch_list != NULL || batch_dir != NULL)) {
+        fprintf(stderr, "Batch mode takes no filters\n");
+        usage(argv[0]);
+    }
+
+    if (batch_list != NULL || batch_dir != NULL) {
+        if (fileName != NULL || time_file_name != NULL || cropping ||
+            pipelined || (batch_list != NULL && batch_dir != NULL)) {
+                fprintf(stderr, "Batch mode takes no filename, -crop, "
+                                "-pipeline or -time\n");
+                usage(argv[0]);
+        }
+        struct Batch_options options = { methods, map, rotation, order,
+                                         jobs };
+        int failures;
+        if (batch_dir != NULL) {
+                failures = Batch_runDir(batch_dir, batch_pattern, &options);
+        } else if (strcmp(batch_list, "-") == 0) {
+                failures = Batch_runList(stdin, &options);
+        } else {
+                FILE *list = fopen(batch_list, "r");
+                if (list == NULL) {
+                        fprintf(stderr, "%s %s %s\n", "Could not open file",
+                                batch_list, "for reading");
+                        exit(EXIT_FAILURE);
+                }
+                failures = Batch_runList(list, &options);
+                fclose(list);
+        }
+        exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    if (pipelined) {
+        if (rotation < 0 || nfilters > 0 || cropping ||
+            time_file_name != NULL) {
+                fprintf(stderr, "-pipeline rotates by 0, 90, 180 or 270 "
+                                "degrees, with no filters, -crop or "
+                                "-time\n");
+                usage(argv[0]);
+        }
+        exit(pipelineTransformImg(fileName, rotation, threads) == 0
+             ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    FILE *input = openInput(fileName);
+    struct PpmIO_header header;
+    Pnm_ppm pixMap;
+    if (Tiled_detect(input)) {
+        /* -auto takes the tiles as they are stored, as blocks */
+        pixMap = tiledToPnm(input, autoPlan
+                                   ? A2Spec_blocked(sizeof(struct Pnm_rgb))
+                                   : methods);
+        if (autoPlan) {
+                A2Methods_T tiled = (A2Methods_T)pixMap->methods;
+                struct Plan plan = planRotation(pixMap->width,
+                                                pixMap->height,
+                                                tiled->blocksize(
+                                                        pixMap->pixels),
+                                                nfilters, threads, rotation,
+                                                time_file_name);
+                USE_PLAN(plan);
+        }
+    } else if (!PpmIO_readHeader(input, &header)) {
+        fprintf(stderr, "Input is not a PPM, PGM, PBM or tiled image\n");
+        exit(EXIT_FAILURE);
+    } else if (!PpmIO_isColor(&header)) {
+        if (rotation < 0 || nfilters > 0 || cropping) {
+                fprintf(stderr, "PGM and PBM images rotate by 0, 90, 180 "
+                                "or 270 degrees, with no filters or "
+                                "-crop\n");
+                usage(argv[0]);
+        }
+        grayTransformImg(input, &header, rotation, time_file_name);
+        exit(EXIT_SUCCESS);
+    } else {
+        if (autoPlan) {
+                struct Plan plan = planRotation(header.width, header.height,
+                                                0, nfilters, threads,
+                                                rotation, time_file_name);
+                USE_PLAN(plan);
+        }
+        /* filters run faster over rows than over blocks: read and
+         * filter row-major, and switch to blocks for the rotation */
+        pixMap = fileToPnm(input, &header,
+                           nfilters > 0 ? rowTwin(methods) : methods,
+                           nfilters > 0 ? 0 : blocksize, threads);
+    }
+    applyFilters(pixMap, filters, nfilters,
+                 (A2Methods_T)pixMap->methods);
+    convertPnm(pixMap, methods, blocksize);
+
+    if (rotation < 0) {
+        angleTransformImg(pixMap, angle, filter, background, methods,
+                          time_file_name);
+    } else if (cropping) {
+        cropTransformImg(pixMap, crop, rotation, map, methods,
+                         time_file_name);
+    } else if (threads > 1 && !fused) {
+        parallelTransformImg(pixMap, rotation, threads, methods,
+                             time_file_name);
+    } else if (fused) {
+        /* the written file is the only output: skip the rotated array */
+        fusedTransformImg(pixMap, rotation, methods, time_file_name);
+    } else {
+        transformImg(pixMap, rotation, map, methods, order, time_file_name);
+    }
 
     exit(EXIT_SUCCESS);
 
@@ -154,37 +489,115 @@ int main(int argc, char *argv[])
  *            Functions implementing the ppmtrans program
  * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* Function: openInput
+ * Purpose: Opens the input image, exiting if it cannot be opened
+ * Arguments: The name of the file, NULL for stdin
+ * Returns: The open file
+ */
+FILE *openInput(char *fileName)
+{
+    if (fileName == NULL) {
+        return stdin;
+    }
+    FILE *fp = fopen(fileName, "rb");
+    if(fp == NULL) {
+            fprintf(stderr, 
+                    "%s: %s %s\n",
+                    "Could not open file", fileName, "for reading");
+            exit(EXIT_FAILURE);
+            }
+    return fp;
+}
+
 /* Function: fileToPnm
- * Purpose: A function to open the specified file for reading and convert
- *           it into a Pnm_ppm instance to extract the info from the ppm file
- * Arguments: A char pointer to the name of the file, an A2 methods for
- *           access to the right functions
+ * Purpose: A function to read the pixels of a ppm file whose header has
+ *           been read into a Pnm_ppm instance
+ * Arguments: The open file, its header, an A2 methods for access to the
+ *           right functions and the blocksize of blocked arrays (0 for
+ *           the default), the number of threads parsing the file
  * Returns: An instance of a Pnm_ppm
  */
-Pnm_ppm fileToPnm(char *fileName, A2Methods_T methods)
+Pnm_ppm fileToPnm(FILE *fp, const struct PpmIO_header *header,
+                A2Methods_T methods, int blocksize, int threads)
 {
+    assert(fp != NULL && header != NULL);
     assert(methods != NULL);
-    FILE *fp;
-    Pnm_ppm pixMap;
-    if (fileName == NULL) {
-        pixMap = Pnm_ppmread(stdin, methods);;
-    }
-    else {
-        fp = fopen(fileName, "r");
-        if(fp == NULL) {
-                fprintf(stderr, 
-                        "%s: %s %s\n",
-                        "Could not open file", fileName, "for reading");
-                exit(EXIT_FAILURE);
-                }
-        assert(fp != NULL);
-        pixMap = Pnm_ppmread(fp, methods);
-        
+    WorkPool_T pool = threads > 1 ? WorkPool_new(threads) : NULL;
+    Pnm_ppm pixMap = PpmIO_readPixels(fp, header, methods, blocksize,
+                                      pool);
+    if (pool != NULL) {
+        WorkPool_free(&pool);
+    }
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    if (pixMap == NULL) {
+        fprintf(stderr, "Input is not a complete PPM image\n");
+        exit(EXIT_FAILURE);
     }
-    assert(pixMap != NULL);
     return pixMap;
 }
 
+/* Function: tiledToPnm
+ * Purpose: Reads a tiled image (tiled.h); arrays laid out as the file
+ *          (-block-major) take each block in one read
+ * Arguments: The open file, at its start; an A2 methods for access to
+ *           the right functions
+ * Returns: An instance of a Pnm_ppm
+ */
+Pnm_ppm tiledToPnm(FILE *fp, A2Methods_T methods)
+{
+    assert(fp != NULL && methods != NULL);
+    Pnm_ppm pixMap = Tiled_read(fp, methods);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    if (pixMap == NULL) {
+        fprintf(stderr, "Input is not a complete tiled image of this "
+                        "machine's byte order\n");
+        exit(EXIT_FAILURE);
+    }
+    return pixMap;
+}
+
+/* Function: grayTransformImg
+ * Purpose: Rotates a PGM or PBM in its own representation (graymap.h),
+ *           and writes it as a raw PGM or PBM
+ * Arguments: The open file, its header, the rotation amount, a char
+ *           pointer to the name of the time file
+ * Returns: none
+ */
+void grayTransformImg(FILE *fp, const struct PpmIO_header *header,
+                int rotation,
+                char *time_file_name)
+{
+    Graymap_T source = Graymap_read(fp, header);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    if (source == NULL) {
+        fprintf(stderr, "Input is not a complete PGM or PBM image\n");
+        exit(EXIT_FAILURE);
+    }
+
+    CPUTime_T timer = CPUTime_New();
+    CPUTime_Start(timer);
+
+    Graymap_T rotated = Graymap_rotate(source, rotation);
+
+    float timeUsed = CPUTime_Stop(timer);
+    CPUTime_Free(&timer);
+
+    Graymap_write(stdout, rotated);
+    if (time_file_name != NULL) {
+        timeFileWrite((long)Graymap_width(source) * Graymap_height(source),
+                      NULL, NULL, rotation, "Transpose", timeUsed,
+                      time_file_name);
+    }
+    Graymap_free(&rotated);
+    Graymap_free(&source);
+}
+
 
 /* Function: transformImg
  * Purpose: The main function to execute the commands from user input.
@@ -194,6 +607,7 @@ Pnm_ppm fileToPnm(char *fileName, A2Methods_T methods)
             the rotation amount,
             a A2Methods_mapfun instance,
             an A2 methods for access to the right functions,
+            the traversal order (scatter, gather or auto),
             a char pointer to the name of the time file
  * Returns: none
  */
@@ -201,165 +615,517 @@ void transformImg(Pnm_ppm pixMap,
                 int rotation,
                 A2Methods_mapfun map,
                 A2Methods_T methods,
+                Transform_order order,
                 char *time_file_name)
 {
     assert(pixMap != NULL);
     assert(map != NULL);
     assert(methods != NULL);
-    A2 finalArr = createResArr(pixMap, methods, rotation);
-    struct transformedArr *result = createClosure(methods,
-                                                finalArr,
-                                                rotation);
-    assert(result);
+    if (order == TRANSFORM_AUTO ||
+        (order == TRANSFORM_STREAM && !StreamRot_supported(methods))) {
+        order = Transform_chooseOrder(methods, map, rotation);
+    }
+    A2 finalArr = Transform_newDest(methods, pixMap->pixels, rotation);
 
     CPUTime_T timer = CPUTime_New();
     CPUTime_Start(timer);
 
-    /* Pass new Pnm through map function as cl */
-    map(pixMap->pixels, rotationApply, result);
+    Transform_rotate(methods, map, pixMap->pixels, finalArr, rotation,
+                     order);
 
     float timeUsed = CPUTime_Stop(timer);
     CPUTime_Free(&timer);
 
     methods->free(&pixMap->pixels);
-    pixMap->pixels = result->resArr;
+    pixMap->pixels = finalArr;
+    pixMap->width = methods->width(finalArr);
+    pixMap->height = methods->height(finalArr);
     Pnm_ppmwrite(stdout, pixMap);
     if (time_file_name != NULL) {
-        timeFileWrite(pixMap, methods, map, rotation, timeUsed, time_file_name);
+        timeFileWrite((long)pixMap->width * pixMap->height,
+                      methods, map, rotation, orderName(order),
+                      timeUsed, time_file_name);
     }
-    free(result);
-    /* write the transfored image to output */
     Pnm_ppmfree(&pixMap);
         
 }
 
-/* Function: createResArr
- * Purpose: A helper function for image rotations. Creates
-            an empty map that is populated with the new
-            image post rotation.
+/* Function: fusedTransformImg
+ * Purpose: Rotates an image while writing it: output rows are built
+ *          straight from the source in cache-sized bands (see ppmio.h),
+ *          so no rotated array is allocated. The time recorded covers
+ *          the whole write.
+ * Arguments: A Pnm_ppm instance,
+            the rotation amount,
+            an A2 methods for access to the right functions,
+            a char pointer to the name of the time file
+ * Returns: none
+ */
+void fusedTransformImg(Pnm_ppm pixMap,
+                int rotation,
+                A2Methods_T methods,
+                char *time_file_name)
+{
+    assert(pixMap != NULL);
+    assert(methods != NULL);
+
+    CPUTime_T timer = CPUTime_New();
+    CPUTime_Start(timer);
+
+    PpmIO_writeOriented(stdout, pixMap, rotation);
+
+    float timeUsed = CPUTime_Stop(timer);
+    CPUTime_Free(&timer);
+
+    if (time_file_name != NULL) {
+        timeFileWrite((long)pixMap->width * pixMap->height,
+                      methods, NULL, rotation, "Fused", timeUsed,
+                      time_file_name);
+    }
+    Pnm_ppmfree(&pixMap);
+}
+
+/* Function: pipelineTransformImg
+ * Purpose: Rotates a file by a right angle without building a Pnm_ppm,
+ *           reading, rotating and writing at the same time
+ * Arguments: The name of the file (NULL for stdin), the rotation, and
+ *           the number of threads rotating
+ * Returns: 0 on success, nonzero if the input is not a complete PPM
+ */
+int pipelineTransformImg(char *fileName, int rotation, int threads)
+{
+    FILE *fp = openInput(fileName);
+    int result = Pipeline_run(fp, stdout, rotation, threads);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    return result;
+}
+
+/* Function: parallelTransformImg
+ * Purpose: Rotates an image on several threads: a work-stealing pool
+ *          gathers bands or blocks of the destination in parallel (see
+ *          a2parallel.h), then the result is written. The time
+ *          recorded is CPU time summed over the threads.
  * Arguments: A Pnm_ppm instance,
+            the rotation amount,
+            the number of threads, counting the main one,
             an A2 methods for access to the right functions,
-            the rotation amount
- * Returns: An A2 object
-*/
+            a char pointer to the name of the time file
+ * Returns: none
+ */
+void parallelTransformImg(Pnm_ppm pixMap,
+                int rotation,
+                int threads,
+                A2Methods_T methods,
+                char *time_file_name)
+{
+    assert(pixMap != NULL);
+    assert(methods != NULL);
+    WorkPool_T pool = WorkPool_new(threads);
+    A2 finalArr = Transform_newDest(methods, pixMap->pixels, rotation);
+
+    CPUTime_T timer = CPUTime_New();
+    CPUTime_Start(timer);
+
+    Transform_rotateParallel(pool, methods, pixMap->pixels, finalArr,
+                             rotation);
 
-A2 createResArr(Pnm_ppm pixMap, A2Methods_T methods, int rotation)
+    float timeUsed = CPUTime_Stop(timer);
+    CPUTime_Free(&timer);
+    WorkPool_free(&pool);
+
+    methods->free(&pixMap->pixels);
+    pixMap->pixels = finalArr;
+    pixMap->width = methods->width(finalArr);
+    pixMap->height = methods->height(finalArr);
+    Pnm_ppmwrite(stdout, pixMap);
+    if (time_file_name != NULL) {
+        timeFileWrite((long)pixMap->width * pixMap->height,
+                      methods, NULL, rotation, "Parallel gather",
+                      timeUsed, time_file_name);
+    }
+    Pnm_ppmfree(&pixMap);
+}
+
+/* Function: applyFilters
+ * Purpose: Runs the filters named on the command line, in order, on
+ *          an image before it is oriented
+ * Arguments: A Pnm_ppm instance,
+            the filters and how many there are,
+            an A2 methods for access to the right functions
+ * Returns: none
+ */
+void applyFilters(Pnm_ppm pixMap, struct filter_step *filters, int count,
+                A2Methods_T methods)
 {
     assert(pixMap != NULL);
     assert(methods != NULL);
+    for (int k = 0; k < count; k++) {
+        A2 filtered = methods->new(pixMap->width, pixMap->height,
+                                   sizeof(struct Pnm_rgb));
+        Filter_apply(methods, pixMap->pixels, filtered, filters[k].kind,
+                     filters[k].radius, pixMap->denominator);
+        methods->free(&pixMap->pixels);
+        pixMap->pixels = filtered;
+    }
+}
 
-    // Get width height from pixMap
-    int width = pixMap->width;
-    int height = pixMap->height;
-    int size = sizeof(struct Pnm_rgb);
-
-    // Create new empty A2 object
-    A2 finalArr;
-    if (rotation == 90) {
-            finalArr = methods->new(height, width, size);
-            pixMap->height = width;
-            pixMap->width = height; 
-    } else {
-            finalArr = methods->new(width, height, size);
+/* Function: rowTwin
+ * Purpose: Finds the row-major table for the cells of a blocked table
+ * Arguments: The methods
+ * Returns: The row-major twin, or the methods themselves if they are not
+ *          an in-memory blocked table
+ */
+A2Methods_T rowTwin(A2Methods_T methods)
+{
+    if (methods == uarray2_methods_blocked) {
+        return uarray2_methods_plain;
+    } else if (methods == uarray2_methods_blocked_unchecked) {
+        return uarray2_methods_plain_unchecked;
+    } else if (A2Spec_isBlocked(methods)) {
+        return A2Spec_plain(A2Spec_size(methods));
     }
-    return finalArr;
+    return methods;
 }
 
-/* Function: createClosure
- * Purpose: A helper function to create the struct that we send
-            as a closure argument in the mapping function.
- * Arguments: The mapping functions,
-                A2 object to store the final array,
-                the correct mapping functions
- * Returns: a struct containing the arguments to be passed into the closure
+/* Function: convertPnm
+ * Purpose: Moves an image's pixels into the layout of other methods,
+ *          copying row runs rather than cells (a2convert.h)
+ * Arguments: A Pnm_ppm instance, the methods it should have and the
+ *            blocksize of blocked arrays (0 for the default)
+ * Returns: none
  */
-struct transformedArr *createClosure(A2Methods_T methods,
-                                    A2 finalArr,
-                                    int rotation)
-{                                          
-    assert(finalArr != NULL);
+void convertPnm(Pnm_ppm pixMap, A2Methods_T methods, int blocksize)
+{
+    assert(pixMap != NULL && methods != NULL);
+    A2Methods_T current = (A2Methods_T)pixMap->methods;
+    if (current == methods) {
+        return;
+    }
+    A2 pixels = blocksize > 0
+                ? methods->new_with_blocksize(pixMap->width, pixMap->height,
+                                              sizeof(struct Pnm_rgb),
+                                              blocksize)
+                : methods->new(pixMap->width, pixMap->height,
+                               sizeof(struct Pnm_rgb));
+    A2Convert_copy(current, pixMap->pixels, methods, pixels);
+    current->free(&pixMap->pixels);
+    pixMap->pixels = pixels;
+    pixMap->methods = methods;
+}
+
+/* Function: planRotation
+ * Purpose: Plans a right-angle rotation for -auto (plan.h), and reports
+ *          the plan in the time file
+ * Arguments: The width and height of the image,
+            the blocksize of a tiled input or 0 for a PPM,
+            the number of filters and of threads,
+            the rotation amount,
+            a char pointer to the name of the time file, or NULL
+ * Returns: The plan
+ */
+struct Plan planRotation(int width, int height, int tiledBlocksize,
+                int nfilters, int threads, int rotation,
+                char *time_file_name)
+{
+    struct Plan_job job = { width, height, sizeof(struct Pnm_rgb),
+                            rotation, tiledBlocksize, nfilters > 0,
+                            threads };
+    struct Plan plan = Plan_choose(&job);
+    if (time_file_name != NULL) {
+        planFileWrite(&plan, time_file_name);
+    }
+    return plan;
+}
+
+/* Function: planFileWrite
+ * Purpose: Writes what -auto picked, and the cost it predicted, ahead of
+ *          the timing that timeFileWrite adds
+ * Arguments: The plan, the name of the time file
+ * Returns: none
+ */
+void planFileWrite(const struct Plan *plan, char *time_file_name)
+{
+        assert(plan != NULL && time_file_name != NULL);
+
+        FILE *timefile = fopen(time_file_name, "a");
+        if (plan->layout == PLAN_ROWS) {
+                fprintf(timefile, "Plan layout: Rows\n");
+        } else {
+                fprintf(timefile, "Plan layout: Blocks of %d\n",
+                        plan->blocksize);
+        }
+        if (plan->fused) {
+                fprintf(timefile, "Plan order: Fused\n");
+        } else {
+                fprintf(timefile, "Plan order: %s, %d thread%s\n",
+                        orderName(plan->order), plan->threads,
+                        plan->threads == 1 ? "" : "s");
+        }
+        fprintf(timefile, "Predicted time per pixel: %.1fns (%s costs)\n",
+                plan->cost, plan->calibrated ? "calibrated" : "default");
+        fclose(timefile);
+}
+
+/* Function: angleTransformImg
+ * Purpose: Rotates an image by an angle other than a right angle into
+ *          its bounding box, resampling each pixel (see anglerot.h)
+ * Arguments: A Pnm_ppm instance,
+            the angle in degrees,
+            the resampling filter,
+            the color of the area outside the source,
+            an A2 methods for access to the right functions,
+            a char pointer to the name of the time file
+ * Returns: none
+ */
+void angleTransformImg(Pnm_ppm pixMap,
+                double angle,
+                AngleRot_filter filter,
+                struct Pnm_rgb background,
+                A2Methods_T methods,
+                char *time_file_name)
+{
+    assert(pixMap != NULL);
     assert(methods != NULL);
-    struct transformedArr *result = malloc(sizeof(struct transformedArr));
-    assert(result != NULL);
-    result->methods = methods;
-    result->resArr = finalArr; 
-    result->rotation = rotation;
-    return result;
+    if (background.red > pixMap->denominator ||
+        background.green > pixMap->denominator ||
+        background.blue > pixMap->denominator) {
+            fprintf(stderr, "Background color exceeds the image's "
+                            "maximum value %u\n", pixMap->denominator);
+            exit(EXIT_FAILURE);
+    }
+    int width, height;
+    AngleRot_dims(angle, pixMap->width, pixMap->height, &width, &height);
+    A2 finalArr = methods->new(width, height, sizeof(struct Pnm_rgb));
+
+    CPUTime_T timer = CPUTime_New();
+    CPUTime_Start(timer);
+
+    AngleRot_rotate(methods, pixMap->pixels, finalArr, angle, filter,
+                    background);
+
+    float timeUsed = CPUTime_Stop(timer);
+    CPUTime_Free(&timer);
+
+    methods->free(&pixMap->pixels);
+    pixMap->pixels = finalArr;
+    pixMap->width = width;
+    pixMap->height = height;
+    Pnm_ppmwrite(stdout, pixMap);
+    if (time_file_name != NULL) {
+        timeFileWrite((long)pixMap->width * pixMap->height,
+                      methods, NULL, angle,
+                      filter == ANGLEROT_NEAREST ? "Tiled, nearest"
+                                                 : "Tiled, bilinear",
+                      timeUsed, time_file_name);
+    }
+    Pnm_ppmfree(&pixMap);
+}
+
+/* Function: cropTransformImg
+ * Purpose: Crops then rotates an image with a single copy. The crop
+ *          and the rotation are views of the source (see a2view.h),
+ *          and only the final image is materialized, by walking it
+ *          with the chosen map and reading each pixel through the
+ *          views.
+ * Arguments: A Pnm_ppm instance,
+            the crop window: column, row, width and height,
+            the rotation amount,
+            a A2Methods_mapfun instance,
+            an A2 methods for access to the right functions,
+            a char pointer to the name of the time file
+ * Returns: none
+ */
+void cropTransformImg(Pnm_ppm pixMap,
+                int crop[4],
+                int rotation,
+                A2Methods_mapfun map,
+                A2Methods_T methods,
+                char *time_file_name)
+{
+    assert(pixMap != NULL);
+    assert(map != NULL);
+    assert(methods != NULL);
+    /* subtract rather than add: x + width can overflow an int */
+    if (crop[0] > (int)pixMap->width ||
+        crop[2] > (int)pixMap->width - crop[0] ||
+        crop[1] > (int)pixMap->height ||
+        crop[3] > (int)pixMap->height - crop[1]) {
+            fprintf(stderr, "Crop window %dx%d+%d+%d is outside the "
+                            "%ux%u image\n", crop[2], crop[3], crop[0],
+                            crop[1], pixMap->width, pixMap->height);
+            exit(EXIT_FAILURE);
+    }
+
+    CPUTime_T timer = CPUTime_New();
+    CPUTime_Start(timer);
+
+    A2 window = A2View_crop(methods, pixMap->pixels, crop[0], crop[1],
+                            crop[2], crop[3]);
+    A2 oriented = A2View_rotate(a2view_methods, window, rotation);
+    a2view_methods->free(&window);
+    A2 finalArr = A2View_materialize(oriented, methods, map);
+    a2view_methods->free(&oriented);
+
+    float timeUsed = CPUTime_Stop(timer);
+    CPUTime_Free(&timer);
+
+    methods->free(&pixMap->pixels);
+    pixMap->pixels = finalArr;
+    pixMap->width = methods->width(finalArr);
+    pixMap->height = methods->height(finalArr);
+    Pnm_ppmwrite(stdout, pixMap);
+    if (time_file_name != NULL) {
+        timeFileWrite((long)pixMap->width * pixMap->height,
+                      methods, map, rotation,
+                      orderName(TRANSFORM_GATHER), timeUsed, time_file_name);
+    }
+    Pnm_ppmfree(&pixMap);
 }
 
 /* Function: timeFileWrite
  * Purpose: A helper function to write the transformation time to a file
- * Arguments: A Pnm_ppm pixMap,
- *            an A2Methods_T object,
- *            the rotation,
+ * Arguments: The number of pixels transformed,
+ *            an A2Methods_T object (NULL if map is NULL),
+ *            the mapping function used, or NULL,
+ *            the rotation in degrees,
+ *            the name of the traversal order,
  *            the time,
  *            the name of the time file
  * Returns: none
  */
-void timeFileWrite(Pnm_ppm pixMap, A2Methods_T methods, A2Methods_mapfun map,
-                int rotation, float timeUsed, char *time_file_name)
+void timeFileWrite(long pixels, A2Methods_T methods, A2Methods_mapfun map,
+                double rotation, const char *order, float timeUsed,
+                char *time_file_name)
 {
-        assert(methods != NULL);
-        assert(pixMap != NULL);
+        assert(methods != NULL || map == NULL);
 
         FILE *timefile = fopen(time_file_name, "a");
-        int totalPixels = pixMap->height * pixMap->width;
         fprintf(timefile,
                 "Overall time: %fms\nTime per pixel: %fms\n",
                 timeUsed,
-                timeUsed / totalPixels);
-        if (map == methods->map_block_major) {
+                timeUsed / pixels);
+        if (map == NULL) {
+                /* the transform did not use a mapping function */
+        } else if (map == methods->map_block_major) {
                 fprintf(timefile, "Method Used: Block Major\n");
         } else if (map == methods->map_row_major) {
                 fprintf(timefile, "Method Used: Row Major\n");
         } else if (map == methods->map_col_major) {
                 fprintf(timefile, "Method Used: Col Major\n");
         }
-        fprintf(timefile, "Rotation: %d degrees\n", rotation);
+        fprintf(timefile, "Order: %s\n", order);
+        fprintf(timefile, "Rotation: %g degrees\n", rotation);
         fprintf(timefile, "----------------------------------------\n");
         fclose(timefile);
 }
 
-/* Function: rotationApply
- * Purpose: An apply function that applies a specified rotation to 
- * the original image and saves the rotated pixel into the result
- * array
- * Arguments: The column,
- *            the row,
- *            A2 object,
- *            the element at (col,row)
- *            The closure, containing:
- *                The result arr to store rotated pixels                     
- *                The methods used for that array
- *                The rotation amount
- * Returns: none 
-*/
-void rotationApply(int col, int row, A2 array,
-void *elem, void *cl)
+/* Function: orderName
+ * Purpose: Names a traversal order for the time file
+ * Arguments: A traversal order other than TRANSFORM_AUTO
+ * Returns: A string constant
+ */
+const char *orderName(Transform_order order)
 {
-    struct transformedArr *finalStruct = (struct transformedArr *) cl;
-    A2Methods_T methods = finalStruct->methods;
-    A2 resArr = finalStruct->resArr;
-    int rotation = finalStruct->rotation;
-
-    Pnm_rgb currPix = (Pnm_rgb) elem;
-    Pnm_rgb newSpot;
-
+        return order == TRANSFORM_STREAM ? "Stream" :
+               order == TRANSFORM_GATHER ? "Gather" : "Scatter";
+}
 
-    int height = methods->height(array);
-    int width = methods->width(array);
-    
-    if (rotation == 0) {
-        newSpot = methods->at(resArr, col, row);
-            
-    } else if (rotation == 90) {
-        newSpot = methods->at(resArr, height - row - 1, col);
-    
-    } else if (rotation == 180) {
-        newSpot = methods->at(resArr, width - col - 1, height - row - 1);
-    }
+/* Function: positiveArg
+ * Purpose: Parses the positive integer that follows option argv[i]
+ * Arguments: argc and argv from main, the index of the option
+ * Returns: The parsed value; exits with a usage message if it is
+ *          missing or not a positive integer
+ */
+int positiveArg(int argc, char *argv[], int i)
+{
+        if (!(i + 1 < argc)) {
+                usage(argv[0]);
+        }
+        char *endptr;
+        long value = strtol(argv[i + 1], &endptr, 10);
+        if (*endptr != '\0' || value < 1 || value > 1024) {
+                fprintf(stderr, "%s expects a positive integer\n", argv[i]);
+                usage(argv[0]);
+        }
+        return (int)value;
+}
 
-    *newSpot = *currPix;
+/* Function: cropArgs
+ * Purpose: Parses the four non-negative integers that follow -crop
+ * Arguments: argc and argv from main, the index of the option, and
+ *            the array that receives x, y, width and height
+ * Returns: none; exits with a usage message if an integer is missing
+ *          or malformed, or if the window is empty
+ */
+void cropArgs(int argc, char *argv[], int i, int crop[4])
+{
+        if (!(i + 4 < argc)) {
+                usage(argv[0]);
+        }
+        for (int k = 0; k < 4; k++) {
+                char *endptr;
+                long value = strtol(argv[i + 1 + k], &endptr, 10);
+                if (*endptr != '\0' || value < 0 || value > 1 << 30) {
+                        fprintf(stderr, "-crop expects four non-negative "
+                                        "integers\n");
+                        usage(argv[0]);
+                }
+                crop[k] = (int)value;
+        }
+        if (crop[2] == 0 || crop[3] == 0) {
+                fprintf(stderr, "-crop window must not be empty\n");
+                usage(argv[0]);
+        }
+}
 
+/* Function: backgroundArgs
+ * Purpose: Parses the three non-negative integers that follow
+ *          -background: red, green and blue, in the image's scale
+ * Arguments: argc and argv from main, the index of the option, and
+ *            the color to fill in
+ * Returns: none; exits with a usage message if an integer is missing
+ *          or malformed
+ */
+void backgroundArgs(int argc, char *argv[], int i, struct Pnm_rgb *color)
+{
+        unsigned samples[3];
+        if (!(i + 3 < argc)) {
+                usage(argv[0]);
+        }
+        for (int k = 0; k < 3; k++) {
+                char *endptr;
+                long value = strtol(argv[i + 1 + k], &endptr, 10);
+                if (*endptr != '\0' || value < 0 || value > 65535) {
+                        fprintf(stderr, "-background expects three "
+                                        "integers from 0 to 65535\n");
+                        usage(argv[0]);
+                }
+                samples[k] = (unsigned)value;
+        }
+        color->red = samples[0];
+        color->green = samples[1];
+        color->blue = samples[2];
 }
 
+/* Function: uncheckedMethods
+ * Purpose: Swaps the UArray2 or UArray2b methods for their unchecked
+ *          twins, together with the matching map
+ * Arguments: The methods, a pointer to the chosen mapping function
+ * Returns: The unchecked table, with *map updated
+ */
+A2Methods_T uncheckedMethods(A2Methods_T methods, A2Methods_mapfun **map)
+{
+        A2Methods_T twin = methods == uarray2_methods_blocked
+                                ? uarray2_methods_blocked_unchecked
+                                : uarray2_methods_plain_unchecked;
+        if (*map == methods->map_col_major) {
+                *map = twin->map_col_major;
+        } else if (*map == methods->map_block_major) {
+                *map = twin->map_block_major;
+        } else {
+                *map = twin->map_default;
+        }
+        return twin;
+}
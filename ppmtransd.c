@@ -0,0 +1,576 @@
+/*
+ *                              ppmtransd
+ *
+ *   Purpose:
+ *
+ *     A resident version of ppmtrans that serves rotation requests
+ *     over a Unix domain socket. Destination arrays, worker threads
+ *     and the rest of the transform state stay warm between requests,
+ *     so small images no longer pay for process startup.
+ *
+ *     Each request is one header line, optionally followed by a
+ *     payload:
+ *
+ *         path <file> <rotation> <layout> [<order>]
+ *         inline <nbytes> <rotation> <layout> [<order>]
+ *                                       (then nbytes of PPM)
+ *         stats
+ *
+ *     where layout is one of row, col, block or default and the
+ *     optional order is scatter, gather, stream or auto (the default). A transform
+ *     is answered with "OK <nbytes> <latency_us> <queue_depth>" and
+ *     nbytes of P6 output; a failure, including a malformed image,
+ *     with "ERR <message>". Several requests may be sent on one
+ *     connection. The socket is only open to the daemon's own user.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "assert.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "pnm.h"
+#include "a2spec.h"
+#include "a2pool.h"
+#include "transform.h"
+#include "ppmio.h"
+
+typedef A2Methods_UArray2 A2;
+
+#define QUEUE_CAPACITY 64
+#define MAX_PAYLOAD (1L << 30)
+
+static const char BAD_LENGTH[] = "bad payload length";
+
+/* Struct connQueue
+* Bounded queue of accepted connections waiting for a worker
+*/
+struct connQueue {
+    int fds[QUEUE_CAPACITY];
+    int head;              /* index of the oldest waiting connection */
+    int count;             /* number of waiting connections */
+    pthread_mutex_t lock;
+    pthread_cond_t nonEmpty;
+    pthread_cond_t nonFull;
+};
+
+/* Struct serverStats
+* Running totals reported by the stats request
+*/
+struct serverStats {
+    long requests;         /* transforms answered with OK */
+    long failures;         /* requests answered with ERR */
+    double totalLatency;   /* sum of OK latencies, in microseconds */
+    pthread_mutex_t lock;
+};
+
+static struct connQueue queue;
+static struct serverStats stats;
+static A2Pool_T plainPool;
+static A2Pool_T blockedPool;
+static const char *socketPath;
+static int verbose = 0;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+ *              Forward declaration of functions/
+ * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int openSocket(const char *path);
+int removeStaleSocket(const char *path, struct sockaddr_un *addr);
+void queuePush(int fd);
+int queuePop(void);
+void *worker(void *cl);
+void serveConnection(int fd);
+int serveRequest(char *line, FILE *in, FILE *out, int depth);
+int layoutMethods(const char *layout, A2Methods_T *methods,
+                  A2Methods_mapfun **map, A2Pool_T *pool);
+Pnm_ppm readRequestImage(char *kind, char *arg, FILE *in,
+                         A2Methods_T methods, const char **error);
+double elapsedMicros(struct timespec *start);
+void onSignal(int signum);
+
+static void
+usage(const char *progname)
+{
+        fprintf(stderr, "Usage: %s [-socket <path>] [-threads <n>] "
+                        "[-verbose]\n", progname);
+        exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int numThreads = 4;
+    socketPath = "/tmp/ppmtransd.sock";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-socket") == 0 && i + 1 < argc) {
+                socketPath = argv[++i];
+        } else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc) {
+                numThreads = atoi(argv[++i]);
+                if (numThreads < 1) {
+                        usage(argv[0]);
+                }
+        } else if (strcmp(argv[i], "-verbose") == 0) {
+                verbose = 1;
+        } else {
+                usage(argv[0]);
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.nonEmpty, NULL);
+    pthread_cond_init(&queue.nonFull, NULL);
+    pthread_mutex_init(&stats.lock, NULL);
+    plainPool = A2Pool_new(A2Spec_plain(sizeof(struct Pnm_rgb)),
+                           2 * numThreads);
+    blockedPool = A2Pool_new(A2Spec_blocked(sizeof(struct Pnm_rgb)),
+                             2 * numThreads);
+
+    int listener = openSocket(socketPath);
+
+    for (int i = 0; i < numThreads; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker, NULL) != 0) {
+            fprintf(stderr, "Could not start worker %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+        pthread_detach(thread);
+    }
+    fprintf(stderr, "ppmtransd: listening on %s with %d workers\n",
+            socketPath, numThreads);
+
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        queuePush(fd);
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+ *            Functions implementing the ppmtransd server
+ * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/* Function: openSocket
+ * Purpose: Creates the listening Unix domain socket, replacing a stale
+ *          socket file left behind by an earlier server. Only the
+ *          daemon's own user may connect: a path request opens files
+ *          with the daemon's privileges.
+ * Arguments: The filesystem path of the socket
+ * Returns: The listening file descriptor; exits on failure
+ */
+int openSocket(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", path);
+        exit(EXIT_FAILURE);
+    }
+    strcpy(addr.sun_path, path);
+
+    if (!removeStaleSocket(path, &addr)) {
+        exit(EXIT_FAILURE);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    mode_t oldMask = umask(077);        /* no window with a wider mode */
+    int bound = fd >= 0 &&
+                bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    umask(oldMask);
+    if (!bound || chmod(path, 0600) != 0 ||
+        listen(fd, QUEUE_CAPACITY) != 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+/* Function: removeStaleSocket
+ * Purpose: Clears the way for bind. Only a socket that no server
+ *          answers on is removed: any other file, and the socket of a
+ *          running server, is left alone.
+ * Arguments: The socket path and its address
+ * Returns: 1 if the path is now free, 0 (after saying why) otherwise
+ */
+int removeStaleSocket(const char *path, struct sockaddr_un *addr)
+{
+    struct stat info;
+    if (lstat(path, &info) != 0) {
+        if (errno == ENOENT) {
+            return 1;
+        }
+        perror(path);
+        return 0;
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        fprintf(stderr, "%s exists and is not a socket\n", path);
+        return 0;
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        perror("socket");
+        return 0;
+    }
+    int live = connect(probe, (struct sockaddr *)addr, sizeof(*addr)) == 0;
+    close(probe);
+    if (live) {
+        fprintf(stderr, "A server is already listening on %s\n", path);
+        return 0;
+    }
+    if (unlink(path) != 0) {
+        perror(path);
+        return 0;
+    }
+    return 1;
+}
+
+/* Function: queuePush
+ * Purpose: Hands an accepted connection to the workers, blocking while
+ *          the queue is full so that a burst applies back-pressure
+ * Arguments: The connection's file descriptor
+ * Returns: none
+ */
+void queuePush(int fd)
+{
+    pthread_mutex_lock(&queue.lock);
+    while (queue.count == QUEUE_CAPACITY) {
+        pthread_cond_wait(&queue.nonFull, &queue.lock);
+    }
+    queue.fds[(queue.head + queue.count) % QUEUE_CAPACITY] = fd;
+    queue.count++;
+    pthread_cond_signal(&queue.nonEmpty);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+/* Function: queuePop
+ * Purpose: Waits for and removes the oldest queued connection
+ * Arguments: none
+ * Returns: The connection's file descriptor
+ */
+int queuePop(void)
+{
+    pthread_mutex_lock(&queue.lock);
+    while (queue.count == 0) {
+        pthread_cond_wait(&queue.nonEmpty, &queue.lock);
+    }
+    int fd = queue.fds[queue.head];
+    queue.head = (queue.head + 1) % QUEUE_CAPACITY;
+    queue.count--;
+    pthread_cond_signal(&queue.nonFull);
+    pthread_mutex_unlock(&queue.lock);
+    return fd;
+}
+
+/* Function: worker
+ * Purpose: Thread body; serves queued connections forever
+ * Arguments: Unused
+ * Returns: never
+ */
+void *worker(void *cl)
+{
+    (void)cl;
+    for (;;) {
+        serveConnection(queuePop());
+    }
+    return NULL;
+}
+
+/* Function: serveConnection
+ * Purpose: Answers requests on one connection until the client closes
+ *          it or sends a malformed request
+ * Arguments: The connection's file descriptor, which is closed here
+ * Returns: none
+ */
+void serveConnection(int fd)
+{
+    FILE *in = fdopen(fd, "rb");
+    int outFd = dup(fd);
+    FILE *out = outFd < 0 ? NULL : fdopen(outFd, "wb");
+    if (in == NULL || out == NULL) {
+        if (in != NULL) fclose(in); else close(fd);
+        if (out != NULL) fclose(out); else if (outFd >= 0) close(outFd);
+        return;
+    }
+
+    char line[4096];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        pthread_mutex_lock(&queue.lock);
+        int depth = queue.count;
+        pthread_mutex_unlock(&queue.lock);
+
+        int keepGoing = serveRequest(line, in, out, depth);
+        if (fflush(out) != 0 || !keepGoing) {
+            break;
+        }
+    }
+    fclose(out);
+    fclose(in);
+}
+
+/* Function: serveRequest
+ * Purpose: Parses and answers a single request
+ * Arguments: The request's header line,
+ *            the connection's input (for inline payloads) and output,
+ *            the number of connections waiting for a worker
+ * Returns: 1 if the connection can serve further requests, 0 if the
+ *          request stream can no longer be trusted
+ */
+int serveRequest(char *line, FILE *in, FILE *out, int depth)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    char *save;                         /* workers parse concurrently */
+    char *kind = strtok_r(line, " \t\r\n", &save);
+    if (kind != NULL && strcmp(kind, "stats") == 0) {
+        pthread_mutex_lock(&stats.lock);
+        fprintf(out, "STATS requests %ld failures %ld mean_latency_us %.0f "
+                     "queue_depth %d\n", stats.requests, stats.failures,
+                stats.requests > 0 ? stats.totalLatency / stats.requests
+                                   : 0.0, depth);
+        pthread_mutex_unlock(&stats.lock);
+        return 1;
+    }
+
+    char *arg = strtok_r(NULL, " \t\r\n", &save);
+    char *rotationArg = strtok_r(NULL, " \t\r\n", &save);
+    char *layout = strtok_r(NULL, " \t\r\n", &save);
+    char *orderArg = strtok_r(NULL, " \t\r\n", &save);
+    const char *error = NULL;
+    Transform_order order = TRANSFORM_AUTO;
+    int keepGoing = 1;
+
+    A2Methods_T methods = NULL;
+    A2Methods_mapfun *map = NULL;
+    A2Pool_T pool = NULL;
+    char *endptr = NULL;
+    int rotation = rotationArg == NULL ? -1
+                                       : strtol(rotationArg, &endptr, 10);
+
+    if (kind == NULL || arg == NULL || layout == NULL ||
+        (strcmp(kind, "path") != 0 && strcmp(kind, "inline") != 0)) {
+        error = "malformed request";
+        keepGoing = 0;
+    } else if (*endptr != '\0' || !(rotation == 0 || rotation == 90 ||
+               rotation == 180 || rotation == 270)) {
+        error = "rotation must be 0, 90, 180 or 270";
+    } else if (!layoutMethods(layout, &methods, &map, &pool)) {
+        error = "layout must be row, col, block or default";
+    } else if (orderArg != NULL && strcmp(orderArg, "auto") != 0) {
+        if (strcmp(orderArg, "gather") == 0) {
+            order = TRANSFORM_GATHER;
+        } else if (strcmp(orderArg, "scatter") == 0) {
+            order = TRANSFORM_SCATTER;
+        } else if (strcmp(orderArg, "stream") == 0) {
+            order = TRANSFORM_STREAM;
+        } else {
+            error = "order must be scatter, gather, stream or auto";
+        }
+    }
+
+    /* an inline payload must be consumed even if we will reject it */
+    Pnm_ppm pixMap = NULL;
+    if (keepGoing && strcmp(kind, "inline") == 0) {
+        pixMap = readRequestImage(kind, arg, in,
+                                  error == NULL ? methods : NULL, &error);
+        if (error == BAD_LENGTH) {
+            keepGoing = 0;
+        }
+    } else if (error == NULL) {
+        pixMap = readRequestImage(kind, arg, in, methods, &error);
+    }
+
+    if (error != NULL) {
+        fprintf(out, "ERR %s\n", error);
+        pthread_mutex_lock(&stats.lock);
+        stats.failures++;
+        pthread_mutex_unlock(&stats.lock);
+        return keepGoing;
+    }
+
+    int width, height;
+    Transform_dims(rotation, pixMap->width, pixMap->height, &width, &height);
+    A2 finalArr = A2Pool_get(pool, width, height, sizeof(struct Pnm_rgb));
+    Transform_rotate(methods, map, pixMap->pixels, finalArr, rotation,
+                     order);
+
+    A2 source = pixMap->pixels;
+    pixMap->pixels = finalArr;
+    pixMap->width = width;
+    pixMap->height = height;
+
+    char *result = NULL;
+    size_t resultLen = 0;
+    FILE *resultFile = open_memstream(&result, &resultLen);
+    assert(resultFile != NULL);
+    Pnm_ppmwrite(resultFile, pixMap);
+    fclose(resultFile);
+
+    pixMap->pixels = source;
+    A2Pool_put(pool, finalArr);
+    Pnm_ppmfree(&pixMap);
+
+    double latency = elapsedMicros(&start);
+    fprintf(out, "OK %zu %.0f %d\n", resultLen, latency, depth);
+    fwrite(result, 1, resultLen, out);
+    free(result);
+
+    pthread_mutex_lock(&stats.lock);
+    stats.requests++;
+    stats.totalLatency += latency;
+    pthread_mutex_unlock(&stats.lock);
+    if (verbose) {
+        fprintf(stderr, "ppmtransd: %s %s rotate %d %s: %.0f us, "
+                        "queue depth %d\n", kind, arg, rotation, layout,
+                latency, depth);
+    }
+    return 1;
+}
+
+/* Function: layoutMethods
+ * Purpose: Maps a layout hint to a representation, a traversal and
+ *          the pool of warm destination arrays for that representation.
+ *          The representations are the a2spec tables for Pnm_rgb cells.
+ * Arguments: The hint and pointers receiving the three results
+ * Returns: 1 if the hint is recognized, 0 otherwise
+ */
+int layoutMethods(const char *layout, A2Methods_T *methods,
+                  A2Methods_mapfun **map, A2Pool_T *pool)
+{
+    if (strcmp(layout, "block") == 0) {
+        *methods = A2Spec_blocked(sizeof(struct Pnm_rgb));
+        *map = (*methods)->map_block_major;
+        *pool = blockedPool;
+    } else {
+        *methods = A2Spec_plain(sizeof(struct Pnm_rgb));
+        *pool = plainPool;
+        if (strcmp(layout, "row") == 0) {
+            *map = (*methods)->map_row_major;
+        } else if (strcmp(layout, "col") == 0) {
+            *map = (*methods)->map_col_major;
+        } else if (strcmp(layout, "default") == 0) {
+            *map = (*methods)->map_default;
+        } else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Function: readRequestImage
+ * Purpose: Reads the image named by a path request or carried by an
+ *          inline request. A malformed or truncated image, or one whose
+ *          header claims more pixels than the data could hold, is an
+ *          error reported to the client rather than a failure of the
+ *          daemon.
+ * Arguments: The request kind and its argument,
+ *            the connection input holding any inline payload,
+ *            the methods to read with, or NULL to only drain the
+ *            payload of a request that is already rejected,
+ *            a pointer that receives an error message on failure
+ * Returns: The image, or NULL on failure
+ */
+Pnm_ppm readRequestImage(char *kind, char *arg, FILE *in,
+                         A2Methods_T methods, const char **error)
+{
+    FILE *fp;
+    char *payload = NULL;
+    long bytes;                         /* in the file or the payload */
+
+    if (strcmp(kind, "path") == 0) {
+        fp = fopen(arg, "rb");
+        if (fp == NULL) {
+            *error = "could not open file";
+            return NULL;
+        }
+        struct stat info;
+        bytes = fstat(fileno(fp), &info) == 0 ? (long)info.st_size : 0;
+    } else {
+        char *endptr;
+        long length = strtol(arg, &endptr, 10);
+        if (*endptr != '\0' || length < 2 || length > MAX_PAYLOAD) {
+            *error = BAD_LENGTH;
+            return NULL;
+        }
+        payload = malloc(length);
+        assert(payload != NULL);
+        if (fread(payload, 1, length, in) != (size_t)length) {
+            free(payload);
+            *error = BAD_LENGTH;
+            return NULL;
+        }
+        if (methods == NULL) {
+            free(payload);
+            return NULL;
+        }
+        fp = fmemopen(payload, length, "rb");
+        if (fp == NULL) {
+            free(payload);
+            *error = "out of memory";
+            return NULL;
+        }
+        bytes = length;
+    }
+
+    Pnm_ppm pixMap = NULL;
+    struct PpmIO_header header;
+    if (!PpmIO_readHeader(fp, &header) || !PpmIO_isColor(&header)) {
+        *error = "not a PPM image";
+    } else if ((double)header.width * header.height *
+               (header.raw ? PpmIO_pixelBytes(&header) : 6) > bytes + 1.0) {
+        *error = "truncated image";     /* a plain sample takes 2 bytes */
+    } else {
+        pixMap = PpmIO_readPixels(fp, &header, methods, 0, NULL);
+        if (pixMap == NULL) {
+            *error = "malformed or truncated image";
+        }
+    }
+    fclose(fp);
+    free(payload);
+    return pixMap;
+}
+
+/* Function: elapsedMicros
+ * Purpose: Measures wall-clock time since start
+ * Arguments: The CLOCK_MONOTONIC start time
+ * Returns: The elapsed time in microseconds
+ */
+double elapsedMicros(struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e6 +
+           (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* Function: onSignal
+ * Purpose: Removes the socket file when the server is told to stop
+ * Arguments: The signal number
+ * Returns: never
+ */
+void onSignal(int signum)
+{
+    (void)signum;
+    unlink(socketPath);
+    _exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,70 @@
+/*
+ *                              rgbcells
+ *
+ *   Purpose:
+ *
+ *     Direct access to the Pnm_rgb cells of an A2 array, for kernels
+ *     that visit pixels in their own order rather than through a map.
+ *     Arrays of the 12-byte a2spec tables are reached with the inlined
+ *     UArray2s accessors; any other representation goes through its
+ *     methods' 'at'.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef RGBCELLS_INCLUDED
+#define RGBCELLS_INCLUDED
+
+#include "a2methods.h"
+#include "pnm.h"
+#include "uarray2spec.h"
+#include "a2spec.h"
+
+typedef struct RgbCells {
+    enum { RGBCELLS_METHODS, RGBCELLS_PLAIN, RGBCELLS_BLOCKED } kind;
+    A2Methods_T methods;
+    A2Methods_UArray2 array;
+    int width, height;
+} RgbCells;
+
+/* Function: RgbCells_of
+ * Purpose: Describes how to reach the cells of a Pnm_rgb array
+ * Arguments: The methods of the array, the array
+ * Returns: An RgbCells value
+ */
+static inline RgbCells RgbCells_of(A2Methods_T methods,
+                                   A2Methods_UArray2 array)
+{
+    RgbCells cells;
+    assert(methods->size(array) == sizeof(struct Pnm_rgb));
+    cells.kind = RGBCELLS_METHODS;
+    if (A2Spec_size(methods) == sizeof(struct Pnm_rgb)) {
+        cells.kind = A2Spec_isBlocked(methods) ? RGBCELLS_BLOCKED
+                                               : RGBCELLS_PLAIN;
+    }
+    cells.methods = methods;
+    cells.array = array;
+    cells.width = methods->width(array);
+    cells.height = methods->height(array);
+    return cells;
+}
+
+/* Function: RgbCells_at
+ * Purpose: Finds the pixel in column x, row y
+ * Arguments: The cells, in-bounds coordinates
+ * Returns: A pointer to the pixel
+ */
+static inline struct Pnm_rgb *RgbCells_at(const RgbCells *cells, int x, int y)
+{
+    switch (cells->kind) {
+    case RGBCELLS_PLAIN:
+        return UArray2s_at_12(cells->array, x, y);
+    case RGBCELLS_BLOCKED:
+        return UArray2s_blocked_at_12(cells->array, x, y);
+    default:
+        return cells->methods->at(cells->array, x, y);
+    }
+}
+
+#endif
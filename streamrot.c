@@ -0,0 +1,345 @@
+/*
+ *                              streamrot
+ *
+ *   Purpose:
+ *
+ *     Implementation of the streaming rotation kernels. The rotated
+ *     image is written once and not read again before output, so
+ *     letting each destination write allocate a cache line (and read
+ *     the line from memory first) only costs bandwidth. These kernels
+ *     instead:
+ *
+ *       - walk the destination in storage order: row by row for a
+ *         UArray2, block by block for a UArray2b, so consecutive
+ *         stores fill whole lines in the write-combining buffers
+ *       - store with non-temporal (streaming) stores where the
+ *         instruction set has them, falling back to ordinary copies
+ *       - prefetch the source a fixed distance ahead of use
+ *
+ *     For 90 and 270 degrees on a UArray2 the destination is written
+ *     as a band of BAND_ROWS rows at a time, so every source line that
+ *     is fetched supplies BAND_ROWS pixels instead of one.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <string.h>
+#include "assert.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2unchecked.h"
+#include "uarray2.h"
+#include "uarray2b.h"
+#include "uarray2spec.h"
+#include "a2spec.h"
+#include "cacheinfo.h"
+#include "streamrot.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+typedef A2Methods_UArray2 A2;
+
+/* destination rows written together by the 90/270 plain kernel; kept
+   below the number of write-combining buffers of current x86 cores */
+#define BAND_ROWS 8
+
+/* how far ahead the source is prefetched: rows for column walks,
+   elements for row walks */
+#define PREFETCH_ROWS 8
+#define PREFETCH_ELEMS 32
+
+static void rotatePlain(A2Methods_T methods, A2 src, A2 dest,
+                        int rotation, int size);
+static void rotateBlocked(A2Methods_T methods, A2 src, A2 dest,
+                          int rotation, int size);
+
+/* Function: rowOf
+ * Purpose: Finds the contiguous storage of row j of a plain array
+ * Arguments: Whether the array is a UArray2s, the array, the row
+ * Returns: A pointer to the cell in column 0
+ */
+static inline char *rowOf(int spec, A2 array, int j)
+{
+    if (spec) {
+        UArray2s_T a = array;
+        return a->elems + (long)j * a->pitch * a->size;
+    }
+    return UArray2_row(array, j);
+}
+
+/* Function: blockOf
+ * Purpose: Finds the contiguous storage of one block of a blocked
+ *          array
+ * Arguments: Whether the array is a UArray2s, the array, the column
+ *            and row of the block
+ * Returns: A pointer to the first cell of the block
+ */
+static inline char *blockOf(int spec, A2 array, int blockCol, int blockRow)
+{
+    if (spec) {
+        UArray2s_T a = array;
+        long block = (long)blockRow * a->blocksWide + blockCol;
+        return a->elems + block * a->blockStride * a->size;
+    }
+    return UArray2b_block(array, blockCol, blockRow);
+}
+
+/* Function: streamCopy
+ * Purpose: Copies one element to memory that will not be read soon,
+ *          using non-temporal stores when the element is a whole
+ *          number of 32-bit words
+ * Arguments: The destination, the source, the element size in bytes
+ * Returns: none
+ */
+static inline void streamCopy(char *dst, const char *src, int size)
+{
+#if defined(__SSE2__)
+    if ((size & 3) == 0) {
+        for (int k = 0; k < size; k += 4) {
+            int word;
+            memcpy(&word, src + k, sizeof(word));
+            _mm_stream_si32((int *)(dst + k), word);
+        }
+        return;
+    }
+#endif
+    memcpy(dst, src, size);
+}
+
+/* Function: streamFence
+ * Purpose: Orders the non-temporal stores before anything that
+ *          follows, so the destination may be read safely
+ * Returns: none
+ */
+static inline void streamFence(void)
+{
+#if defined(__SSE2__)
+    _mm_sfence();
+#endif
+}
+
+/* Function: StreamRot_supported
+ * Purpose: Tells whether the kernels can work directly on the storage
+ *          of arrays made by the given methods
+ * Arguments: The methods of the arrays
+ * Returns: 1 for UArray2, UArray2b and a2spec methods (checked or
+ *          not), 0 otherwise
+ */
+int StreamRot_supported(A2Methods_T methods)
+{
+    return methods == uarray2_methods_plain ||
+           methods == uarray2_methods_plain_unchecked ||
+           methods == uarray2_methods_blocked ||
+           methods == uarray2_methods_blocked_unchecked ||
+           A2Spec_size(methods) != 0;
+}
+
+/* Function: StreamRot_rotate
+ * Purpose: Stores every pixel of src at its rotated position in dest
+ * Arguments: Methods for which StreamRot_supported holds,
+ *            the source array,
+ *            a destination array of the rotated shape,
+ *            the rotation amount (0, 90, 180 or 270)
+ * Returns: none
+ */
+void StreamRot_rotate(A2Methods_T methods, A2 src, A2 dest, int rotation)
+{
+    assert(StreamRot_supported(methods));
+    assert(src != NULL && dest != NULL);
+    int size = methods->size(src);
+    assert(methods->size(dest) == size);
+
+    if (methods == uarray2_methods_plain ||
+        methods == uarray2_methods_plain_unchecked ||
+        (A2Spec_size(methods) != 0 && !A2Spec_isBlocked(methods))) {
+        rotatePlain(methods, src, dest, rotation, size);
+    } else {
+        rotateBlocked(methods, src, dest, rotation, size);
+    }
+    streamFence();
+}
+
+/* Function: rotatePlain
+ * Purpose: Streaming kernel for row-major arrays: fills destination
+ *          rows in order, one row (0, 180) or one band of rows
+ *          (90, 270) at a time
+ * Arguments: The methods, the source and destination, the rotation,
+ *            the element size
+ * Returns: none
+ */
+static void rotatePlain(A2Methods_T methods, A2 src, A2 dest,
+                        int rotation, int size)
+{
+    int spec = A2Spec_size(methods) != 0;
+    int w = methods->width(src);
+    int h = methods->height(src);
+    int dw = methods->width(dest);
+    int dh = methods->height(dest);
+    if (w == 0 || h == 0) {
+        return;
+    }
+
+    if (rotation == 0 || rotation == 180) {
+        for (int j = 0; j < dh; j++) {
+            char *d = rowOf(spec, dest, j);
+            if (rotation == 0) {
+                const char *s = rowOf(spec, src, j);
+                for (int i = 0; i < dw; i++) {
+                    __builtin_prefetch(s + (i + PREFETCH_ELEMS) * size);
+                    streamCopy(d + i * size, s + i * size, size);
+                }
+            } else {
+                const char *s = rowOf(spec, src, h - j - 1);
+                for (int i = 0; i < dw; i++) {
+                    const char *sp = s + (w - i - 1) * size;
+                    __builtin_prefetch(sp - PREFETCH_ELEMS * size);
+                    streamCopy(d + i * size, sp, size);
+                }
+            }
+        }
+        return;
+    }
+
+    /* 90: dest(i, j) = src(j, h - i - 1); 270: dest(i, j) = src(w - j - 1, i)
+       column i of a destination band reads one source row */
+    char *d[BAND_ROWS];
+    for (int j0 = 0; j0 < dh; j0 += BAND_ROWS) {
+        int rows = dh - j0 < BAND_ROWS ? dh - j0 : BAND_ROWS;
+        for (int k = 0; k < rows; k++) {
+            d[k] = rowOf(spec, dest, j0 + k);
+        }
+        int firstCol = rotation == 90 ? j0 : w - j0 - rows;
+        for (int i = 0; i < dw; i++) {
+            int srcRow = rotation == 90 ? h - i - 1 : i;
+            int ahead = rotation == 90 ? srcRow - PREFETCH_ROWS
+                                       : srcRow + PREFETCH_ROWS;
+            if (ahead >= 0 && ahead < h) {
+                const char *p = rowOf(spec, src, ahead);
+                __builtin_prefetch(p + firstCol * size);
+                __builtin_prefetch(p + (firstCol + rows) * size - 1);
+            }
+            const char *s = rowOf(spec, src, srcRow);
+            for (int k = 0; k < rows; k++) {
+                int srcCol = rotation == 90 ? j0 + k : w - j0 - k - 1;
+                streamCopy(d[k] + i * size, s + srcCol * size, size);
+            }
+        }
+    }
+}
+
+/* Struct blockCursor
+* Remembers the most recently used source block so that consecutive
+* reads from the same block skip the block lookup
+*/
+struct blockCursor {
+    int spec;               /* array is a UArray2s */
+    A2 array;
+    int blocksize;
+    int size;
+    int blockCol, blockRow; /* block held in base, -1 if none */
+    char *base;
+};
+
+/* Function: cursorAt
+ * Purpose: Finds the cell at (col, row) of a UArray2b
+ * Arguments: A cursor over the array, the column and row
+ * Returns: A pointer to the cell
+ */
+static inline char *cursorAt(struct blockCursor *cur, int col, int row)
+{
+    int bs = cur->blocksize;
+    int blockCol = col / bs;
+    int blockRow = row / bs;
+    if (blockCol != cur->blockCol || blockRow != cur->blockRow) {
+        cur->base = blockOf(cur->spec, cur->array, blockCol, blockRow);
+        cur->blockCol = blockCol;
+        cur->blockRow = blockRow;
+    }
+    return cur->base + ((row % bs) * bs + col % bs) * cur->size;
+}
+
+/* Function: sourceOf
+ * Purpose: Inverts the rotation for one destination cell
+ * Arguments: The destination column and row, the rotation, the
+ *            source width and height, pointers receiving the source
+ *            column and row
+ * Returns: none
+ */
+static inline void sourceOf(int i, int j, int rotation, int w, int h,
+                            int *col, int *row)
+{
+    switch (rotation) {
+    case 90:  *col = j;         *row = h - i - 1; break;
+    case 180: *col = w - i - 1; *row = h - j - 1; break;
+    case 270: *col = w - j - 1; *row = i;         break;
+    default:  *col = i;         *row = j;         break;
+    }
+}
+
+/* Function: rotateBlocked
+ * Purpose: Streaming kernel for blocked arrays: fills destination blocks
+ *          one after another, each in its storage order. While a block
+ *          is being filled, the source block feeding the next one is
+ *          prefetched a row's worth of lines at a time.
+ * Arguments: The methods, the source and destination, the rotation,
+ *            the element size
+ * Returns: none
+ */
+static void rotateBlocked(A2Methods_T methods, A2 src, A2 dest,
+                          int rotation, int size)
+{
+    int spec = A2Spec_size(methods) != 0;
+    int w = methods->width(src);
+    int h = methods->height(src);
+    int dw = methods->width(dest);
+    int dh = methods->height(dest);
+    int bs = methods->blocksize(dest);
+    int blocksWide = (dw + bs - 1) / bs;
+    int blocksHigh = (dh + bs - 1) / bs;
+    int numBlocks = blocksWide * blocksHigh;
+
+    struct blockCursor cur = { spec, src, methods->blocksize(src), size,
+                               -1, -1, NULL };
+    int srcBlockBytes = cur.blocksize * cur.blocksize * size;
+    int line = (int)CacheInfo_lineBytes();
+    /* lines of the next source block to prefetch per destination row */
+    int linesPerRow = (srcBlockBytes / line + bs - 1) / bs;
+
+    for (int b = 0; b < numBlocks; b++) {
+        int blockCol = b % blocksWide;
+        int blockRow = b / blocksWide;
+        char *d = blockOf(spec, dest, blockCol, blockRow);
+
+        const char *next = NULL;
+        if (b + 1 < numBlocks) {
+            int col, row;
+            sourceOf(((b + 1) % blocksWide) * bs, ((b + 1) / blocksWide) * bs,
+                     rotation, w, h, &col, &row);
+            next = blockOf(spec, src, col / cur.blocksize,
+                           row / cur.blocksize);
+        }
+
+        int iLimit = dw - blockCol * bs < bs ? dw - blockCol * bs : bs;
+        int jLimit = dh - blockRow * bs < bs ? dh - blockRow * bs : bs;
+        for (int rr = 0; rr < jLimit; rr++) {
+            if (next != NULL) {
+                for (int l = 0; l < linesPerRow; l++) {
+                    int offset = (rr * linesPerRow + l) * line;
+                    if (offset < srcBlockBytes) {
+                        __builtin_prefetch(next + offset);
+                    }
+                }
+            }
+            int j = blockRow * bs + rr;
+            char *drow = d + rr * bs * size;
+            for (int cc = 0; cc < iLimit; cc++) {
+                int col, row;
+                sourceOf(blockCol * bs + cc, j, rotation, w, h, &col, &row);
+                streamCopy(drow + cc * size, cursorAt(&cur, col, row), size);
+            }
+        }
+    }
+}
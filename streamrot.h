@@ -0,0 +1,24 @@
+/*
+ *                              streamrot
+ *
+ *   Purpose:
+ *
+ *     Interface to the streaming rotation kernels, meant for images
+ *     too large to stay in the last-level cache. They walk the
+ *     destination in storage order, write it with non-temporal stores
+ *     that bypass the cache, and prefetch the source ahead of use.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef STREAMROT_INCLUDED
+#define STREAMROT_INCLUDED
+
+#include "a2methods.h"
+
+extern int  StreamRot_supported(A2Methods_T methods);
+extern void StreamRot_rotate(A2Methods_T methods, A2Methods_UArray2 src,
+                             A2Methods_UArray2 dest, int rotation);
+
+#endif
@@ -0,0 +1,266 @@
+/*
+ *                              tiled
+ *
+ *   Purpose:
+ *
+ *     Implementation of the tiled image format. Blocks are moved
+ *     whole: straight between the file and the array's own storage
+ *     when the array is laid out like the file, and otherwise through
+ *     a scratch block that is filled or emptied with 'at'. The writer
+ *     makes two passes over the blocks, one to find the all-zero
+ *     blocks and build the index and one to write the others, so that
+ *     the output can be a pipe.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "mem.h"
+#include "a2blocked.h"
+#include "a2unchecked.h"
+#include "a2spec.h"
+#include "uarray2b.h"
+#include "uarray2spec.h"
+#include "ppmio.h"
+#include "tiled.h"
+
+typedef A2Methods_UArray2 A2;
+
+#define MAX_BLOCK_BYTES 65536           /* of blocks made up for plain */
+#define MAX_FILE_BLOCK_BYTES (64L << 20)  /* of blocks accepted */
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_ORDER 'B'
+#else
+#define HOST_ORDER 'L'
+#endif
+
+/* Struct tiling
+* The geometry shared by an image's array and its file
+*/
+struct tiling {
+    A2Methods_T methods;
+    A2 array;
+    int width, height, blocksize;
+    int blocksWide, blocksHigh;
+    long blockBytes;
+};
+
+static struct tiling tilingOf(A2Methods_T methods, A2 array, int blocksize)
+{
+    struct tiling t;
+    t.methods = methods;
+    t.array = array;
+    t.width = methods->width(array);
+    t.height = methods->height(array);
+    t.blocksize = blocksize;
+    t.blocksWide = (t.width + blocksize - 1) / blocksize;
+    t.blocksHigh = (t.height + blocksize - 1) / blocksize;
+    t.blockBytes = (long)blocksize * blocksize * sizeof(struct Pnm_rgb);
+    return t;
+}
+
+/* Function: storage
+ * Purpose: Finds a block in the array's own storage, when the array is
+ *          laid out as the file is
+ * Arguments: The tiling, the column and row of the block
+ * Returns: The block's first cell, or NULL if the array is laid out
+ *          otherwise
+ */
+static char *storage(const struct tiling *t, int bi, int bj)
+{
+    if (t->methods->blocksize(t->array) != t->blocksize) {
+        return NULL;
+    } else if (t->methods == uarray2_methods_blocked ||
+               t->methods == uarray2_methods_blocked_unchecked) {
+        return UArray2b_block(t->array, bi, bj);
+    } else if (A2Spec_isBlocked(t->methods) &&
+               A2Spec_size(t->methods) == sizeof(struct Pnm_rgb)) {
+        UArray2s_T cells = t->array;
+        return cells->elems + ((long)bj * cells->blocksWide + bi) *
+                              cells->blockStride * cells->size;
+    }
+    return NULL;
+}
+
+/* Function: moveCells
+ * Purpose: Copies the cells of one block that lie inside the image
+ *          between the array and a scratch block, with 'at'
+ * Arguments: The tiling, the column and row of the block, the scratch
+ *            block, 1 to copy into the array or 0 to copy out of it
+ * Returns: none
+ */
+static void moveCells(const struct tiling *t, int bi, int bj,
+                      char *scratch, int intoArray)
+{
+    int bs = t->blocksize;
+    int i0 = bi * bs, j0 = bj * bs;
+    int iw = t->width - i0 < bs ? t->width - i0 : bs;
+    int jh = t->height - j0 < bs ? t->height - j0 : bs;
+    struct Pnm_rgb *cells = (struct Pnm_rgb *)scratch;
+    for (int r = 0; r < jh; r++) {
+        for (int c = 0; c < iw; c++) {
+            struct Pnm_rgb *cell = t->methods->at(t->array, i0 + c, j0 + r);
+            if (intoArray) {
+                *cell = cells[r * bs + c];
+            } else {
+                cells[r * bs + c] = *cell;
+            }
+        }
+    }
+}
+
+/* Function: blockBytes
+ * Purpose: Finds the contents of a block for writing
+ * Arguments: The tiling, the column and row of the block, a scratch
+ *            block for arrays laid out otherwise
+ * Returns: The block's bytes
+ */
+static const char *blockBytes(const struct tiling *t, int bi, int bj,
+                              char *scratch)
+{
+    char *bytes = storage(t, bi, bj);
+    if (bytes == NULL) {
+        memset(scratch, 0, t->blockBytes);  /* cells past the edges */
+        moveCells(t, bi, bj, scratch, 0);
+        bytes = scratch;
+    }
+    return bytes;
+}
+
+static int allZero(const char *bytes, long n)
+{
+    return bytes[0] == 0 && memcmp(bytes, bytes + 1, n - 1) == 0;
+}
+
+/* Function: Tiled_detect
+ * Purpose: Tells a tiled file from a PNM image by its first byte
+ * Arguments: The open file
+ * Returns: 1 if the file starts as a tiled file does, 0 if not
+ */
+int Tiled_detect(FILE *fp)
+{
+    assert(fp != NULL);
+    int c = getc(fp);
+    if (c == EOF) {
+        return 0;
+    }
+    ungetc(c, fp);
+    return c == 'A';
+}
+
+/* Function: Tiled_read
+ * Purpose: Reads a tiled file into a new array
+ * Arguments: The open file, at its start; the methods of the array
+ * Returns: The image, or NULL if the file cannot be read
+ */
+Pnm_ppm Tiled_read(FILE *fp, A2Methods_T methods)
+{
+    assert(fp != NULL && methods != NULL);
+    char magic[4];
+    unsigned width, height, denominator, size, blocksize;
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+        memcmp(magic, "A2T", 3) != 0 || magic[3] != HOST_ORDER ||
+        !PpmIO_readNumber(fp, &width) || !PpmIO_readNumber(fp, &height) ||
+        !PpmIO_readNumber(fp, &denominator) ||
+        !PpmIO_readNumber(fp, &size) || !PpmIO_readNumber(fp, &blocksize)) {
+        return NULL;
+    }
+    if (width == 0 || height == 0 || width > INT32_MAX ||
+        height > INT32_MAX || denominator == 0 || denominator >= 65536 ||
+        size != sizeof(struct Pnm_rgb) || blocksize == 0 ||
+        (double)blocksize * blocksize * size > MAX_FILE_BLOCK_BYTES) {
+        return NULL;
+    }
+
+    A2 array = methods->new_with_blocksize(width, height, size, blocksize);
+    struct tiling t = tilingOf(methods, array, blocksize);
+    long blocks = (long)t.blocksWide * t.blocksHigh;
+    uint64_t *index = ALLOC(blocks * sizeof(uint64_t));
+    char *scratch = NULL;
+    int ok = fread(index, sizeof(uint64_t), blocks, fp) == (size_t)blocks;
+    uint64_t next = 0;      /* offset of the next stored block */
+    for (long k = 0; ok && k < blocks; k++) {
+        if (index[k] == 0) {
+            continue;       /* zero, as the new array already is */
+        }
+        int bi = k % t.blocksWide, bj = k / t.blocksWide;
+        char *bytes = storage(&t, bi, bj);
+        if (bytes == NULL) {
+            if (scratch == NULL) {
+                scratch = ALLOC(t.blockBytes);
+            }
+            bytes = scratch;
+        }
+        ok = (next == 0 || index[k] == next) &&
+             fread(bytes, 1, t.blockBytes, fp) == (size_t)t.blockBytes;
+        if (ok && bytes == scratch) {
+            moveCells(&t, bi, bj, scratch, 1);
+        }
+        next = index[k] + t.blockBytes;
+    }
+    FREE(scratch);
+    FREE(index);
+    if (!ok) {
+        methods->free(&array);
+        return NULL;
+    }
+
+    Pnm_ppm image;
+    NEW(image);
+    image->width = width;
+    image->height = height;
+    image->denominator = denominator;
+    image->pixels = array;
+    image->methods = methods;
+    return image;
+}
+
+/* Function: Tiled_write
+ * Purpose: Writes an image as a tiled file
+ * Arguments: The open file, the image
+ * Returns: none
+ */
+void Tiled_write(FILE *fp, Pnm_ppm image)
+{
+    assert(fp != NULL && image != NULL);
+    A2Methods_T methods = (A2Methods_T)image->methods;  /* only read */
+    assert(methods->size(image->pixels) == sizeof(struct Pnm_rgb));
+    int blocksize = methods->blocksize(image->pixels);
+    if (blocksize == 1) {
+        blocksize = sqrt(MAX_BLOCK_BYTES / sizeof(struct Pnm_rgb));
+    }
+    struct tiling t = tilingOf(methods, image->pixels, blocksize);
+
+    char header[128];
+    int headerBytes = snprintf(header, sizeof(header), "A2T%c\n%u %u %u\n"
+                               "%d %d\n", HOST_ORDER, image->width,
+                               image->height, image->denominator,
+                               (int)sizeof(struct Pnm_rgb), blocksize);
+    long blocks = (long)t.blocksWide * t.blocksHigh;
+    uint64_t *index = ALLOC(blocks * sizeof(uint64_t));
+    char *scratch = ALLOC(t.blockBytes);
+    uint64_t offset = headerBytes + blocks * sizeof(uint64_t);
+    for (long k = 0; k < blocks; k++) {
+        const char *bytes = blockBytes(&t, k % t.blocksWide,
+                                       k / t.blocksWide, scratch);
+        index[k] = allZero(bytes, t.blockBytes) ? 0 : offset;
+        offset += index[k] == 0 ? 0 : t.blockBytes;
+    }
+
+    fwrite(header, 1, headerBytes, fp);
+    fwrite(index, sizeof(uint64_t), blocks, fp);
+    for (long k = 0; k < blocks; k++) {
+        if (index[k] != 0) {
+            fwrite(blockBytes(&t, k % t.blocksWide, k / t.blocksWide,
+                              scratch), 1, t.blockBytes, fp);
+        }
+    }
+    FREE(scratch);
+    FREE(index);
+}
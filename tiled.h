@@ -0,0 +1,48 @@
+/*
+ *                              tiled
+ *
+ *   Purpose:
+ *
+ *     Interface to a tiled image file format whose layout is that of a
+ *     blocked A2 array, so that loading it is a read per block rather
+ *     than a parse and a scatter per pixel. A tiled file is:
+ *
+ *       - the magic "A2T" and a letter for the byte order of every
+ *         binary field below, 'L' (little-endian) or 'B' (big-endian);
+ *       - the width, height, denominator, cell size and blocksize, as
+ *         decimal numbers separated by whitespace, then one whitespace
+ *         character;
+ *       - the block index: for each block, row of blocks by row of
+ *         blocks, its offset in the file as a 64-bit unsigned number,
+ *         or 0 for a block whose cells are all zero and is not stored;
+ *       - the stored blocks, in the order of the index and each right
+ *         after the previous one: blocksize * blocksize cells, row by
+ *         row, including cells past the ragged right and bottom edges.
+ *
+ *     Cells are Pnm_rgb structs of three unsigned samples. A file is
+ *     read only on a machine of its byte order.
+ *
+ *     Tiled_read creates the array with the file's blocksize. When the
+ *     methods are those of UArray2b or of blocked 12-byte UArray2s
+ *     arrays, each block is read straight into the array's storage;
+ *     any other array is filled with its methods' 'at'.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef TILED_INCLUDED
+#define TILED_INCLUDED
+
+#include <stdio.h>
+#include "a2methods.h"
+#include "pnm.h"
+
+/* whether the next bytes of fp start a tiled file; none are consumed */
+extern int     Tiled_detect(FILE *fp);
+/* NULL if the file is malformed, truncated or of another byte order */
+extern Pnm_ppm Tiled_read  (FILE *fp, A2Methods_T methods);
+/* blocks as in the image's array, or of 64KB if it is not blocked */
+extern void    Tiled_write (FILE *fp, Pnm_ppm image);
+
+#endif
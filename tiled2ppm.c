@@ -0,0 +1,51 @@
+/*
+ *                              tiled2ppm
+ *
+ *   Purpose:
+ *
+ *     Converts a tiled image (tiled.h) back to a raw (P6) PPM:
+ *
+ *         tiled2ppm [image.tiled] > image.ppm
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "assert.h"
+#include "a2methods.h"
+#include "a2spec.h"
+#include "pnm.h"
+#include "ppmio.h"
+#include "tiled.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [image.tiled] > image.ppm\n", argv[0]);
+        exit(1);
+    }
+    FILE *in = argc == 2 ? fopen(argv[1], "rb") : stdin;
+    if (in == NULL) {
+        fprintf(stderr, "%s: Could not open file %s for reading\n",
+                argv[0], argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    A2Methods_T methods = A2Spec_blocked(sizeof(struct Pnm_rgb));
+    assert(methods != NULL);
+    Pnm_ppm image = Tiled_read(in, methods);
+    if (image == NULL) {
+        fprintf(stderr, "%s: input is not a complete tiled image of this "
+                        "machine's byte order\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    PpmIO_writeOriented(stdout, image, 0);
+    Pnm_ppmfree(&image);
+    return fflush(stdout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,403 @@
+/*
+ *                              transform
+ *
+ *   Purpose:
+ *
+ *     Implementation of the orientation engine. Either the source
+ *     array is traversed with the caller's mapping function and every
+ *     pixel is scattered to its rotated position in the destination
+ *     (scatter), or the destination is traversed and every pixel is
+ *     pulled from the source through the inverse rotation (gather).
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdlib.h>
+#include "assert.h"
+#include "pnm.h"
+#include "uarray2spec.h"
+#include "a2spec.h"
+#include "streamrot.h"
+#include "a2parallel.h"
+#include "transform.h"
+
+typedef A2Methods_UArray2 A2;
+
+/* Struct transformedArr
+* Struct to hold an initially empty A2 array
+* that is used to fill pixel coordinates post rotation
+*/
+struct transformedArr {
+    A2Methods_T methods; /* Methods of current 2D array representation */
+    A2 resArr; /* Scatter: stores final rotated arr; gather: the source */
+    int rotation; /* Rotation to be performed */
+    int width; /* Width of the source, kept out of the inner loop */
+    int height; /* Height of the source, kept out of the inner loop */
+};
+
+static A2Methods_applyfun *const SCATTER[4];
+static A2Methods_applyfun *const GATHER[4];
+static int specRotate(A2Methods_T methods, A2Methods_mapfun *map,
+                      struct transformedArr *closure, A2 src, A2 dest,
+                      Transform_order order);
+
+/* Function: destOf
+ * Purpose: Applies the rotation to one source cell
+ * Arguments: The rotation, the source width and height, the source
+ *            column and row, pointers receiving the destination
+ *            column and row
+ * Returns: none
+ */
+static inline void destOf(int rotation, int width, int height,
+                          int col, int row, int *i, int *j)
+{
+    switch (rotation) {
+    case 90:  *i = height - row - 1; *j = col;                break;
+    case 180: *i = width - col - 1;  *j = height - row - 1;   break;
+    case 270: *i = row;              *j = width - col - 1;    break;
+    default:  *i = col;              *j = row;                break;
+    }
+}
+
+/* Function: sourceOf
+ * Purpose: Applies the inverse rotation to one destination cell
+ * Arguments: The rotation, the source width and height, the
+ *            destination column and row, pointers receiving the
+ *            source column and row
+ * Returns: none
+ */
+static inline void sourceOf(int rotation, int width, int height,
+                            int i, int j, int *col, int *row)
+{
+    switch (rotation) {
+    case 90:  *col = j;             *row = height - i - 1;  break;
+    case 180: *col = width - i - 1; *row = height - j - 1;  break;
+    case 270: *col = width - j - 1; *row = i;               break;
+    default:  *col = i;             *row = j;               break;
+    }
+}
+
+/* Function: Transform_dims
+ * Purpose: Computes the dimensions of an image after rotation
+ * Arguments: The rotation, the source width and height, and pointers
+ *            to receive the rotated width and height
+ * Returns: none
+ */
+void Transform_dims(int rotation, int width, int height,
+                    int *newWidth, int *newHeight)
+{
+    assert(newWidth != NULL && newHeight != NULL);
+    if (rotation == 90 || rotation == 270) {
+        *newWidth = height;
+        *newHeight = width;
+    } else {
+        *newWidth = width;
+        *newHeight = height;
+    }
+}
+
+/* Function: Transform_newDest
+ * Purpose: Creates an empty array that is populated with the
+ *          image post rotation. Blocked arrays get the source's
+ *          blocksize, so that a rotated block covers whole blocks.
+ * Arguments: The methods for the source representation,
+ *            the source array,
+ *            the rotation amount
+ * Returns: A new A2 object of the rotated shape
+ */
+A2 Transform_newDest(A2Methods_T methods, A2 src, int rotation)
+{
+    assert(methods != NULL);
+    assert(src != NULL);
+    int width, height;
+    Transform_dims(rotation, methods->width(src), methods->height(src),
+                   &width, &height);
+    return methods->new_with_blocksize(width, height, methods->size(src),
+                                       methods->blocksize(src));
+}
+
+/* Function: Transform_chooseOrder
+ * Purpose: Picks scatter or gather for a transform. A miss on a write
+ *          costs more than a miss on a read (the line must be fetched
+ *          for ownership and later written back), so the side that is
+ *          walked in storage order should be the destination whenever
+ *          only one side can be:
+ *            - 0 and 180 degrees keep rows as rows, so both sides are
+ *              walked in the same order and scatter is as good as any
+ *            - 90 and 270 turn rows into columns; walking a plain
+ *              array with its default map (by rows, or by columns for
+ *              column-major storage) makes the walked side sequential,
+ *              so walk the destination (gather), while the other map
+ *              leaves the other side sequential, so walk the source
+ *              (scatter)
+ *            - block-major keeps both sides within a block, so scatter
+ *          Streaming is never chosen: it measures slower than both.
+ * Arguments: The methods of both arrays, the mapping function, the
+ *            rotation amount
+ * Returns: TRANSFORM_SCATTER or TRANSFORM_GATHER
+ */
+Transform_order Transform_chooseOrder(A2Methods_T methods,
+                                      A2Methods_mapfun *map, int rotation)
+{
+    assert(methods != NULL && map != NULL);
+    if ((rotation == 90 || rotation == 270) &&
+        methods->map_block_major == NULL && map == methods->map_default) {
+        return TRANSFORM_GATHER;
+    }
+    return TRANSFORM_SCATTER;
+}
+
+/* Function: Transform_rotate
+ * Purpose: Stores every pixel of src at its rotated position in dest
+ * Arguments: The methods shared by both arrays,
+ *            the mapping function used to traverse src (scatter) or
+ *            dest (gather),
+ *            the source array,
+ *            a destination array shaped by Transform_newDest,
+ *            the rotation amount (0, 90, 180 or 270),
+ *            the traversal order, or TRANSFORM_AUTO to choose one;
+ *            TRANSFORM_STREAM falls back to the automatic choice for
+ *            representations the streaming kernels do not know
+ * Returns: none
+ */
+void Transform_rotate(A2Methods_T methods, A2Methods_mapfun *map,
+                      A2 src, A2 dest, int rotation, Transform_order order)
+{
+    assert(methods != NULL && map != NULL);
+    assert(src != NULL && dest != NULL);
+    assert(rotation == 0 || rotation == 90 ||
+           rotation == 180 || rotation == 270);
+
+    if (order == TRANSFORM_STREAM && !StreamRot_supported(methods)) {
+        order = TRANSFORM_AUTO;
+    }
+    if (order == TRANSFORM_AUTO) {
+        order = Transform_chooseOrder(methods, map, rotation);
+    }
+    if (order == TRANSFORM_STREAM) {
+        StreamRot_rotate(methods, src, dest, rotation);
+        return;
+    }
+
+    struct transformedArr closure;
+    closure.methods = methods;
+    closure.rotation = rotation;
+    closure.width = methods->width(src);
+    closure.height = methods->height(src);
+
+    if (specRotate(methods, map, &closure, src, dest, order)) {
+        return;
+    }
+    if (order == TRANSFORM_GATHER) {
+        closure.resArr = src;
+        map(dest, GATHER[rotation / 90], &closure);
+    } else {
+        closure.resArr = dest;
+        map(src, SCATTER[rotation / 90], &closure);
+    }
+}
+
+/* Function: Transform_rotateParallel
+ * Purpose: Rotates an image on every worker of a pool. The destination
+ *          is split into bands of rows or into blocks (see
+ *          a2parallel.h) and each is gathered from the source, so the
+ *          workers write disjoint cells and share nothing else.
+ * Arguments: The pool, the methods of both arrays, the source, a
+ *            destination of the rotated shape, and the rotation
+ * Returns: none
+ */
+void Transform_rotateParallel(WorkPool_T pool, A2Methods_T methods,
+                              A2 src, A2 dest, int rotation)
+{
+    assert(pool != NULL && methods != NULL);
+    assert(src != NULL && dest != NULL);
+    assert(rotation == 0 || rotation == 90 ||
+           rotation == 180 || rotation == 270);
+
+    struct transformedArr closure;
+    closure.methods = methods;
+    closure.resArr = src;
+    closure.rotation = rotation;
+    closure.width = methods->width(src);
+    closure.height = methods->height(src);
+    A2Parallel_map(pool, methods, dest, GATHER[rotation / 90], &closure, 0,
+                   NULL);
+}
+
+/*
+ * Generic kernels, for arrays of any table. There is one scatter and
+ * one gather apply function per rotation, so destOf and sourceOf fold
+ * to straight index arithmetic; cells are reached with 'at' through
+ * the closure's methods.
+ *
+ * scatter_R stores the source pixel at (col, row) at its rotated
+ * position in the closure's resArr (the destination); gather_R fetches
+ * the pixel landing at destination (col, row) from resArr (the source)
+ * through the inverse rotation.
+ */
+
+#define GENERIC_APPLY(R)                                                    \
+static void scatter_##R(int col, int row, A2 array, void *elem, void *cl)   \
+{                                                                           \
+    (void)array;                                                            \
+    struct transformedArr *t = cl;                                          \
+    int i, j;                                                               \
+    destOf(R, t->width, t->height, col, row, &i, &j);                       \
+    *(Pnm_rgb)t->methods->at(t->resArr, i, j) = *(Pnm_rgb)elem;             \
+}                                                                           \
+static void gather_##R(int col, int row, A2 array, void *elem, void *cl)    \
+{                                                                           \
+    (void)array;                                                            \
+    struct transformedArr *t = cl;                                          \
+    int srcCol, srcRow;                                                     \
+    sourceOf(R, t->width, t->height, col, row, &srcCol, &srcRow);           \
+    *(Pnm_rgb)elem = *(Pnm_rgb)t->methods->at(t->resArr, srcCol, srcRow);   \
+}
+
+GENERIC_APPLY(0)
+GENERIC_APPLY(90)
+GENERIC_APPLY(180)
+GENERIC_APPLY(270)
+
+/* by rotation / 90 */
+static A2Methods_applyfun *const SCATTER[4] = {
+    scatter_0, scatter_90, scatter_180, scatter_270
+};
+static A2Methods_applyfun *const GATHER[4] = {
+    gather_0, gather_90, gather_180, gather_270
+};
+
+/*
+ * Element-size specializations. For arrays made by the a2spec tables
+ * there is a kernel for every combination of layout, traversal (scatter
+ * or gather, and for plain arrays by rows or by columns), cell size and
+ * rotation. In each, the cell access and copy are inlined with the cell
+ * size and the rotation constants, and the apply function is passed by
+ * name to an inline map of uarray2spec.h, so the kernel compiles to a
+ * plain loop with no call through a function pointer and no branch on
+ * the rotation per pixel. specRotate picks one from SPEC_KERNELS once
+ * per transform.
+ */
+
+typedef void spec_kernel(UArray2s_T walked, struct transformedArr *t);
+
+/* Struct spec_kernels
+* The kernels for one cell size and rotation; plain arrays are walked by
+* rows ([0]) or by columns ([1]), blocked ones block by block
+*/
+struct spec_kernels {
+    spec_kernel *plainScatter[2];
+    spec_kernel *plainGather[2];
+    spec_kernel *blockedScatter;
+    spec_kernel *blockedGather;
+};
+
+#define SPEC_APPLY(LAYOUT, N, AT, R)                                        \
+static void scatter_##LAYOUT##_##N##_##R(int col, int row,                  \
+                                         UArray2s_T array, void *elem,      \
+                                         void *cl)                          \
+{                                                                           \
+    (void)array;                                                            \
+    struct transformedArr *t = cl;                                          \
+    int i, j;                                                               \
+    destOf(R, t->width, t->height, col, row, &i, &j);                       \
+    UArray2s_copy_##N(AT##N(t->resArr, i, j), elem);                        \
+}                                                                           \
+static void gather_##LAYOUT##_##N##_##R(int col, int row,                   \
+                                        UArray2s_T array, void *elem,       \
+                                        void *cl)                           \
+{                                                                           \
+    (void)array;                                                            \
+    struct transformedArr *t = cl;                                          \
+    int srcCol, srcRow;                                                     \
+    sourceOf(R, t->width, t->height, col, row, &srcCol, &srcRow);           \
+    UArray2s_copy_##N(elem, AT##N(t->resArr, srcCol, srcRow));              \
+}
+
+#define SPEC_WALK(NAME, MAP, APPLY)                                         \
+static void NAME(UArray2s_T walked, struct transformedArr *t)               \
+{                                                                           \
+    MAP(walked, APPLY, t);                                                  \
+}
+
+#define SPEC_ORIENTED(N, R)                                                 \
+SPEC_APPLY(plain, N, UArray2s_at_, R)                                       \
+SPEC_APPLY(blocked, N, UArray2s_blocked_at_, R)                             \
+SPEC_WALK(scatterRows_##N##_##R, UArray2s_map_row_major_##N,                \
+          scatter_plain_##N##_##R)                                          \
+SPEC_WALK(scatterCols_##N##_##R, UArray2s_map_col_major_##N,                \
+          scatter_plain_##N##_##R)                                          \
+SPEC_WALK(gatherRows_##N##_##R, UArray2s_map_row_major_##N,                 \
+          gather_plain_##N##_##R)                                           \
+SPEC_WALK(gatherCols_##N##_##R, UArray2s_map_col_major_##N,                 \
+          gather_plain_##N##_##R)                                           \
+SPEC_WALK(scatterBlocks_##N##_##R, UArray2s_map_block_major_##N,            \
+          scatter_blocked_##N##_##R)                                        \
+SPEC_WALK(gatherBlocks_##N##_##R, UArray2s_map_block_major_##N,             \
+          gather_blocked_##N##_##R)
+
+#define SPEC_SIZE(N)                                                        \
+SPEC_ORIENTED(N, 0)                                                         \
+SPEC_ORIENTED(N, 90)                                                        \
+SPEC_ORIENTED(N, 180)                                                       \
+SPEC_ORIENTED(N, 270)
+
+SPEC_SIZE(1)
+SPEC_SIZE(2)
+SPEC_SIZE(4)
+SPEC_SIZE(8)
+SPEC_SIZE(12)
+
+#define SPEC_SET(N, R)                                                      \
+    { { scatterRows_##N##_##R, scatterCols_##N##_##R },                     \
+      { gatherRows_##N##_##R, gatherCols_##N##_##R },                       \
+      scatterBlocks_##N##_##R, gatherBlocks_##N##_##R }
+
+#define SPEC_SETS(N)                                                        \
+    { SPEC_SET(N, 0), SPEC_SET(N, 90), SPEC_SET(N, 180), SPEC_SET(N, 270) }
+
+/* by cell size, as in SPEC_SIZES, and rotation / 90 */
+static const int SPEC_SIZES[] = { 1, 2, 4, 8, 12 };
+static const struct spec_kernels SPEC_KERNELS[][4] = {
+    SPEC_SETS(1), SPEC_SETS(2), SPEC_SETS(4), SPEC_SETS(8), SPEC_SETS(12)
+};
+#define NSPEC_SIZES ((int)(sizeof(SPEC_SIZES) / sizeof(SPEC_SIZES[0])))
+
+/* Function: specRotate
+ * Purpose: Runs a scatter or gather through the specialized kernels
+ *          when the arrays come from an a2spec table
+ * Arguments: The methods and mapping function, the closure with the
+ *            rotation and source dimensions filled in, the source and
+ *            destination, the order (scatter or gather)
+ * Returns: 1 if the transform was done, 0 if the methods are not
+ *          specialized and the generic path must be used
+ */
+static int specRotate(A2Methods_T methods, A2Methods_mapfun *map,
+                      struct transformedArr *closure, A2 src, A2 dest,
+                      Transform_order order)
+{
+    int size = A2Spec_size(methods);
+    if (size == 0) {
+        return 0;
+    }
+    int k = 0;
+    while (k < NSPEC_SIZES && SPEC_SIZES[k] != size) {
+        k++;
+    }
+    assert(k < NSPEC_SIZES);
+    const struct spec_kernels *set = &SPEC_KERNELS[k][closure->rotation / 90];
+    int gather = order == TRANSFORM_GATHER;
+    int byCols = map == methods->map_col_major;
+
+    spec_kernel *kernel;
+    if (A2Spec_isBlocked(methods)) {
+        kernel = gather ? set->blockedGather : set->blockedScatter;
+    } else {
+        kernel = gather ? set->plainGather[byCols]
+                        : set->plainScatter[byCols];
+    }
+    closure->resArr = gather ? src : dest;
+    kernel(gather ? dest : src, closure);
+    return 1;
+}
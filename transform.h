@@ -0,0 +1,52 @@
+/*
+ *                              transform
+ *
+ *   Purpose:
+ *
+ *     Interface to the image orientation engine shared by ppmtrans
+ *     and its batch mode. A transform reads every pixel of a source
+ *     A2 array and stores it at its rotated position in a destination
+ *     array of the appropriate shape.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef TRANSFORM_INCLUDED
+#define TRANSFORM_INCLUDED
+
+#include "a2methods.h"
+#include "workpool.h"
+
+/* Which side of a transform the mapping function walks. A scatter
+ * walks the source and writes each pixel to its rotated position; a
+ * gather walks the destination and reads each pixel through the
+ * inverse rotation. A stream ignores the mapping function: it walks
+ * the destination in storage order with non-temporal stores and
+ * source prefetching (see streamrot.h); it is never chosen for
+ * TRANSFORM_AUTO, which picks whichever of scatter and gather keeps the
+ * writes in storage order.
+ */
+typedef enum Transform_order {
+    TRANSFORM_AUTO = 0,
+    TRANSFORM_SCATTER,
+    TRANSFORM_GATHER,
+    TRANSFORM_STREAM
+} Transform_order;
+
+extern void Transform_dims(int rotation, int width, int height,
+                           int *newWidth, int *newHeight);
+extern A2Methods_UArray2 Transform_newDest(A2Methods_T methods,
+                                           A2Methods_UArray2 src,
+                                           int rotation);
+extern Transform_order Transform_chooseOrder(A2Methods_T methods,
+                                            A2Methods_mapfun *map,
+                                            int rotation);
+extern void Transform_rotate(A2Methods_T methods, A2Methods_mapfun *map,
+                             A2Methods_UArray2 src, A2Methods_UArray2 dest,
+                             int rotation, Transform_order order);
+extern void Transform_rotateParallel(WorkPool_T pool, A2Methods_T methods,
+                                     A2Methods_UArray2 src,
+                                     A2Methods_UArray2 dest, int rotation);
+
+#endif
@@ -1,64 +1,122 @@
+#include <limits.h>
 #include "assert.h"
 #include "mem.h"
 #include "uarray.h"
 #include "uarray2.h"
+#include "pitch.h"
 
 #define T UArray2_T
 
 /* 
  * Element (i, j) in the world of ideas maps to
- * rows[j][i] where the square brackets stand for access
- * to a Hanson UArray_T
+ * cells[j * pitch + i] in a row-major array and to
+ * cells[i * pitch + j] in a column-major one, where the square
+ * brackets stand for access to a Hanson UArray_T. The lines (rows, or
+ * columns) are 'pitch' cells apart in one UArray_T, and the cells past
+ * the end of a line are padding that keeps the lines from aliasing in
+ * the cache (pitch.h).
  */
 struct T {
         int width, height;
         int size;
-        UArray_T rows; /* UArray_T of 'height' UArray_Ts,
-                          each of length 'width' and size 'size' */
+        int colMajor;  /* lines are columns rather than rows */
+        int pitch;     /* cells from the start of one line to the next */
+        UArray_T cells; /* lineCount * pitch cells of size 'size' */
+        char *elems;   /* first cell, so the unchecked functions need
+                          not go through UArray_at */
 };
-static inline UArray_T row(T a, int j)
+static inline int lineCount(T a)
 {
-        UArray_T *prow = UArray_at(a->rows, j);   /* Ramsey idiom */
-        return *prow;
+        return a->colMajor ? a->width : a->height;
 }
-static int is_ok(T a)
+static inline int lineLength(T a)
 {
-        return a && UArray_length(a->rows) == a->height &&
-               UArray_size(a->rows) == sizeof(UArray_T) &&
-               (a->height == 0 || (UArray_length(row(a, 0)) == a->width
-                                   && UArray_size  (row(a, 0)) == a->size));
+        return a->colMajor ? a->height : a->width;
 }
-T UArray2_new(int width, int height, int size)
+static inline int is_ok(T a)  /* inline: unused when NDEBUG */
+{
+        return a && a->pitch >= lineLength(a) &&
+               UArray_length(a->cells) == (long)lineCount(a) * a->pitch &&
+               UArray_size(a->cells) == a->size;
+}
+static T newArray(int width, int height, int size, int colMajor, int pitch)
 {
-        int i;  /* interates over row number */
         T array;
         NEW(array);
-        array->width  = width;
-        array->height = height;
-        array->size   = size;
-        array->rows   = UArray_new(height, sizeof(UArray_T));
-        for (i = 0; i < height; i++) {
-                UArray_T *rowp = UArray_at(array->rows, i);
-                *rowp = UArray_new(width, size);
-        }
+        array->width    = width;
+        array->height   = height;
+        array->size     = size;
+        array->colMajor = colMajor;
+        array->pitch    = pitch;
+        assert(size > 0 && pitch >= lineLength(array));
+        /* one UArray holds every line: its cells, and their bytes, must
+           fit in an int */
+        long cells = (long)lineCount(array) * pitch;
+        assert(cells <= INT_MAX / size);
+        array->cells = UArray_new((int)cells, size);
+        array->elems = UArray_length(array->cells) > 0 ?
+                       UArray_at(array->cells, 0) : NULL;
         assert(is_ok(array));
         return array;
 }
+T UArray2_new(int width, int height, int size)
+{
+        return newArray(width, height, size, 0, Pitch_pad(width, size));
+}
+/*
+ * Rows are 'pitch' cells apart, however wide the array is; for callers
+ * that must control the layout, such as benchmarks of the padding
+ */
+T UArray2_new_with_pitch(int width, int height, int size, int pitch)
+{
+        return newArray(width, height, size, 0, pitch);
+}
+/*
+ * Column i is a single run of cells, so the array is walked in
+ * storage order by UArray2_map_col_major
+ */
+T UArray2_new_col_major(int width, int height, int size)
+{
+        return newArray(width, height, size, 1, Pitch_pad(height, size));
+}
 void UArray2_free(T *array2)
 {
-        int i;
         assert(array2 && *array2);
-        for (i = 0; i < (*array2)->height; i++) {
-                UArray_T p = row(*array2, i);
-                UArray_free(&p);
-        }
-        UArray_free(&(*array2)->rows);
+        UArray_free(&(*array2)->cells);
         FREE(*array2);
 }
 void *UArray2_at(T array2, int i, int j)
 {
         assert(array2);
-        return UArray_at(row(array2, j), i);
+        assert(i >= 0 && i < array2->width && j >= 0 && j < array2->height);
+        if (array2->colMajor) {
+                return UArray_at(array2->cells, i * array2->pitch + j);
+        }
+        return UArray_at(array2->cells, j * array2->pitch + i);
+}
+/* 
+ * Row j is a single run of cells, so its 'width' elements are
+ * contiguous; callers may walk them with pointer arithmetic
+ */
+void *UArray2_row(T array2, int j)
+{
+        assert(array2 && array2->width > 0 && !array2->colMajor);
+        assert(j >= 0 && j < array2->height);
+        return array2->elems + (long)j * array2->pitch * array2->size;
+}
+/*
+ * The unchecked functions trust their caller: no null check, no
+ * bounds check, and no trip through Hanson's (checked) UArray_at.
+ * They exist for hot loops whose indices are correct by construction;
+ * everything else should use the checked functions above.
+ */
+void *UArray2_at_unchecked(T array2, int i, int j)
+{
+        if (array2->colMajor) {
+                return array2->elems +
+                       ((long)i * array2->pitch + j) * array2->size;
+        }
+        return array2->elems + ((long)j * array2->pitch + i) * array2->size;
 }
 int UArray2_height(T array2)
 {
@@ -85,11 +143,20 @@ void UArray2_map_row_major(T array2,
         assert(array2);
         int h = array2->height;  /* keeping height and width in registers */
         int w = array2->width;   /* avoids extra memory traffic           */
+        int pitch = array2->pitch;
+        if (array2->colMajor) {
+                for (int j = 0; j < h; j++)
+                        for (int i = 0; i < w; i++)
+                                apply(i, j, array2,
+                                      UArray_at(array2->cells,
+                                                i * pitch + j), cl);
+                return;
+        }
         for (int j = 0; j < h; j++) {
-                /* don't want row/UArray_at in inner loop */
-                UArray_T thisrow = row(array2, j); 
+                int row = j * pitch;  /* no multiply in the inner loop */
                 for (int i = 0; i < w; i++)
-                        apply(i, j, array2, UArray_at(thisrow, i), cl);
+                        apply(i, j, array2,
+                              UArray_at(array2->cells, row + i), cl);
         }
 }
 void UArray2_map_col_major(T array2, 
@@ -100,7 +167,69 @@ void UArray2_map_col_major(T array2,
         assert(array2);
         int h = array2->height;  /* keeping height and width in registers */
         int w = array2->width;   /* avoids extra memory traffic           */
+        int pitch = array2->pitch;
+        if (array2->colMajor) {
+                for (int i = 0; i < w; i++) {
+                        int col = i * pitch;
+                        for (int j = 0; j < h; j++)
+                                apply(i, j, array2,
+                                      UArray_at(array2->cells, col + j), cl);
+                }
+                return;
+        }
         for (int i = 0; i < w; i++)
                 for (int j = 0; j < h; j++)
-                        apply(i, j, array2, UArray_at(row(array2, j), i), cl);
-}
\ No newline at end of file
+                        apply(i, j, array2,
+                              UArray_at(array2->cells, j * pitch + i), cl);
+}
+/*
+ * In the unchecked maps the walk along a line steps by the element
+ * size and the walk across lines steps by the pitch, whichever way
+ * the lines run
+ */
+void UArray2_map_row_major_unchecked(T array2, 
+                                     void apply(int i, int j, T array2, 
+                                                void *elem, void *cl), 
+                                     void *cl)
+{
+        int h = array2->height;
+        int w = array2->width;
+        int size = array2->size;
+        long pitch = (long)array2->pitch * size;
+        if (array2->colMajor) {
+                for (int j = 0; j < h; j++) {
+                        char *p = array2->elems + (long)j * size;
+                        for (int i = 0; i < w; i++, p += pitch)
+                                apply(i, j, array2, p, cl);
+                }
+                return;
+        }
+        for (int j = 0; j < h; j++) {
+                char *p = array2->elems + j * pitch;
+                for (int i = 0; i < w; i++, p += size)
+                        apply(i, j, array2, p, cl);
+        }
+}
+void UArray2_map_col_major_unchecked(T array2, 
+                                     void apply(int i, int j, T array2, 
+                                                void *elem, void *cl), 
+                                     void *cl)
+{
+        int h = array2->height;
+        int w = array2->width;
+        int size = array2->size;
+        long pitch = (long)array2->pitch * size;
+        if (array2->colMajor) {
+                for (int i = 0; i < w; i++) {
+                        char *p = array2->elems + i * pitch;
+                        for (int j = 0; j < h; j++, p += size)
+                                apply(i, j, array2, p, cl);
+                }
+                return;
+        }
+        for (int i = 0; i < w; i++) {
+                char *p = array2->elems + (long)i * size;
+                for (int j = 0; j < h; j++, p += pitch)
+                        apply(i, j, array2, p, cl);
+        }
+}
@@ -6,13 +6,26 @@ typedef struct T *T;
 typedef void UArray2_applyfun(int i, int j, T array2, void *elem, void *cl);
 typedef void UArray2_mapfun(T array2, UArray2_applyfun apply, void *cl);
 
+/* rows are padded against cache-set aliasing when that helps */
 extern T     UArray2_new   (int width, int height, int size);
+/* rows are 'pitch' cells apart (pitch >= width) */
+extern T     UArray2_new_with_pitch(int width, int height, int size,
+                                    int pitch);
+/* stores columns rather than rows; every other function is the same */
+extern T     UArray2_new_col_major(int width, int height, int size);
 extern void  UArray2_free  (T *array2);
 extern int   UArray2_width (T array2);
 extern int   UArray2_height(T array2);
 extern int   UArray2_size  (T array2);
 extern void *UArray2_at    (T array2, int i, int j);
+extern void *UArray2_row   (T array2, int j);  /* row-major arrays only */
 extern void  UArray2_map_row_major(T array2, UArray2_applyfun apply, void *cl);
 extern void  UArray2_map_col_major(T array2, UArray2_applyfun apply, void *cl);
+/* no null or bounds checks: for hot loops with trusted indices */
+extern void *UArray2_at_unchecked(T array2, int i, int j);
+extern void  UArray2_map_row_major_unchecked(T array2, UArray2_applyfun apply,
+                                             void *cl);
+extern void  UArray2_map_col_major_unchecked(T array2, UArray2_applyfun apply,
+                                             void *cl);
 #undef T
 #endif
\ No newline at end of file
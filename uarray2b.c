@@ -11,47 +11,66 @@
  *   
 */
 
-#include <uarray2.h>
 #include <uarray.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
 #include <mem.h>
 #include <assert.h>
 #include <math.h>
 #include "uarray2b.h"
+#include "pitch.h"
 
 #define T UArray2b_T
 
 const int MAX_BLOCKSIZE = 65536;
 
 struct T {
-    UArray2_T array;
+    UArray_T cells;  /* every block, row of blocks by row of blocks */
     int blocksize;
     int width;
     int height;
+    int size;
+    int blocksWide;  /* blocks in each row of blocks */
+    int blocksHigh;  /* rows of blocks */
+    int blockStride; /* cells from the start of one block to the next */
+    char *elems;     /* first cell, for the unchecked functions */
 };
 
+/* Function: blockStart
+ * Purpose: Finds the index of the first cell of a block
+ * Arguments: The 2b array, the column and row of the block
+ * Returns: An index into the cells
+ */
+static inline int blockStart(T array2b, int blockCol, int blockRow)
+{
+    return (blockRow * array2b->blocksWide + blockCol) *
+           array2b->blockStride;
+}
+
 
 /********************************************************************
  *               UArray2B Implementation Functions                  *
  ********************************************************************/
 
-/* Function: UArray2b_new
+/* Function: UArray2b_new_with_stride
  * Purpose: Creates a new instance of a blocked 2D array with a given
-            block size
- * Representation: The blocked representation was executed using a
- *                 UArray2 as the 2D array. Each index of the Uarray2
- *                 stores a block. Each block was implemented using a
- *                 Uarray 1D array, so each index of the Uarray is
- *                 a cells of the block.
- * Arguments: The width, height, element size, and blocksize
- *
+            block size and distance between blocks
+ * Representation: The blocks are stored one after another, row of
+ *                 blocks by row of blocks, in a single Hanson UArray.
+ *                 Each block holds its blocksize * blocksize cells row
+ *                 by row and is followed by blockStride - blocksize *
+ *                 blocksize cells of padding.
+ * Arguments: The width, height, element size, blocksize, and the cells
+ *            from the start of one block to the start of the next
  * Returns: A new UArray2B
  */
-extern T UArray2b_new (int width, int height, int size, int blocksize)
+extern T UArray2b_new_with_stride(int width, int height, int size,
+                                  int blocksize, int blockStride)
 {
     assert(blocksize > 0 && size >0);
     assert(height > 0 && width > 0);
+    assert(blockStride >= blocksize * blocksize);
 
     T uarray2b;
     NEW(uarray2b);
@@ -60,28 +79,40 @@ extern T UArray2b_new (int width, int height, int size, int blocksize)
     uarray2b->width = width;
     uarray2b->height = height;
     uarray2b->blocksize = blocksize;
+    uarray2b->size = size;
+    uarray2b->blockStride = blockStride;
     
-    int num_blocks_wide = (width / blocksize);
-    num_blocks_wide += (num_blocks_wide > 0) ? 1 : 0;
-
-    int num_blocks_high = (height / blocksize);
-    num_blocks_high += (num_blocks_high > 0) ? 1 : 0;
+    /* round up so a partial block covers the ragged right/bottom edge */
+    uarray2b->blocksWide = (width + blocksize - 1) / blocksize;
+    uarray2b->blocksHigh = (height + blocksize - 1) / blocksize;
 
-    uarray2b->array = UArray2_new(num_blocks_wide,
-                                    num_blocks_high,
-                                    sizeof(UArray_T));
-
-    UArray_T *blockArrSpot;
-    for (int row = 0; row < num_blocks_high; row++) {
-        for (int col = 0; col < num_blocks_wide; col++) {
-            blockArrSpot = UArray2_at(uarray2b->array, col, row);
-            *blockArrSpot = UArray_new(blocksize * blocksize, size);
-        }
-    }
+    /* one UArray holds every block: its cells, and their bytes, must
+       fit in an int */
+    long cells = (long)uarray2b->blocksWide * uarray2b->blocksHigh *
+                 blockStride;
+    assert(cells <= INT_MAX / size);
+    uarray2b->cells = UArray_new((int)cells, size);
+    uarray2b->elems = UArray_at(uarray2b->cells, 0);
 
     return uarray2b;
 }
 
+/* Function: UArray2b_new
+ * Purpose: Creates a new instance of a blocked 2D array with a given
+            block size. Blocks that are a multiple of four cache lines
+            are padded so that the same cell of successive blocks does
+            not fall in the same cache set (pitch.h).
+ * Arguments: The width, height, element size, and blocksize
+ *
+ * Returns: A new UArray2B
+ */
+extern T UArray2b_new (int width, int height, int size, int blocksize)
+{
+    assert(blocksize > 0 && size >0);
+    return UArray2b_new_with_stride(width, height, size, blocksize,
+                                    Pitch_pad(blocksize * blocksize, size));
+}
+
 /* Function: UArray2b_new_64K_block
  * Purpose: Creates a new instance of a blocked 2D array, the block
             size allocated is the maximum based on element size and
@@ -111,25 +142,15 @@ extern T UArray2b_new_64K_block(int width, int height, int size)
 }
 
 /* Function: UArray2b_free
- * Purpose: Frees memory allocated for the UArray2b, as well as at every
-            block and at every cell inside of the block
+ * Purpose: Frees memory allocated for the UArray2b, as well as the
+            cells of every block
  * Arguments: A pointer to the UArray2b to free
  * Returns: none
  */
 extern void UArray2b_free (T *array2b)
 {
-    assert(*array2b != NULL && array2b != NULL);
-    UArray2_T arr = (*array2b)->array;
-    int width = UArray2_width(arr);
-    int height = UArray2_height(arr);
-    UArray_T *blockArrSpot;
-    for (int row = 0; row < height; row++) {
-        for (int col = 0; col < width; col++) {
-            blockArrSpot = UArray2_at((*array2b)->array, col, row);
-            UArray_free(blockArrSpot);
-        }
-    }
-    UArray2_free(&(*array2b)->array);
+    assert(array2b != NULL && *array2b != NULL);
+    UArray_free(&(*array2b)->cells);
     free(*array2b);
 }
 
@@ -163,7 +184,7 @@ extern int UArray2b_height (T array2b)
 extern int UArray2b_size (T array2b)
 {
     assert(array2b != NULL);
-    return UArray2_size(array2b->array);
+    return array2b->size;
 }
 
 /* Function: UArray2b_blocksize 
@@ -185,12 +206,44 @@ extern int UArray2b_blocksize(T array2b)
 extern void *UArray2b_at(T array2b, int col, int row)
 {
     assert(array2b != NULL);
-    assert(col < array2b->width && row < array2b->height);
+    assert(col >= 0 && col < array2b->width);
+    assert(row >= 0 && row < array2b->height);
+    int blocksize = array2b->blocksize;
+    return UArray_at(array2b->cells,
+                     blockStart(array2b, col / blocksize, row / blocksize) +
+                     blocksize * (row % blocksize) + (col % blocksize));
+}
+
+/* Function: UArray2b_block
+ * Purpose: Gets the storage of one block, for callers that copy whole
+ *          blocks or rows of a block at a time
+ * Arguments: The 2b array, the column and row of the block in the
+ *            grid of blocks
+ * Returns: A pointer to the first of blocksize * blocksize contiguous
+ *          cells, stored row by row
+*/
+extern void *UArray2b_block(T array2b, int blockCol, int blockRow)
+{
+    assert(array2b != NULL);
+    assert(blockCol >= 0 && blockCol < array2b->blocksWide);
+    assert(blockRow >= 0 && blockRow < array2b->blocksHigh);
+    return UArray_at(array2b->cells,
+                     blockStart(array2b, blockCol, blockRow));
+}
+
+/* Function: UArray2b_at_unchecked
+ * Purpose: Gets the element at a specified col and row without any
+ *          null or bounds checks, for hot loops whose indices are
+ *          correct by construction
+ * Arguments: The col, row, and 2b array to look in
+ * Returns: A void pointer to the location of the elem in col, row
+*/
+extern void *UArray2b_at_unchecked(T array2b, int col, int row)
+{
     int blocksize = array2b->blocksize;
-    UArray_T *currBlock = UArray2_at(array2b->array, col / blocksize,
-                                          row / blocksize);
-    return UArray_at(*currBlock, blocksize * (row % blocksize) + 
-                                        (col % blocksize));
+    long cell = blockStart(array2b, col / blocksize, row / blocksize) +
+                blocksize * (row % blocksize) + (col % blocksize);
+    return array2b->elems + cell * array2b->size;
 }
 
 /* Function: UArray2b_map
@@ -208,19 +261,16 @@ void *elem, void *cl),
 void *cl)
 {
     assert(array2b != NULL); 
-    int blockWidth = UArray2_width(array2b->array);
-    int blockHeight = UArray2_height(array2b->array);
+    int blockWidth = array2b->blocksWide;
+    int blockHeight = array2b->blocksHigh;
+    int cellsPerBlock = array2b->blocksize * array2b->blocksize;
     /* For every block high */
     for(int blockCol = 0; blockCol < blockWidth; blockCol++) {
         /* For every block wide */
         for (int blockRow = 0; blockRow < blockHeight; blockRow++) {
-            UArray_T *currBlockArr = UArray2_at(array2b->array,
-                                                blockCol,
-                                                blockRow);
+            int start = blockStart(array2b, blockCol, blockRow);
             /* for every element of the current block*/
-            for(int blockIdx = 0;
-                    blockIdx < UArray_length(*currBlockArr);
-                    blockIdx++) {
+            for(int blockIdx = 0; blockIdx < cellsPerBlock; blockIdx++) {
                 /* Check if out of bounds */
                 int row = (blockRow * array2b->blocksize) +
                             (blockIdx / array2b->blocksize);
@@ -233,10 +283,49 @@ void *cl)
                 }
 
                 apply(col, row, array2b, 
-                    UArray_at(*currBlockArr, blockIdx), cl);
+                    UArray_at(array2b->cells, start + blockIdx), cl);
 
             }
         }
     }
 
-}
\ No newline at end of file
+}
+
+/* Function: UArray2b_map_unchecked
+ * Purpose: The block-major mapping function without checks: walks
+ *          each block's storage directly instead of calling UArray_at
+ *          per cell. Blocks are visited in the same order as
+ *          UArray2b_map.
+ * Arguments: The 2b array,
+ *            The apply function to apply to each elem
+ *            A closure
+ * Returns: None
+*/
+extern void UArray2b_map_unchecked(T array2b,
+void apply(int col, int row, T array2b,
+void *elem, void *cl),
+void *cl)
+{
+    int bs = array2b->blocksize;
+    int size = array2b->size;
+    int blockWidth = array2b->blocksWide;
+    int blockHeight = array2b->blocksHigh;
+    for (int blockCol = 0; blockCol < blockWidth; blockCol++) {
+        for (int blockRow = 0; blockRow < blockHeight; blockRow++) {
+            char *block = array2b->elems +
+                          (long)blockStart(array2b, blockCol, blockRow) * size;
+            int col0 = blockCol * bs;
+            int row0 = blockRow * bs;
+            int cols = array2b->width - col0 < bs ? array2b->width - col0
+                                                   : bs;
+            int rows = array2b->height - row0 < bs ? array2b->height - row0
+                                                    : bs;
+            for (int r = 0; r < rows; r++) {
+                char *p = block + r * bs * size;
+                for (int c = 0; c < cols; c++, p += size) {
+                    apply(col0 + c, row0 + r, array2b, p, cl);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef UARRAY2B_INCLUDED
+#define UARRAY2B_INCLUDED
+#define T UArray2b_T
+typedef struct T *T;
+
+/* new blocked 2d array: blocksize = square root of # of cells in block;
+   blocks are padded against cache-set aliasing when that helps */
+extern T     UArray2b_new (int width, int height, int size, int blocksize);
+/* new blocked 2d array whose blocks start 'blockStride' cells apart
+   (blockStride >= blocksize * blocksize) */
+extern T     UArray2b_new_with_stride(int width, int height, int size,
+                                      int blocksize, int blockStride);
+/* new blocked 2d array: blocksize as large as possible provided
+   block occupies at most 64KB (if possible) */
+extern T     UArray2b_new_64K_block(int width, int height, int size);
+extern void  UArray2b_free     (T *array2b);
+extern int   UArray2b_width    (T array2b);
+extern int   UArray2b_height   (T array2b);
+extern int   UArray2b_size     (T array2b);
+extern int   UArray2b_blocksize(T array2b);
+/* return a pointer to the cell in the given column and row.
+   index out of range is a checked run-time error */
+extern void *UArray2b_at(T array2b, int column, int row);
+/* visits every cell in one block before moving to another block */
+extern void  UArray2b_map(T array2b,
+                          void apply(int col, int row, T array2b,
+                                     void *elem, void *cl),
+                          void *cl);
+/* start of the storage of one block: blocksize * blocksize cells in
+   row-major order, including cells past the ragged right/bottom edge */
+extern void *UArray2b_block(T array2b, int blockCol, int blockRow);
+/* no null or bounds checks: for hot loops with trusted indices */
+extern void *UArray2b_at_unchecked(T array2b, int column, int row);
+extern void  UArray2b_map_unchecked(T array2b,
+                                    void apply(int col, int row, T array2b,
+                                               void *elem, void *cl),
+                                    void *cl);
+#undef T
+#endif
@@ -0,0 +1,259 @@
+/*
+ *                              UArray2f
+ *
+ *   Purpose:
+ *
+ *     Implementation of the file-backed blocked array. Block k of the
+ *     array is at offset k * blockBytes of its file, which is created
+ *     sparse: a block never written reads back as zeros, like the
+ *     zeroed cells of a new UArray2b.
+ *
+ *     The cache is a BlockCache whose load and store functions read
+ *     and write a block at its offset with pread and pwrite.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "assert.h"
+#include "mem.h"
+#include "blockcache.h"
+#include "uarray2file.h"
+
+#define T UArray2f_T
+
+#define MAX_BLOCK_BYTES 65536
+#define DEFAULT_CACHE (64L << 20)
+
+static long cacheBytes = DEFAULT_CACHE;
+static const char *directory = NULL;    /* NULL for $TMPDIR or /tmp */
+
+struct T {
+    int width, height, size, blocksize;
+    int blocksWide, blocksHigh;
+    long blockBytes;
+    int fd;
+    BlockCache_T cache;
+};
+
+/* Function: UArray2f_configure
+ * Purpose: Sets the cache size and directory of arrays created later
+ * Arguments: The bytes of cache per array, at least one; the directory
+ *            for the files, or NULL to leave it unchanged
+ * Returns: none
+ */
+void UArray2f_configure(long bytes, const char *dir)
+{
+    assert(bytes > 0);
+    cacheBytes = bytes;
+    if (dir != NULL) {
+        directory = dir;
+    }
+}
+
+static void fail(const char *what)
+{
+    fprintf(stderr, "UArray2f: %s: %s\n", what, strerror(errno));
+    exit(EXIT_FAILURE);
+}
+
+/* Function: transfer
+ * Purpose: Moves one block between a frame and the file
+ * Arguments: The array, the block, the frame, whether to write it out
+ * Returns: none; exits if the file cannot be read or written
+ */
+static void transfer(T array, int block, char *bytes, int writing)
+{
+    off_t offset = (off_t)block * array->blockBytes;
+    long done = 0;
+    while (done < array->blockBytes) {
+        ssize_t n = writing
+            ? pwrite(array->fd, bytes + done, array->blockBytes - done,
+                     offset + done)
+            : pread(array->fd, bytes + done, array->blockBytes - done,
+                    offset + done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0) {
+            fail(writing ? "cannot write block" : "cannot read block");
+        } else if (n == 0) {
+            memset(bytes + done, 0, array->blockBytes - done);
+            break;      /* past the end of the file: never written */
+        }
+        done += n;
+    }
+}
+
+static void loadBlock(void *cl, int block, char *bytes)
+{
+    transfer(cl, block, bytes, 0);
+}
+
+static void storeBlock(void *cl, int block, char *bytes)
+{
+    transfer(cl, block, bytes, 1);
+}
+
+/* Function: openFile
+ * Purpose: Creates an unnamed temporary file of a given size
+ * Arguments: The size in bytes
+ * Returns: The file descriptor; exits on failure
+ */
+static int openFile(off_t bytes)
+{
+    const char *dir = directory;
+    if (dir == NULL) {
+        dir = getenv("TMPDIR");
+    }
+    if (dir == NULL || *dir == '\0') {
+        dir = "/tmp";
+    }
+    char *path = ALLOC(strlen(dir) + sizeof("/uarray2f-XXXXXX"));
+    sprintf(path, "%s/uarray2f-XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fail(path);
+    }
+    unlink(path);
+    FREE(path);
+    if (ftruncate(fd, bytes) != 0) {
+        fail("cannot size file");
+    }
+    return fd;
+}
+
+/* Function: UArray2f_new
+ * Purpose: Creates a file-backed blocked array, with a cache of the
+ *          size last given to UArray2f_configure
+ * Arguments: The width, height, element size and blocksize
+ * Returns: A new UArray2f with zeroed cells
+ */
+T UArray2f_new(int width, int height, int size, int blocksize)
+{
+    assert(width > 0 && height > 0 && size > 0 && blocksize > 0);
+    T array;
+    NEW(array);
+    array->width = width;
+    array->height = height;
+    array->size = size;
+    array->blocksize = blocksize;
+    array->blocksWide = (width + blocksize - 1) / blocksize;
+    array->blocksHigh = (height + blocksize - 1) / blocksize;
+    array->blockBytes = (long)blocksize * blocksize * size;
+
+    int blocks = array->blocksWide * array->blocksHigh;
+    long frames = cacheBytes / array->blockBytes;
+    frames = frames < UARRAY2F_MIN_FRAMES ? UARRAY2F_MIN_FRAMES : frames;
+    frames = frames > blocks ? blocks : frames;
+    array->cache = BlockCache_new(blocks, array->blockBytes, frames,
+                                  loadBlock, storeBlock, array);
+    array->fd = openFile((off_t)blocks * array->blockBytes);
+    return array;
+}
+
+/* Function: UArray2f_new_64K_block
+ * Purpose: Creates a file-backed array whose blocks are as large as
+ *          possible within 64KB
+ * Arguments: The width, height and element size
+ * Returns: A new UArray2f
+ */
+T UArray2f_new_64K_block(int width, int height, int size)
+{
+    assert(width > 0 && height > 0 && size > 0);
+    int blocksize = sqrt(MAX_BLOCK_BYTES / size);
+    blocksize = blocksize < 1 ? 1 : blocksize;
+    return UArray2f_new(width, height, size, blocksize);
+}
+
+void UArray2f_free(T *array2f)
+{
+    assert(array2f != NULL && *array2f != NULL);
+    T array = *array2f;
+    close(array->fd);
+    BlockCache_free(&array->cache);
+    FREE(*array2f);
+}
+
+int UArray2f_width(T array2f)
+{
+    assert(array2f != NULL);
+    return array2f->width;
+}
+
+int UArray2f_height(T array2f)
+{
+    assert(array2f != NULL);
+    return array2f->height;
+}
+
+int UArray2f_size(T array2f)
+{
+    assert(array2f != NULL);
+    return array2f->size;
+}
+
+int UArray2f_blocksize(T array2f)
+{
+    assert(array2f != NULL);
+    return array2f->blocksize;
+}
+
+/* Function: UArray2f_at
+ * Purpose: Finds a cell, loading its block if need be
+ * Arguments: The array, the column and row of the cell
+ * Returns: A pointer to the cell, valid as described in uarray2file.h
+ */
+void *UArray2f_at(T array2f, int column, int row)
+{
+    assert(array2f != NULL);
+    assert(column >= 0 && column < array2f->width);
+    assert(row >= 0 && row < array2f->height);
+    int bs = array2f->blocksize;
+    char *block = BlockCache_touch(array2f->cache,
+                                   (row / bs) * array2f->blocksWide +
+                                   column / bs);
+    return block + ((long)(row % bs) * bs + column % bs) * array2f->size;
+}
+
+/* Function: UArray2f_map
+ * Purpose: Calls apply on every cell, block by block, loading each block
+ *          once (again only if apply itself evicts it)
+ * Arguments: The array, the function, its closure
+ * Returns: none
+ */
+void UArray2f_map(T array2f,
+                  void apply(int col, int row, T array2f, void *elem,
+                             void *cl),
+                  void *cl)
+{
+    assert(array2f != NULL && apply != NULL);
+    int bs = array2f->blocksize;
+    long size = array2f->size;
+    for (int bj = 0; bj < array2f->blocksHigh; bj++) {
+        for (int bi = 0; bi < array2f->blocksWide; bi++) {
+            int b = bj * array2f->blocksWide + bi;
+            int i0 = bi * bs, j0 = bj * bs;
+            int iw = array2f->width - i0 < bs ? array2f->width - i0 : bs;
+            int jh = array2f->height - j0 < bs ? array2f->height - j0 : bs;
+            for (int r = 0; r < jh; r++) {
+                for (int c = 0; c < iw; c++) {
+                    char *block = BlockCache_touch(array2f->cache, b);
+                    apply(i0 + c, j0 + r, array2f,
+                          block + ((long)r * bs + c) * size, cl);
+                }
+            }
+        }
+    }
+}
+
+void UArray2f_traffic(T array2f, long *reads, long *writes)
+{
+    assert(array2f != NULL && reads != NULL && writes != NULL);
+    BlockCache_traffic(array2f->cache, reads, writes);
+}
@@ -0,0 +1,50 @@
+#ifndef UARRAY2FILE_INCLUDED
+#define UARRAY2FILE_INCLUDED
+
+/*
+ * UArray2f: a blocked 2D array whose blocks live in a temporary file,
+ * with the most recently used blocks cached in memory. Blocks are laid
+ * out as in UArray2b (blocksize * blocksize cells, row-major within a
+ * block, blocks row of blocks by row of blocks) and move between the
+ * file and the cache whole, with pread and pwrite. A block is written
+ * back when it is evicted, if it was touched since it was loaded.
+ *
+ * The cache holds at least UARRAY2F_MIN_FRAMES blocks. A pointer
+ * returned by 'at' stays valid until blocks of the same array other
+ * than its own have been touched UARRAY2F_MIN_FRAMES - 1 times; so
+ * pointers into two different cells of one array may be held at once,
+ * but not indefinitely. An array must not be used by two threads at
+ * once.
+ *
+ * The cache size and the directory of the files are taken from
+ * UArray2f_configure when an array is created; by default they are
+ * 64MB and $TMPDIR (or /tmp). The file is removed from the directory
+ * as soon as it is created.
+ */
+
+#define T UArray2f_T
+typedef struct T *T;
+
+#define UARRAY2F_MIN_FRAMES 4
+
+extern void  UArray2f_configure(long cacheBytes, const char *directory);
+extern T     UArray2f_new      (int width, int height, int size,
+                                int blocksize);
+/* blocksize as in UArray2b_new_64K_block */
+extern T     UArray2f_new_64K_block(int width, int height, int size);
+extern void  UArray2f_free     (T *array2f);
+extern int   UArray2f_width    (T array2f);
+extern int   UArray2f_height   (T array2f);
+extern int   UArray2f_size     (T array2f);
+extern int   UArray2f_blocksize(T array2f);
+extern void *UArray2f_at       (T array2f, int column, int row);
+/* visits every cell in one block before moving to another block */
+extern void  UArray2f_map      (T array2f,
+                                void apply(int col, int row, T array2f,
+                                           void *elem, void *cl),
+                                void *cl);
+/* blocks read from and written to the file so far */
+extern void  UArray2f_traffic  (T array2f, long *reads, long *writes);
+
+#undef T
+#endif
@@ -0,0 +1,98 @@
+/*
+ *                              UArray2s
+ *
+ *   Purpose:
+ *
+ *     Constructors for the flat-storage 2D arrays whose accessors are
+ *     specialized by element size in uarray2spec.h
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include "assert.h"
+#include "mem.h"
+#include "pitch.h"
+#include "uarray2spec.h"
+
+#define T UArray2s_T
+
+/* Function: newArray
+ * Purpose: Allocates an array and its zeroed cells
+ * Arguments: The width, height, element size and blocksize, the cells
+ *            from one row to the next of row-major storage and from one
+ *            block to the next of blocked storage
+ * Returns: A new UArray2s
+ */
+static T newArray(int width, int height, int size, int blocksize,
+                  int pitch, int blockStride)
+{
+    assert(width >= 0 && height >= 0);
+    assert(size > 0 && blocksize > 0);
+    assert(pitch >= width && blockStride >= blocksize * blocksize);
+    T array;
+    NEW(array);
+    array->width = width;
+    array->height = height;
+    array->size = size;
+    array->blocksize = blocksize;
+    array->blocksWide = (width + blocksize - 1) / blocksize;
+    array->blocksHigh = (height + blocksize - 1) / blocksize;
+    array->pitch = pitch;
+    array->blockStride = blockStride;
+
+    long cells = blocksize == 1 ? (long)pitch * height
+                                : (long)array->blocksWide *
+                                  array->blocksHigh * blockStride;
+    array->elems = cells > 0 ? CALLOC(cells, size) : NULL;
+    return array;
+}
+
+/* Function: UArray2s_new_blocked
+ * Purpose: Creates a blocked array. Partial blocks on the right and
+ *          bottom edges are allocated in full so that every block has
+ *          the same stride, which is padded (pitch.h) when a block is
+ *          a multiple of four cache lines.
+ * Arguments: The width, height, element size and blocksize
+ * Returns: A new UArray2s with zeroed cells
+ */
+T UArray2s_new_blocked(int width, int height, int size, int blocksize)
+{
+    return newArray(width, height, size, blocksize, width,
+                    Pitch_pad(blocksize * blocksize, size));
+}
+
+/* Function: UArray2s_new
+ * Purpose: Creates a row-major array whose rows are padded (pitch.h)
+ *          when a row is a multiple of four cache lines
+ * Arguments: The width, height and element size
+ * Returns: A new UArray2s with zeroed cells
+ */
+T UArray2s_new(int width, int height, int size)
+{
+    return newArray(width, height, size, 1, Pitch_pad(width, size), 1);
+}
+
+/* Function: UArray2s_new_with_pitch
+ * Purpose: Creates a row-major array with a given distance between rows
+ * Arguments: The width, height and element size, the cells from the
+ *            start of one row to the start of the next (at least the
+ *            width)
+ * Returns: A new UArray2s with zeroed cells
+ */
+T UArray2s_new_with_pitch(int width, int height, int size, int pitch)
+{
+    return newArray(width, height, size, 1, pitch, 1);
+}
+
+/* Function: UArray2s_free
+ * Purpose: Frees the array and its cells
+ * Arguments: A pointer to the array to free
+ * Returns: none
+ */
+void UArray2s_free(T *array2)
+{
+    assert(array2 != NULL && *array2 != NULL);
+    FREE((*array2)->elems);
+    FREE(*array2);
+}
@@ -0,0 +1,136 @@
+#ifndef UARRAY2S_INCLUDED
+#define UARRAY2S_INCLUDED
+#include "assert.h"
+
+/*
+ * UArray2s: a 2D array whose storage is one flat allocation, either
+ * row-major (blocksize 1) or blocked (blocksize * blocksize cells per
+ * block, blocks stored row of blocks by row of blocks). Rows start
+ * 'pitch' cells apart and blocks 'blockStride' cells apart, which the
+ * constructors pad past the used cells to break cache-set aliasing
+ * (pitch.h). The representation is public so that the element-size
+ * specializations below can be inlined into their callers: with the
+ * size a compile-time constant, 'at' is a multiply-add and copying a
+ * cell is a fixed-size move the compiler can unroll and vectorize.
+ *
+ * UARRAY2S_SPECIALIZE(N) defines, for cells of N bytes:
+ *      UArray2s_cellN                  a struct of N bytes, for copies
+ *      UArray2s_at_N                   row-major 'at'
+ *      UArray2s_blocked_at_N           blocked 'at'
+ *      UArray2s_copy_N                 copy one cell
+ *      UArray2s_map_row_major_N        row-major storage, by rows
+ *      UArray2s_map_col_major_N        row-major storage, by columns
+ *      UArray2s_map_block_major_N      blocked storage, block by block
+ * Instances exist for N = 1, 2, 4, 8 and 12.
+ */
+
+#define T UArray2s_T
+typedef struct T *T;
+
+struct T {
+        int width, height;
+        int size;
+        int blocksize;  /* 1 for row-major storage */
+        int blocksWide; /* blocks in each row of blocks */
+        int blocksHigh; /* rows of blocks */
+        int pitch;      /* row-major: cells from one row to the next */
+        int blockStride;/* blocked: cells from one block to the next */
+        char *elems;
+};
+
+typedef void UArray2s_applyfun(int i, int j, T array2, void *elem, void *cl);
+
+extern T    UArray2s_new        (int width, int height, int size);
+extern T    UArray2s_new_blocked(int width, int height, int size,
+                                 int blocksize);
+/* rows 'pitch' cells apart rather than a padded stride of the
+   constructor's choosing */
+extern T    UArray2s_new_with_pitch(int width, int height, int size,
+                                    int pitch);
+extern void UArray2s_free       (T *array2);
+
+#undef T
+
+#define UARRAY2S_SPECIALIZE(N)                                              \
+typedef struct { unsigned char bytes[N]; } UArray2s_cell##N;                \
+                                                                            \
+static inline void *UArray2s_at_##N(UArray2s_T a, int i, int j)             \
+{                                                                           \
+        assert(a && a->size == N && a->blocksize == 1);                     \
+        assert(i >= 0 && i < a->width && j >= 0 && j < a->height);          \
+        return a->elems + ((long)j * a->pitch + i) * N;                     \
+}                                                                           \
+                                                                            \
+static inline void *UArray2s_blocked_at_##N(UArray2s_T a, int i, int j)     \
+{                                                                           \
+        assert(a && a->size == N);                                          \
+        assert(i >= 0 && i < a->width && j >= 0 && j < a->height);          \
+        int bs = a->blocksize;                                              \
+        long block = (long)(j / bs) * a->blocksWide + i / bs;               \
+        return a->elems + (block * a->blockStride + j % bs * bs + i % bs) * \
+                          N;                                                \
+}                                                                           \
+                                                                            \
+static inline void UArray2s_copy_##N(void *dst, const void *src)            \
+{                                                                           \
+        *(UArray2s_cell##N *)dst = *(const UArray2s_cell##N *)src;          \
+}                                                                           \
+                                                                            \
+static inline void UArray2s_map_row_major_##N(UArray2s_T a,                 \
+                                              UArray2s_applyfun apply,      \
+                                              void *cl)                     \
+{                                                                           \
+        assert(a && a->size == N && a->blocksize == 1);                     \
+        int h = a->height;                                                  \
+        int w = a->width;                                                   \
+        for (int j = 0; j < h; j++) {                                       \
+                char *p = a->elems + (long)j * a->pitch * N;                \
+                for (int i = 0; i < w; i++, p += N)                         \
+                        apply(i, j, a, p, cl);                              \
+        }                                                                   \
+}                                                                           \
+                                                                            \
+static inline void UArray2s_map_col_major_##N(UArray2s_T a,                 \
+                                              UArray2s_applyfun apply,      \
+                                              void *cl)                     \
+{                                                                           \
+        assert(a && a->size == N && a->blocksize == 1);                     \
+        int h = a->height;                                                  \
+        int w = a->width;                                                   \
+        long pitch = (long)a->pitch * N;                                    \
+        for (int i = 0; i < w; i++) {                                       \
+                char *p = a->elems + (long)i * N;                           \
+                for (int j = 0; j < h; j++, p += pitch)                     \
+                        apply(i, j, a, p, cl);                              \
+        }                                                                   \
+}                                                                           \
+                                                                            \
+static inline void UArray2s_map_block_major_##N(UArray2s_T a,               \
+                                                UArray2s_applyfun apply,    \
+                                                void *cl)                   \
+{                                                                           \
+        assert(a && a->size == N);                                          \
+        int bs = a->blocksize;                                              \
+        char *block = a->elems;                                             \
+        for (int bj = 0; bj < a->blocksHigh; bj++) {                        \
+                for (int bi = 0; bi < a->blocksWide; bi++) {                \
+                        int i0 = bi * bs, j0 = bj * bs;                     \
+                        int iw = a->width - i0 < bs ? a->width - i0 : bs;   \
+                        int jh = a->height - j0 < bs ? a->height - j0 : bs; \
+                        for (int r = 0; r < jh; r++) {                      \
+                                char *p = block + (long)r * bs * N;         \
+                                for (int c = 0; c < iw; c++, p += N)        \
+                                        apply(i0 + c, j0 + r, a, p, cl);    \
+                        }                                                   \
+                        block += (long)a->blockStride * N;                  \
+                }                                                           \
+        }                                                                   \
+}
+
+UARRAY2S_SPECIALIZE(1)
+UARRAY2S_SPECIALIZE(2)
+UARRAY2S_SPECIALIZE(4)
+UARRAY2S_SPECIALIZE(8)
+UARRAY2S_SPECIALIZE(12)
+
+#endif
@@ -0,0 +1,440 @@
+/*
+ *                              UArray2z
+ *
+ *   Purpose:
+ *
+ *     Implementation of the compressed blocked array. Each block has a
+ *     form and the bytes of that form; a block never stored is all
+ *     zeros and holds nothing. Unpacked blocks live in a BlockCache,
+ *     whose load and store functions are unpackBlock and packBlock.
+ *
+ *     The packed form is a sequence of codes, each one control byte
+ *     followed by its data. A control byte below 128 is followed by
+ *     that many plus one differences; one of 128 or more stands for a
+ *     run of RUN_MIN or more zero differences, i.e. of bytes equal to
+ *     the same byte of the previous cell. The first cell's bytes are
+ *     differences from zero. Packing gives up, leaving the block raw,
+ *     as soon as the codes would be as large as the block.
+ *
+ *     Uniformity is judged on the cells inside the array only; the
+ *     cells of a ragged edge block past the edge are never seen, and
+ *     come back equal to the others.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "mem.h"
+#include "blockcache.h"
+#include "uarray2z.h"
+
+#define T UArray2z_T
+
+#define MAX_BLOCK_BYTES 65536
+#define LITERAL_MAX 128             /* differences after one code */
+#define RUN_MIN 3                   /* shortest run of zeros coded */
+#define RUN_MAX (RUN_MIN + 127)     /* longest run of zeros coded */
+
+/* Forms of a block */
+enum { BLOCK_ZERO, BLOCK_UNIFORM, BLOCK_PACKED, BLOCK_RAW };
+
+/* Struct block
+* A block at rest: its form and the bytes of that form
+*/
+struct block {
+    int form;
+    long length;            /* bytes in data */
+    unsigned char *data;    /* NULL for BLOCK_ZERO */
+};
+
+struct T {
+    int width, height, size, blocksize;
+    int blocksWide, blocksHigh;
+    long blockBytes;
+    struct block *blocks;
+    unsigned char *scratch;     /* blockBytes, for packing into */
+    BlockCache_T cache;
+};
+
+/* Function: uniform
+ * Purpose: Tells whether the cells of a block inside the array are equal
+ * Arguments: The array, the block's index, its unpacked bytes
+ * Returns: 1 if they are, 0 if not
+ */
+static int uniform(T array, int b, const unsigned char *bytes)
+{
+    int bs = array->blocksize;
+    int i0 = (b % array->blocksWide) * bs, j0 = (b / array->blocksWide) * bs;
+    int iw = array->width - i0 < bs ? array->width - i0 : bs;
+    int jh = array->height - j0 < bs ? array->height - j0 : bs;
+    long rowBytes = (long)iw * array->size;
+    long pitch = (long)bs * array->size;
+
+    /* the first row is uniform iff it equals itself shifted one cell */
+    if (memcmp(bytes + array->size, bytes, rowBytes - array->size) != 0) {
+        return 0;
+    }
+    for (int r = 1; r < jh; r++) {
+        if (memcmp(bytes + r * pitch, bytes, rowBytes) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Function: difference
+ * Purpose: Finds a byte's difference from the same byte of the previous
+ *          cell
+ * Arguments: The block's bytes, the byte's index, the cell size
+ * Returns: The difference, mod 256
+ */
+static inline unsigned char difference(const unsigned char *bytes, long k,
+                                       int size)
+{
+    return bytes[k] - (k >= size ? bytes[k - size] : 0);
+}
+
+/* Function: zeroRun
+ * Purpose: Measures a run of zero differences, comparing a word at a
+ *          time once a whole cell lies behind
+ * Arguments: The block's bytes and length, the cell size, where the run
+ *            starts, the longest run wanted
+ * Returns: The length of the run, at most 'most'
+ */
+static inline long zeroRun(const unsigned char *bytes, long n, int size,
+                           long k, long most)
+{
+    long end = n - k < most ? n : k + most;
+    long i = k;
+    for (; i < end && i < size; i++) {
+        if (bytes[i] != 0) {
+            return i - k;
+        }
+    }
+    for (; i + 8 <= end; i += 8) {
+        uint64_t here, back;
+        memcpy(&here, bytes + i, 8);
+        memcpy(&back, bytes + i - size, 8);
+        if (here != back) {
+            break;
+        }
+    }
+    while (i < end && bytes[i] == bytes[i - size]) {
+        i++;
+    }
+    return i - k;
+}
+
+/* Function: pack
+ * Purpose: Codes a block's differences as described above
+ * Arguments: The block's bytes and length, the cell size, where to put
+ *            the codes (as long as the block)
+ * Returns: The bytes of code, or -1 if they would not be fewer than n
+ */
+static long pack(const unsigned char *bytes, long n, int size,
+                 unsigned char *out)
+{
+    long o = 0;
+    long k = 0;
+    while (k < n) {
+        long run = zeroRun(bytes, n, size, k, RUN_MAX);
+        if (run >= RUN_MIN) {
+            if (o + 1 >= n) {
+                return -1;
+            }
+            out[o++] = 128 + (run - RUN_MIN);
+            k += run;
+            continue;
+        }
+
+        /* differences up to the next run long enough to code */
+        long len = 0;
+        int zeros = 0;
+        while (k + len < n && len < LITERAL_MAX) {
+            if (difference(bytes, k + len, size) != 0) {
+                zeros = 0;
+            } else if (++zeros == RUN_MIN) {
+                len -= RUN_MIN - 1;
+                break;
+            }
+            len++;
+        }
+        if (o + 1 + len >= n) {
+            return -1;
+        }
+        out[o++] = len - 1;
+        for (long d = 0; d < len; d++) {
+            out[o++] = difference(bytes, k + d, size);
+        }
+        k += len;
+    }
+    return o;
+}
+
+/* Function: copyRun
+ * Purpose: Writes a run of zero differences: each byte a copy of the
+ *          same byte of the previous cell, a word at a time when cells
+ *          are at least a word apart
+ * Arguments: The block's bytes, the cell size, where the run starts and
+ *            its length
+ * Returns: Where the run ends
+ */
+static inline long copyRun(unsigned char *bytes, int size, long k, long len)
+{
+    long end = k + len;
+    for (; k < end && k < size; k++) {
+        bytes[k] = 0;
+    }
+    if (size >= 8) {
+        for (; k + 8 <= end; k += 8) {
+            memcpy(bytes + k, bytes + k - size, 8);
+        }
+    }
+    for (; k < end; k++) {
+        bytes[k] = bytes[k - size];
+    }
+    return k;
+}
+
+/* Function: unpack
+ * Purpose: Rebuilds a block from its codes
+ * Arguments: The codes and their length, where to put the block and its
+ *            length, the cell size
+ * Returns: none
+ */
+static void unpack(const unsigned char *in, long length, unsigned char *bytes,
+                   long n, int size)
+{
+    long k = 0;
+    for (long i = 0; i < length; ) {
+        int code = in[i++];
+        if (code < 128) {
+            for (long end = k + code + 1; k < end; k++) {
+                bytes[k] = in[i++] + (k >= size ? bytes[k - size] : 0);
+            }
+        } else {
+            k = copyRun(bytes, size, k, code - 128 + RUN_MIN);
+        }
+    }
+    assert(k == n);
+    (void)n;
+}
+
+/* Function: unpackBlock
+ * Purpose: Fills a cache frame with a block (a BlockCache_movefun)
+ * Arguments: The array, the block's index, the frame
+ * Returns: none
+ */
+static void unpackBlock(void *cl, int b, char *frame)
+{
+    T array = cl;
+    struct block *block = &array->blocks[b];
+    unsigned char *bytes = (unsigned char *)frame;
+    long n = array->blockBytes;
+    switch (block->form) {
+    case BLOCK_ZERO:
+        memset(bytes, 0, n);
+        break;
+    case BLOCK_UNIFORM: {
+        /* one cell, then double what is there */
+        long done = array->size;
+        memcpy(bytes, block->data, done);
+        while (done < n) {
+            long more = done < n - done ? done : n - done;
+            memcpy(bytes + done, bytes, more);
+            done += more;
+        }
+        break;
+    }
+    case BLOCK_PACKED:
+        unpack(block->data, block->length, bytes, n, array->size);
+        break;
+    default:
+        memcpy(bytes, block->data, n);
+    }
+}
+
+/* Function: packBlock
+ * Purpose: Replaces a block's stored form with one packed from a cache
+ *          frame (a BlockCache_movefun)
+ * Arguments: The array, the block's index, the frame
+ * Returns: none
+ */
+static void packBlock(void *cl, int b, char *frame)
+{
+    T array = cl;
+    struct block *block = &array->blocks[b];
+    const unsigned char *bytes = (const unsigned char *)frame;
+    const unsigned char *from = bytes;
+    FREE(block->data);
+    if (uniform(array, b, bytes)) {
+        block->form = BLOCK_UNIFORM;
+        block->length = array->size;
+    } else {
+        block->length = pack(bytes, array->blockBytes, array->size,
+                             array->scratch);
+        if (block->length >= 0) {
+            block->form = BLOCK_PACKED;
+            from = array->scratch;
+        } else {
+            block->form = BLOCK_RAW;
+            block->length = array->blockBytes;
+        }
+    }
+    block->data = ALLOC(block->length);
+    memcpy(block->data, from, block->length);
+}
+
+/* Function: UArray2z_new
+ * Purpose: Creates a compressed blocked array
+ * Arguments: The width, height, element size and blocksize
+ * Returns: A new UArray2z with zeroed cells
+ */
+T UArray2z_new(int width, int height, int size, int blocksize)
+{
+    assert(width > 0 && height > 0 && size > 0 && blocksize > 0);
+    T array;
+    NEW(array);
+    array->width = width;
+    array->height = height;
+    array->size = size;
+    array->blocksize = blocksize;
+    array->blocksWide = (width + blocksize - 1) / blocksize;
+    array->blocksHigh = (height + blocksize - 1) / blocksize;
+    array->blockBytes = (long)blocksize * blocksize * size;
+
+    int blocks = array->blocksWide * array->blocksHigh;
+    array->blocks = CALLOC(blocks, sizeof(struct block));
+    for (int k = 0; k < blocks; k++) {
+        array->blocks[k].form = BLOCK_ZERO;
+    }
+    array->scratch = ALLOC(array->blockBytes);
+    int strip = array->blocksWide > array->blocksHigh ? array->blocksWide
+                                                      : array->blocksHigh;
+    array->cache = BlockCache_new(blocks, array->blockBytes,
+                                  strip + UARRAY2Z_MIN_FRAMES,
+                                  unpackBlock, packBlock, array);
+    return array;
+}
+
+/* Function: UArray2z_new_64K_block
+ * Purpose: Creates a compressed array whose blocks are as large as
+ *          possible within 64KB
+ * Arguments: The width, height and element size
+ * Returns: A new UArray2z
+ */
+T UArray2z_new_64K_block(int width, int height, int size)
+{
+    assert(width > 0 && height > 0 && size > 0);
+    int blocksize = sqrt(MAX_BLOCK_BYTES / size);
+    blocksize = blocksize < 1 ? 1 : blocksize;
+    return UArray2z_new(width, height, size, blocksize);
+}
+
+void UArray2z_free(T *array2z)
+{
+    assert(array2z != NULL && *array2z != NULL);
+    T array = *array2z;
+    int blocks = array->blocksWide * array->blocksHigh;
+    for (int k = 0; k < blocks; k++) {
+        FREE(array->blocks[k].data);
+    }
+    FREE(array->blocks);
+    FREE(array->scratch);
+    BlockCache_free(&array->cache);
+    FREE(*array2z);
+}
+
+int UArray2z_width(T array2z)
+{
+    assert(array2z != NULL);
+    return array2z->width;
+}
+
+int UArray2z_height(T array2z)
+{
+    assert(array2z != NULL);
+    return array2z->height;
+}
+
+int UArray2z_size(T array2z)
+{
+    assert(array2z != NULL);
+    return array2z->size;
+}
+
+int UArray2z_blocksize(T array2z)
+{
+    assert(array2z != NULL);
+    return array2z->blocksize;
+}
+
+/* Function: UArray2z_at
+ * Purpose: Finds a cell, unpacking its block if need be
+ * Arguments: The array, the column and row of the cell
+ * Returns: A pointer to the cell, valid as described in uarray2z.h
+ */
+void *UArray2z_at(T array2z, int column, int row)
+{
+    assert(array2z != NULL);
+    assert(column >= 0 && column < array2z->width);
+    assert(row >= 0 && row < array2z->height);
+    int bs = array2z->blocksize;
+    char *block = BlockCache_touch(array2z->cache,
+                                   (row / bs) * array2z->blocksWide +
+                                   column / bs);
+    return block + ((long)(row % bs) * bs + column % bs) * array2z->size;
+}
+
+/* Function: UArray2z_map
+ * Purpose: Calls apply on every cell, block by block, unpacking each
+ *          block once (again only if apply itself evicts it)
+ * Arguments: The array, the function, its closure
+ * Returns: none
+ */
+void UArray2z_map(T array2z,
+                  void apply(int col, int row, T array2z, void *elem,
+                             void *cl),
+                  void *cl)
+{
+    assert(array2z != NULL && apply != NULL);
+    int bs = array2z->blocksize;
+    long size = array2z->size;
+    for (int bj = 0; bj < array2z->blocksHigh; bj++) {
+        for (int bi = 0; bi < array2z->blocksWide; bi++) {
+            int b = bj * array2z->blocksWide + bi;
+            int i0 = bi * bs, j0 = bj * bs;
+            int iw = array2z->width - i0 < bs ? array2z->width - i0 : bs;
+            int jh = array2z->height - j0 < bs ? array2z->height - j0 : bs;
+            for (int r = 0; r < jh; r++) {
+                for (int c = 0; c < iw; c++) {
+                    char *block = BlockCache_touch(array2z->cache, b);
+                    apply(i0 + c, j0 + r, array2z,
+                          block + ((long)r * bs + c) * size, cl);
+                }
+            }
+        }
+    }
+}
+
+/* Function: UArray2z_packedBytes
+ * Purpose: Measures the array at rest, packing the blocks in the cache
+ * Arguments: The array
+ * Returns: The bytes held by its packed blocks
+ */
+long UArray2z_packedBytes(T array2z)
+{
+    assert(array2z != NULL);
+    BlockCache_flush(array2z->cache);
+    long bytes = 0;
+    int blocks = array2z->blocksWide * array2z->blocksHigh;
+    for (int k = 0; k < blocks; k++) {
+        bytes += array2z->blocks[k].length;
+    }
+    return bytes;
+}
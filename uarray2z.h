@@ -0,0 +1,49 @@
+#ifndef UARRAY2Z_INCLUDED
+#define UARRAY2Z_INCLUDED
+
+/*
+ * UArray2z: a blocked 2D array whose blocks are kept compressed, for
+ * images that are mostly flat (scans, screenshots, diagrams). Blocks are
+ * laid out as in UArray2b; each is held in one of three forms:
+ *
+ *   - uniform: every cell of the block is equal, and one is kept;
+ *   - packed: each byte is replaced by its difference from the same
+ *     byte of the previous cell, and runs of zero differences are
+ *     run-length encoded;
+ *   - raw: a plain copy, for blocks that would not pack smaller.
+ *
+ * A block is unpacked into a cache frame when it is touched and packed
+ * again when it is evicted, if it was touched since it was unpacked.
+ * The cache holds a strip of blocks (the wider of a row or a column of
+ * blocks) plus UARRAY2Z_MIN_FRAMES, so row, column and block traversals
+ * unpack each block once. Pointers returned by 'at' stay valid as in
+ * UArray2f (uarray2file.h), with UARRAY2Z_MIN_FRAMES in place of
+ * UARRAY2F_MIN_FRAMES. An array must not be used by two threads at
+ * once; distinct arrays may be.
+ */
+
+#define T UArray2z_T
+typedef struct T *T;
+
+#define UARRAY2Z_MIN_FRAMES 4
+
+extern T     UArray2z_new      (int width, int height, int size,
+                                int blocksize);
+/* blocksize as in UArray2b_new_64K_block */
+extern T     UArray2z_new_64K_block(int width, int height, int size);
+extern void  UArray2z_free     (T *array2z);
+extern int   UArray2z_width    (T array2z);
+extern int   UArray2z_height   (T array2z);
+extern int   UArray2z_size     (T array2z);
+extern int   UArray2z_blocksize(T array2z);
+extern void *UArray2z_at       (T array2z, int column, int row);
+/* visits every cell in one block before moving to another block */
+extern void  UArray2z_map      (T array2z,
+                                void apply(int col, int row, T array2z,
+                                           void *elem, void *cl),
+                                void *cl);
+/* bytes held by the packed blocks, after packing every cached block */
+extern long  UArray2z_packedBytes(T array2z);
+
+#undef T
+#endif
@@ -0,0 +1,286 @@
+/*
+ *                              workpool
+ *
+ *   Purpose:
+ *
+ *     Implementation of the work-stealing pool. Each worker's share of
+ *     the task numbers is a half-open range [lo, hi) behind its own
+ *     lock: the owner takes lo, a thief takes the back half by lowering
+ *     hi. Shares are padded to a cache line so that workers taking
+ *     tasks from their own shares do not slow each other down.
+ *
+ *     Between runs the threads sleep on a condition variable; a run
+ *     bumps a generation count to wake them, and waits until the last
+ *     of them has found every share empty.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "assert.h"
+#include "mem.h"
+#include "workpool.h"
+
+#define T WorkPool_T
+#define LINE 64
+
+/* struct share
+ * The task numbers a worker has yet to start
+ */
+struct share {
+    pthread_mutex_t lock;
+    int lo, hi;
+    char pad[LINE];
+};
+
+/* struct worker_arg
+ * What a thread needs to find its pool and its share
+ */
+struct worker_arg {
+    T pool;
+    int index;
+};
+
+struct T {
+    int workers;
+    pthread_t *threads;         /* workers 1 to workers - 1 */
+    struct worker_arg *args;
+    struct share *shares;       /* one per worker */
+
+    pthread_mutex_t lock;       /* guards everything below */
+    pthread_cond_t start;       /* signalled when a run begins */
+    pthread_cond_t done;        /* signalled when the last thread ends */
+    unsigned long generation;   /* number of runs begun */
+    int busy;                   /* threads still in the current run */
+    int quit;                   /* set by WorkPool_free */
+    WorkPool_taskfun *task;
+    void *cl;
+};
+
+static void *workerMain(void *vargs);
+
+/* Function: WorkPool_new
+ * Purpose: Starts a pool of workers
+ * Arguments: The number of workers, counting the thread that will call
+ *            WorkPool_run
+ * Returns: A new WorkPool
+ */
+T WorkPool_new(int workers)
+{
+    assert(workers >= 1);
+    T pool;
+    NEW(pool);
+    pool->workers = workers;
+    pool->shares = CALLOC(workers, sizeof(struct share));
+    for (int k = 0; k < workers; k++) {
+        pthread_mutex_init(&pool->shares[k].lock, NULL);
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->generation = 0;
+    pool->busy = 0;
+    pool->quit = 0;
+    pool->task = NULL;
+    pool->cl = NULL;
+
+    pool->threads = CALLOC(workers, sizeof(pthread_t));
+    pool->args = CALLOC(workers, sizeof(struct worker_arg));
+    for (int k = 1; k < workers; k++) {
+        pool->args[k].pool = pool;
+        pool->args[k].index = k;
+        int error = pthread_create(&pool->threads[k], NULL, workerMain,
+                                   &pool->args[k]);
+        assert(error == 0);
+        (void)error;
+    }
+    return pool;
+}
+
+/* Function: WorkPool_free
+ * Purpose: Stops the pool's threads and frees the pool
+ * Arguments: A pointer to a pool with no run in progress
+ * Returns: none
+ */
+void WorkPool_free(T *pool)
+{
+    assert(pool != NULL && *pool != NULL);
+    T p = *pool;
+    pthread_mutex_lock(&p->lock);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+    for (int k = 1; k < p->workers; k++) {
+        pthread_join(p->threads[k], NULL);
+    }
+    for (int k = 0; k < p->workers; k++) {
+        pthread_mutex_destroy(&p->shares[k].lock);
+    }
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->start);
+    pthread_mutex_destroy(&p->lock);
+    FREE(p->args);
+    FREE(p->threads);
+    FREE(p->shares);
+    FREE(*pool);
+}
+
+/* Function: WorkPool_workers
+ * Purpose: Tells how many workers run tasks, counting the caller
+ * Arguments: The pool
+ * Returns: The number given to WorkPool_new
+ */
+int WorkPool_workers(T pool)
+{
+    assert(pool != NULL);
+    return pool->workers;
+}
+
+/* Function: takeOwn
+ * Purpose: Takes the next task from a worker's own share
+ * Arguments: The pool, the worker
+ * Returns: A task number, or -1 if the share is empty
+ */
+static int takeOwn(T pool, int worker)
+{
+    struct share *mine = &pool->shares[worker];
+    int task = -1;
+    pthread_mutex_lock(&mine->lock);
+    if (mine->lo < mine->hi) {
+        task = mine->lo++;
+    }
+    pthread_mutex_unlock(&mine->lock);
+    return task;
+}
+
+/* Function: steal
+ * Purpose: Moves the back half of the largest share into an empty
+ *          worker's share, and takes its first task
+ * Arguments: The pool, the worker whose share is empty
+ * Returns: A task number, or -1 if every share is empty
+ */
+static int steal(T pool, int worker)
+{
+    for (;;) {
+        int victim = -1, most = 0;
+        for (int k = 0; k < pool->workers; k++) {
+            struct share *s = &pool->shares[k];
+            pthread_mutex_lock(&s->lock);
+            int left = s->hi - s->lo;
+            pthread_mutex_unlock(&s->lock);
+            if (k != worker && left > most) {
+                victim = k;
+                most = left;
+            }
+        }
+        if (victim < 0) {
+            return -1;
+        }
+
+        struct share *s = &pool->shares[victim];
+        int lo = 0, hi = 0;
+        pthread_mutex_lock(&s->lock);
+        int left = s->hi - s->lo;
+        if (left > 0) {
+            hi = s->hi;
+            lo = hi - (left + 1) / 2;
+            s->hi = lo;
+        }
+        pthread_mutex_unlock(&s->lock);
+        if (left <= 0) {
+            continue;               /* emptied meanwhile; look again */
+        }
+
+        struct share *mine = &pool->shares[worker];
+        pthread_mutex_lock(&mine->lock);
+        mine->lo = lo + 1;
+        mine->hi = hi;
+        pthread_mutex_unlock(&mine->lock);
+        return lo;
+    }
+}
+
+/* Function: work
+ * Purpose: Runs tasks until none are left anywhere
+ * Arguments: The pool, the worker
+ * Returns: none
+ */
+static void work(T pool, int worker)
+{
+    for (;;) {
+        int task = takeOwn(pool, worker);
+        if (task < 0) {
+            task = steal(pool, worker);
+        }
+        if (task < 0) {
+            return;
+        }
+        pool->task(task, worker, pool->cl);
+    }
+}
+
+static void *workerMain(void *vargs)
+{
+    struct worker_arg *arg = vargs;
+    T pool = arg->pool;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen && !pool->quit) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        work(pool, arg->index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/* Function: WorkPool_run
+ * Purpose: Runs tasks 0 to tasks - 1 on the pool's workers, the
+ *          calling thread included
+ * Arguments: The pool, the number of tasks, the task function and its
+ *            closure
+ * Returns: none, once every task has finished
+ */
+void WorkPool_run(T pool, int tasks, WorkPool_taskfun *task, void *cl)
+{
+    assert(pool != NULL && task != NULL && tasks >= 0);
+    int workers = pool->workers;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->cl = cl;
+    for (int k = 0; k < workers; k++) {
+        struct share *s = &pool->shares[k];
+        pthread_mutex_lock(&s->lock);
+        s->lo = (int)((long)tasks * k / workers);
+        s->hi = (int)((long)tasks * (k + 1) / workers);
+        pthread_mutex_unlock(&s->lock);
+    }
+    pool->busy = workers - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    work(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
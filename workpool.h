@@ -0,0 +1,39 @@
+/*
+ *                              workpool
+ *
+ *   Purpose:
+ *
+ *     Interface to a pool of worker threads with work stealing. A run
+ *     hands the pool a number of tasks, numbered from 0; each worker
+ *     starts with an equal, contiguous share of the numbers, works
+ *     through its own share from the front, and once it runs dry
+ *     steals the back half of the largest share left. WorkPool_run
+ *     returns when every task has finished. The calling thread works
+ *     as worker 0, so a pool of n workers starts n - 1 threads.
+ *
+ *     A pool serves one run at a time; runs from different threads
+ *     must be serialized by the caller.
+ *
+ *   Authors: Henry Liu (hliu12) and Blake Watabe (bwatab01)
+ *
+ */
+
+#ifndef WORKPOOL_INCLUDED
+#define WORKPOOL_INCLUDED
+
+#define T WorkPool_T
+typedef struct T *T;
+
+/* A task: its number, the worker running it (0 to workers - 1), and
+ * the closure given to WorkPool_run
+ */
+typedef void WorkPool_taskfun(int task, int worker, void *cl);
+
+extern T    WorkPool_new    (int workers);
+extern void WorkPool_free   (T *pool);
+extern int  WorkPool_workers(T pool);
+extern void WorkPool_run    (T pool, int tasks, WorkPool_taskfun *task,
+                             void *cl);
+
+#undef T
+#endif